@@ -6,6 +6,7 @@
 #include <string.h>
 #include <stdlib.h>
 #include <stdint.h>
+#include <ctype.h>
 #include <process.h>
 #include <math.h> // For smoother rounded corners
 
@@ -15,11 +16,25 @@
 #define EDGE_MARGIN 10
 #define MAX_TEXT_LENGTH 10000
 #define TEMP_FILE_NAME "temp_code.ocl"
+#define PYTHON_EXE "C:\\Python39\\python.exe"
+#define OCL_MAIN_PY "C:\\Users\\nayle\\Documents\\Projects\\OCL\\main.py"
 #define SCROLL_SPEED 20
 #define BUTTON_WIDTH 80
 #define BUTTON_HEIGHT 30
 #define ANIMATION_FRAMES 240 // 4 seconds at 60 FPS
+#define EDITOR_FADE_MS 250 // Fade-in overlay; the editor is usable from the first frame
 #define CORNER_RADIUS 8 // Reduced for better button fit
+#define EXPLORER_ROW_PADDING 4
+#define EXPLORER_INDENT 14
+#define MAX_EXPLORER_ROWS 128 // Upper bound on rows visible at once
+#define MAX_QUERY_LENGTH 128
+#define MAX_SEARCH_THREADS 16
+#define MAX_SEARCH_RESULTS 10000
+#define SEARCH_PREVIEW_LENGTH 96
+#define SEARCH_DEBOUNCE_MS 150 // Workspace search starts once typing pauses this long
+#define DIAG_DEBOUNCE_MS 300
+#define DIAG_TIMEOUT_MS 2000 // A checker that takes longer is killed and restarted
+#define MAX_DIAGNOSTICS 64
 
 typedef struct {
     SDL_Color bg_dark;
@@ -33,13 +48,22 @@ typedef struct {
     SDL_Color hover;
     SDL_Color selection;
     SDL_Color button_border;
+    SDL_Color error;
+    SDL_Color warning;
 } Theme;
 
+// Text rendered to a texture once and drawn with a single copy afterwards
+typedef struct {
+    SDL_Texture* texture;
+    int w, h;
+} CachedText;
+
 typedef struct {
     char text[32];
     int enabled;
     SDL_Rect rect;
     void (*action)(void*, char*);
+    CachedText label;
 } MenuItem;
 
 typedef struct {
@@ -48,8 +72,137 @@ typedef struct {
     MenuItem items[10];
     int item_count;
     int open;
+    CachedText label;
 } DropdownMenu;
 
+typedef struct {
+    CachedText file_explorer;
+    CachedText run;
+    CachedText debug;
+    CachedText console;
+    CachedText indexing;
+    char console_text[1024]; // Text the console texture was rendered from
+    int console_wrap;        // Wrap width it was rendered at, -1 before the first render
+} UiCache;
+
+// One file or directory under the workspace root, path relative to it
+typedef struct {
+    char path[MAX_PATH];
+    int depth;
+    int is_dir;
+    int expanded; // Directories only; toggled by the UI thread
+} FileEntry;
+
+// Entries kept sorted with CompareEntryPaths, so a directory's subtree directly follows it
+typedef struct {
+    FileEntry* items;
+    int count, capacity;
+} FileList;
+
+// Workspace index owned by a worker thread. The UI thread only takes `lock` for
+// short in-memory reads; all directory walking and change waiting happens off it.
+typedef struct {
+    char root[MAX_PATH];
+    FileList entries;
+    int generation;       // Bumped under `lock` whenever `entries` changes
+    SDL_atomic_t scanning;
+    SDL_mutex* lock;
+    SDL_Thread* thread;
+    HANDLE stop_event;
+} FileIndex;
+
+// Virtualized view of the index: only rows inside the panel get textures
+typedef struct {
+    int* rows;            // Indices into the index entries, collapsed subtrees skipped
+    int row_count, row_capacity;
+    int rows_generation;  // Index generation `rows` was built from
+    int dirty;            // Set when a directory is expanded or collapsed
+    int version;          // Bumped on every rebuild; part of the texture cache key
+    int scroll_row;
+    CachedText row_text[MAX_EXPLORER_ROWS];
+    int row_indent[MAX_EXPLORER_ROWS];
+    int cached_version, cached_first, cached_count;
+} ExplorerView;
+
+typedef struct {
+    int file; // Index into the job's file list
+    int line;
+    char preview[SEARCH_PREVIEW_LENGTH];
+} SearchResult;
+
+// One workspace query. Reference counted so a superseded job can be cancelled
+// and dropped by the UI while workers are still finishing their current file.
+typedef struct {
+    int serial;              // Distinguishes jobs for the UI's texture cache
+    SDL_atomic_t refs;
+    SDL_atomic_t cancelled;
+    SDL_atomic_t next_file;  // Workers claim files by bumping this
+    SDL_atomic_t files_done;
+    char query[MAX_QUERY_LENGTH];
+    int query_len;
+    char (*files)[MAX_PATH]; // Full paths of the .ocl files in the index when the job started
+    int file_count;
+    SearchResult* results;   // Appended under the search lock as files finish
+    int result_count, result_capacity;
+} SearchJob;
+
+typedef struct {
+    SDL_Thread* workers[MAX_SEARCH_THREADS];
+    int worker_count;
+    SDL_mutex* lock;
+    SDL_cond* wake;
+    int quit;
+    SearchJob* job;          // Current job; the UI holds one reference to it
+    // UI-side state
+    int scroll_row;
+    CachedText row_text[MAX_EXPLORER_ROWS];
+    int cached_serial;
+    int cached_first, cached_count;
+    CachedText status;
+    int status_results, status_done; // Counts the status texture shows, -1 to force a refresh
+} WorkspaceSearch;
+
+// Find bar over the editor: FIND_IN_FILE searches the buffer, FIND_IN_WORKSPACE every indexed .ocl file
+enum { FIND_CLOSED, FIND_IN_FILE, FIND_IN_WORKSPACE };
+
+typedef struct {
+    int mode;
+    char query[MAX_QUERY_LENGTH];
+    int query_changed_at;    // SDL_GetTicks() of the last edit, 0 once a search started for it
+    CachedText label;
+    int label_dirty;
+} FindBar;
+
+typedef struct {
+    int line, column;
+    int is_error;
+    char message[160];
+} Diagnostic;
+
+// Live syntax checking. A worker thread feeds the newest buffer to a persistent
+// `main.py --check-server` process (the real lexer and parser, re-parsing only from the
+// first changed statement) and publishes the reply. The UI only copies buffers and results.
+typedef struct {
+    SDL_Thread* thread;
+    SDL_mutex* lock;
+    SDL_cond* wake;
+    int quit;
+    char pending[MAX_TEXT_LENGTH]; // Newest buffer submitted by the UI
+    int pending_revision;
+    Diagnostic items[MAX_DIAGNOSTICS];
+    int count;
+    int result_revision;           // Revision `items` was produced from
+    // Checker process, touched only by the worker thread
+    HANDLE process, to_child, from_child;
+    // UI-side state
+    char seen[MAX_TEXT_LENGTH];    // Buffer as of the last frame, to detect edits
+    Uint32 changed_at;             // Last edit, 0 once submitted
+    int shown_revision;
+    Diagnostic shown[MAX_DIAGNOSTICS];
+    int shown_count;
+    CachedText messages[MAX_DIAGNOSTICS];
+} DiagnosticsWorker;
+
 typedef struct {
     char text[MAX_TEXT_LENGTH];
     int cursor_pos;
@@ -72,8 +225,10 @@ int fullscreen = 0;
 Theme theme;
 void* editor_ptr;
 SDL_Window* global_window = NULL;
+HANDLE live_process = NULL; // `main.py --hot-reload` session started by RunLive
 EditHistory history[100];
 int history_pos = 0, history_count = 0;
+UiCache ui_cache;
 
 void ToggleFullscreen(SDL_Window* window);
 void InitTheme();
@@ -84,6 +239,7 @@ void InsertText(EditorState* editor, const char* text);
 void DeleteText(EditorState* editor);
 char* ExecuteCode(EditorState* editor, int debug, char* console_output);
 void EditorOpenFile(void* data, char* console_output);
+void LoadFileIntoEditor(EditorState* editor, const char* filename);
 void SaveFile(void* data, char* console_output);
 void SaveAsFile(void* data, char* console_output);
 void NewFile(void* data, char* console_output);
@@ -97,15 +253,59 @@ void Redo(EditorState* editor, char* console_output);
 void ToggleFullscreenAction(void* data, char* console_output);
 void RunCode(void* data, char* console_output);
 void DebugCode(void* data, char* console_output);
+void RunLive(void* data, char* console_output);
 void RenderText(SDL_Renderer* renderer, EditorState* editor, int x, int y, int width, int height, int menu_bar_height);
 void RenderRoundedRect(SDL_Renderer* renderer, SDL_Rect* rect, int radius, SDL_Color color, Uint8 alpha);
-void RenderDropdownMenu(SDL_Renderer* renderer, DropdownMenu* menu, TTF_Font* font, int mouse_x, int mouse_y);
+void RenderDropdownMenu(SDL_Renderer* renderer, DropdownMenu* menu, int mouse_x, int mouse_y);
 int CountLines(const char* text);
-void RenderAnimation(SDL_Renderer* renderer, TTF_Font* font);
-void RenderEditorFadeIn(SDL_Renderer* renderer, TTF_Font* font, EditorState* editor, 
-                        DropdownMenu* file_menu, DropdownMenu* edit_menu, DropdownMenu* view_menu,
-                        int window_width, int window_height, int left_panel_width, int bottom_panel_height,
-                        int menu_bar_height, char* console_output);
+int CacheText(SDL_Renderer* renderer, TTF_Font* font, const char* text, SDL_Color color, CachedText* out);
+void DrawCachedText(SDL_Renderer* renderer, CachedText* text, int x, int y, Uint8 alpha);
+void FreeCachedText(CachedText* text);
+void BuildUiCache(SDL_Renderer* renderer, TTF_Font* font, DropdownMenu* menus[], int menu_count);
+void FreeUiCache(DropdownMenu* menus[], int menu_count);
+void RenderConsole(SDL_Renderer* renderer, TTF_Font* font, const char* console_output, SDL_Rect* panel);
+void RenderAnimation(SDL_Renderer* renderer);
+double ElapsedMs(Uint64 since);
+int CompareEntryPaths(const char* a, const char* b);
+int FindEntry(FileList* list, const char* path, int* found);
+int PushEntry(FileList* list, const FileEntry* entry);
+void InsertEntry(FileList* list, const FileEntry* entry);
+void RemoveEntryTree(FileList* list, const char* path);
+int IsHiddenPath(const char* rel);
+int CompareEntries(const void* a, const void* b);
+int IndexStopping(FileIndex* index);
+void ScanDirectory(FileIndex* index, const char* rel, int depth, FileList* out);
+void RescanIndex(FileIndex* index);
+void ApplyIndexChanges(FileIndex* index, FILE_NOTIFY_INFORMATION* info);
+int IndexerThread(void* data);
+int StartFileIndex(FileIndex* index, const char* root);
+void StopFileIndex(FileIndex* index);
+void RebuildExplorerRows(FileIndex* index, ExplorerView* view);
+void RenderFileExplorer(SDL_Renderer* renderer, TTF_Font* font, FileIndex* index, ExplorerView* view, SDL_Rect* panel, int row_height);
+void ClickFileExplorer(FileIndex* index, ExplorerView* view, EditorState* editor, SDL_Rect* panel, int row_height, int mouse_y);
+void FreeExplorerView(ExplorerView* view);
+int FindInBuffer(EditorState* editor, const char* query, int from);
+void SelectRange(EditorState* editor, int pos, int len);
+void FindNext(EditorState* editor, const char* query);
+void FindQueryChanged(FindBar* find, EditorState* editor);
+void ReleaseSearchJob(SearchJob* job);
+void AppendSearchResults(WorkspaceSearch* search, SearchJob* job, SearchResult* found, int count);
+void SearchFile(WorkspaceSearch* search, SearchJob* job, int file);
+int SearchWorker(void* data);
+int StartWorkspaceSearch(WorkspaceSearch* search);
+void StopWorkspaceSearch(WorkspaceSearch* search);
+void BeginWorkspaceQuery(WorkspaceSearch* search, FileIndex* index, const char* query);
+void RenderFindBar(SDL_Renderer* renderer, TTF_Font* font, FindBar* find, SDL_Rect* area);
+int StartChecker(DiagnosticsWorker* diag);
+void StopChecker(DiagnosticsWorker* diag);
+int RunCheck(DiagnosticsWorker* diag, const char* text, Diagnostic* items, int* count);
+int DiagnosticsThread(void* data);
+int StartDiagnostics(DiagnosticsWorker* diag);
+void StopDiagnostics(DiagnosticsWorker* diag);
+void UpdateDiagnostics(DiagnosticsWorker* diag, EditorState* editor);
+void RenderDiagnostics(SDL_Renderer* renderer, TTF_Font* font, DiagnosticsWorker* diag, EditorState* editor, int x, int y, int height, int menu_bar_height);
+void RenderSearchResults(SDL_Renderer* renderer, TTF_Font* font, WorkspaceSearch* search, SDL_Rect* panel, int row_height);
+void ClickSearchResults(WorkspaceSearch* search, EditorState* editor, SDL_Rect* panel, int row_height, int mouse_y);
 
 void ToggleFullscreen(SDL_Window* window) {
     HWND taskbar = FindWindow("Shell_TrayWnd", NULL);
@@ -131,6 +331,8 @@ void InitTheme() {
     theme.hover = (SDL_Color){100, 149, 237, 255};
     theme.selection = (SDL_Color){65, 105, 225, 100};
     theme.button_border = (SDL_Color){40, 40, 40, 255};
+    theme.error = (SDL_Color){220, 80, 80, 255};
+    theme.warning = (SDL_Color){230, 190, 80, 255};
 }
 
 void InitMenus(DropdownMenu* file_menu, DropdownMenu* edit_menu, DropdownMenu* view_menu) {
@@ -227,9 +429,9 @@ char* ExecuteCode(EditorState* editor, int debug, char* console_output) {
 
     char cmd[512];
     if (debug) {
-        sprintf(cmd, "C:\\Python39\\python.exe C:\\Users\\nayle\\Documents\\Projects\\OCL\\main.py --debug %s > temp_output.txt 2>&1", TEMP_FILE_NAME);
+        sprintf(cmd, PYTHON_EXE " " OCL_MAIN_PY " --debug %s > temp_output.txt 2>&1", TEMP_FILE_NAME);
     } else {
-        sprintf(cmd, "C:\\Python39\\python.exe C:\\Users\\nayle\\Documents\\Projects\\OCL\\main.py %s > temp_output.txt 2>&1", TEMP_FILE_NAME);
+        sprintf(cmd, PYTHON_EXE " " OCL_MAIN_PY " %s > temp_output.txt 2>&1", TEMP_FILE_NAME);
     }
 
     printf("Executing command: %s\n", cmd);
@@ -296,21 +498,24 @@ void EditorOpenFile(void* data, char* console_output) {
     ofn.nMaxFile = MAX_PATH;
     ofn.Flags = OFN_EXPLORER | OFN_FILEMUSTEXIST;
     ofn.lpstrDefExt = "ocl";
-    if (GetOpenFileName(&ofn)) {
-        FILE* file = fopen(filename, "r");
-        if (file) {
-            editor->text[0] = '\0';
-            editor->cursor_pos = 0;
-            char buffer[1024];
-            while (fgets(buffer, sizeof(buffer), file)) {
-                InsertText(editor, buffer);
-            }
-            editor->cursor_pos = 0;
-            editor->scroll_y = 0;
-            editor->modified = 0;
-            strcpy(editor->filename, filename);
-            fclose(file);
+    if (GetOpenFileName(&ofn)) LoadFileIntoEditor(editor, filename);
+}
+
+void LoadFileIntoEditor(EditorState* editor, const char* filename) {
+    FILE* file = fopen(filename, "r");
+    if (file) {
+        editor->text[0] = '\0';
+        editor->cursor_pos = 0;
+        char buffer[1024];
+        while (fgets(buffer, sizeof(buffer), file)) {
+            InsertText(editor, buffer);
         }
+        editor->cursor_pos = 0;
+        editor->scroll_y = 0;
+        editor->modified = 0;
+        strncpy(editor->filename, filename, sizeof(editor->filename) - 1);
+        editor->filename[sizeof(editor->filename) - 1] = '\0';
+        fclose(file);
     }
 }
 
@@ -426,6 +631,40 @@ void DebugCode(void* data, char* console_output) {
     ExecuteCode(editor, 1, console_output);
 }
 
+// Saves the buffer to the temp file. The first call starts a `--hot-reload` session on it in
+// its own console; while that session runs, later calls only save and the running script
+// swaps in the new functions and classes at its next frame, keeping its window and state.
+void RunLive(void* data, char* console_output) {
+    EditorState* editor = (EditorState*)data;
+    FILE* file = fopen(TEMP_FILE_NAME, "w");
+    if (!file) {
+        strcpy(console_output, "> Error: Cannot create temp file\n");
+        return;
+    }
+    fprintf(file, "%s", editor->text);
+    fclose(file);
+
+    if (live_process && WaitForSingleObject(live_process, 0) == WAIT_TIMEOUT) {
+        strcpy(console_output, "> Live session reloading (see its console for timing)\n");
+        return;
+    }
+    if (live_process) CloseHandle(live_process);
+    live_process = NULL;
+
+    STARTUPINFO si = {0};
+    si.cb = sizeof(si);
+    PROCESS_INFORMATION pi;
+    char cmd[512];
+    snprintf(cmd, sizeof(cmd), "\"%s\" \"%s\" --hot-reload %s", PYTHON_EXE, OCL_MAIN_PY, TEMP_FILE_NAME);
+    if (!CreateProcess(NULL, cmd, NULL, NULL, FALSE, CREATE_NEW_CONSOLE, NULL, NULL, &si, &pi)) {
+        strcpy(console_output, "> Error: Failed to start live session\n");
+        return;
+    }
+    CloseHandle(pi.hThread);
+    live_process = pi.hProcess;
+    strcpy(console_output, "> Live session started - press F5 again to reload\n");
+}
+
 void RenderText(SDL_Renderer* renderer, EditorState* editor, int x, int y, int width, int height, int menu_bar_height) {
     char line[1024];
     int line_start = 0, line_num = 0, render_y = y - editor->scroll_y;
@@ -474,7 +713,8 @@ void RenderText(SDL_Renderer* renderer, EditorState* editor, int x, int y, int w
                 if (strstr(line, "let") || strstr(line, "print") || strstr(line, "if") ||
                     strstr(line, "elif") || strstr(line, "else") || strstr(line, "while") ||
                     strstr(line, "define") || strstr(line, "return") || strstr(line, "class") ||
-                    strstr(line, "break") || strstr(line, "continue") || strstr(line, "true") ||
+                    strstr(line, "break") || strstr(line, "continue") || strstr(line, "spawn") ||
+                    strstr(line, "yield") || strstr(line, "true") ||
                     strstr(line, "false") || strstr(line, "null") || strstr(line, "int") ||
                     strstr(line, "float") || strstr(line, "bool") || strstr(line, "string") ||
                     strstr(line, "ocl")) color = theme.keyword;
@@ -533,22 +773,13 @@ void RenderRoundedRect(SDL_Renderer* renderer, SDL_Rect* rect, int radius, SDL_C
     }
 }
 
-void RenderDropdownMenu(SDL_Renderer* renderer, DropdownMenu* menu, TTF_Font* font, int mouse_x, int mouse_y) {
+void RenderDropdownMenu(SDL_Renderer* renderer, DropdownMenu* menu, int mouse_x, int mouse_y) {
     SDL_Color btn_color = (mouse_x >= 0 && SDL_PointInRect(&(SDL_Point){mouse_x, mouse_y}, &menu->rect)) ? theme.hover : theme.accent;
     RenderRoundedRect(renderer, &menu->rect, CORNER_RADIUS, btn_color, 255);
     SDL_SetRenderDrawColor(renderer, theme.button_border.r, theme.button_border.g, theme.button_border.b, 255);
     SDL_RenderDrawRect(renderer, &menu->rect);  // Optional: keep border as rectangle
 
-    SDL_Surface* button_text = TTF_RenderText_Solid(font, menu->title, theme.text);
-    if (button_text) {
-        SDL_Texture* button_texture = SDL_CreateTextureFromSurface(renderer, button_text);
-        if (button_texture) {
-            SDL_Rect text_rect = {menu->rect.x + (menu->rect.w - button_text->w) / 2, menu->rect.y + 5, button_text->w, button_text->h};
-            SDL_RenderCopy(renderer, button_texture, NULL, &text_rect);
-            SDL_DestroyTexture(button_texture);
-        }
-        SDL_FreeSurface(button_text);
-    }
+    DrawCachedText(renderer, &menu->label, menu->rect.x + (menu->rect.w - menu->label.w) / 2, menu->rect.y + 5, 255);
 
     if (menu->open) {
         int dropdown_height = menu->item_count * 35;
@@ -564,22 +795,85 @@ void RenderDropdownMenu(SDL_Renderer* renderer, DropdownMenu* menu, TTF_Font* fo
             SDL_SetRenderDrawColor(renderer, theme.button_border.r, theme.button_border.g, theme.button_border.b, 255);
             SDL_RenderDrawRect(renderer, &menu->items[i].rect);  // Optional: keep border as rectangle
 
-            SDL_Color text_color = menu->items[i].enabled ? theme.text : theme.comment;
-            SDL_Surface* item_text = TTF_RenderText_Solid(font, menu->items[i].text, text_color);
-            if (item_text) {
-                SDL_Texture* item_texture = SDL_CreateTextureFromSurface(renderer, item_text);
-                if (item_texture) {
-                    SDL_Rect text_rect = {menu->items[i].rect.x + 15, menu->items[i].rect.y + 10, item_text->w, item_text->h};
-                    SDL_RenderCopy(renderer, item_texture, NULL, &text_rect);
-                    SDL_DestroyTexture(item_texture);
-                }
-                SDL_FreeSurface(item_text);
-            }
+            DrawCachedText(renderer, &menu->items[i].label, menu->items[i].rect.x + 15, menu->items[i].rect.y + 10, 255);
+        }
+    }
+}
+
+int CacheText(SDL_Renderer* renderer, TTF_Font* font, const char* text, SDL_Color color, CachedText* out) {
+    out->texture = NULL;
+    out->w = out->h = 0;
+    SDL_Surface* surface = TTF_RenderText_Solid(font, text, color);
+    if (!surface) return 0;
+    out->texture = SDL_CreateTextureFromSurface(renderer, surface);
+    out->w = surface->w;
+    out->h = surface->h;
+    SDL_FreeSurface(surface);
+    return out->texture != NULL;
+}
+
+void DrawCachedText(SDL_Renderer* renderer, CachedText* text, int x, int y, Uint8 alpha) {
+    if (!text->texture) return;
+    SDL_SetTextureAlphaMod(text->texture, alpha);
+    SDL_Rect rect = {x, y, text->w, text->h};
+    SDL_RenderCopy(renderer, text->texture, NULL, &rect);
+}
+
+void FreeCachedText(CachedText* text) {
+    if (text->texture) SDL_DestroyTexture(text->texture);
+    text->texture = NULL;
+}
+
+void BuildUiCache(SDL_Renderer* renderer, TTF_Font* font, DropdownMenu* menus[], int menu_count) {
+    CacheText(renderer, font, "File Explorer", theme.text, &ui_cache.file_explorer);
+    CacheText(renderer, font, "Run", theme.text, &ui_cache.run);
+    CacheText(renderer, font, "Debug", theme.text, &ui_cache.debug);
+    CacheText(renderer, font, "Indexing...", theme.comment, &ui_cache.indexing);
+    for (int m = 0; m < menu_count; m++) {
+        CacheText(renderer, font, menus[m]->title, theme.text, &menus[m]->label);
+        for (int i = 0; i < menus[m]->item_count; i++) {
+            MenuItem* item = &menus[m]->items[i];
+            CacheText(renderer, font, item->text, item->enabled ? theme.text : theme.comment, &item->label);
         }
     }
+    ui_cache.console.texture = NULL;
+    ui_cache.console_text[0] = '\0';
+    ui_cache.console_wrap = -1;
 }
 
-void RenderAnimation(SDL_Renderer* renderer, TTF_Font* font) {
+void FreeUiCache(DropdownMenu* menus[], int menu_count) {
+    FreeCachedText(&ui_cache.file_explorer);
+    FreeCachedText(&ui_cache.run);
+    FreeCachedText(&ui_cache.debug);
+    FreeCachedText(&ui_cache.console);
+    FreeCachedText(&ui_cache.indexing);
+    for (int m = 0; m < menu_count; m++) {
+        FreeCachedText(&menus[m]->label);
+        for (int i = 0; i < menus[m]->item_count; i++) FreeCachedText(&menus[m]->items[i].label);
+    }
+}
+
+// Re-renders the console text only when it or the panel width changed
+void RenderConsole(SDL_Renderer* renderer, TTF_Font* font, const char* console_output, SDL_Rect* panel) {
+    int wrap = panel->w - 40;
+    if (wrap != ui_cache.console_wrap || strcmp(console_output, ui_cache.console_text) != 0) {
+        FreeCachedText(&ui_cache.console);
+        SDL_Surface* console_surface = TTF_RenderText_Blended_Wrapped(font, console_output, theme.text, wrap);
+        if (console_surface) {
+            ui_cache.console.texture = SDL_CreateTextureFromSurface(renderer, console_surface);
+            ui_cache.console.w = console_surface->w;
+            ui_cache.console.h = console_surface->h;
+            SDL_FreeSurface(console_surface);
+        }
+        strncpy(ui_cache.console_text, console_output, sizeof(ui_cache.console_text) - 1);
+        ui_cache.console_text[sizeof(ui_cache.console_text) - 1] = '\0';
+        ui_cache.console_wrap = wrap;
+    }
+    DrawCachedText(renderer, &ui_cache.console, panel->x + 20, panel->y + 20, 255);
+}
+
+void RenderAnimation(SDL_Renderer* renderer) {
+    // The large splash font is only needed here, so it is opened on demand
     TTF_Font* anim_font = TTF_OpenFont("C:\\Windows\\Fonts\\consola.ttf", 46);
     if (!anim_font) anim_font = TTF_OpenFont("C:\\Windows\\Fonts\\arial.ttf", 46);
     if (!anim_font) {
@@ -587,12 +881,25 @@ void RenderAnimation(SDL_Renderer* renderer, TTF_Font* font) {
         return;
     }
 
-    SDL_Color text_color = theme.text;
+    // Each word is rendered once; frames only move and fade the textures
+    CachedText ocl_text, e_text, ditor_text;
+    int cached = CacheText(renderer, anim_font, "OCL", theme.text, &ocl_text);
+    cached &= CacheText(renderer, anim_font, "E", theme.text, &e_text);
+    cached &= CacheText(renderer, anim_font, "ditor", theme.text, &ditor_text);
+    TTF_CloseFont(anim_font);
+    if (!cached) {
+        printf("Failed to render animation text: %s\n", TTF_GetError());
+        FreeCachedText(&ocl_text);
+        FreeCachedText(&e_text);
+        FreeCachedText(&ditor_text);
+        return;
+    }
+
     int window_width, window_height;
     SDL_GetWindowSize(global_window, &window_width, &window_height);
 
     int frame = 0;
-    const int TOTAL_FRAMES = 240;
+    const int TOTAL_FRAMES = ANIMATION_FRAMES;
     float ocl_x = window_width / 2 - 150;  // Reduced spacing
     float ocl_y = window_height / 2;
     float e_x = window_width;
@@ -600,58 +907,22 @@ void RenderAnimation(SDL_Renderer* renderer, TTF_Font* font) {
     float ditor_alpha = 0.0f;
     float e_target_x = 0;
 
-    SDL_Surface* ocl_surface = NULL;
-    SDL_Surface* e_surface = NULL;
-    SDL_Surface* ditor_surface = NULL;
-
-    printf("Starting animation\n");
+    printf("Starting animation (any key or click skips)\n");
     while (frame < TOTAL_FRAMES) {
         SDL_SetRenderDrawColor(renderer, theme.bg_dark.r, theme.bg_dark.g, theme.bg_dark.b, 255);
         SDL_RenderClear(renderer);
 
-        ocl_surface = TTF_RenderText_Solid(anim_font, "OCL", text_color);
-        if (!ocl_surface) {
-            printf("Failed to render OCL: %s\n", TTF_GetError());
-            break;
-        }
-        SDL_Texture* ocl_texture = SDL_CreateTextureFromSurface(renderer, ocl_surface);
-        if (ocl_texture) {
-            SDL_Rect ocl_rect = {(int)ocl_x, (int)ocl_y - ocl_surface->h / 2, ocl_surface->w, ocl_surface->h};
-            SDL_RenderCopy(renderer, ocl_texture, NULL, &ocl_rect);
-            SDL_DestroyTexture(ocl_texture);
-        }
-        SDL_FreeSurface(ocl_surface);
-        ocl_surface = NULL;
-
-        // Calculate ocl_rect here for use in e_target_x
-        SDL_Surface* temp_ocl_surface = TTF_RenderText_Solid(anim_font, "OCL", text_color);
-        if (temp_ocl_surface) {
-            SDL_Rect temp_ocl_rect = {(int)ocl_x, (int)ocl_y - temp_ocl_surface->h / 2, temp_ocl_surface->w, temp_ocl_surface->h};
-            if (frame == TOTAL_FRAMES / 4) {
-                e_target_x = ocl_x + temp_ocl_rect.w - 10;  // Reduced spacing between OCL and E
-                printf("E target set at frame %d\n", frame);
-            }
-            SDL_FreeSurface(temp_ocl_surface);
+        DrawCachedText(renderer, &ocl_text, (int)ocl_x, (int)ocl_y - ocl_text.h / 2, 255);
+        if (frame == TOTAL_FRAMES / 4) {
+            e_target_x = ocl_x + ocl_text.w - 10;  // Reduced spacing between OCL and E
         }
 
         if (frame >= TOTAL_FRAMES / 4) {
-            e_surface = TTF_RenderText_Solid(anim_font, "E", text_color);
-            if (!e_surface) {
-                printf("Failed to render E: %s\n", TTF_GetError());
-                break;
-            }
-            SDL_Texture* e_texture = SDL_CreateTextureFromSurface(renderer, e_surface);
-            if (e_texture) {
-                if (e_x > e_target_x) {
-                    e_x -= (e_x - e_target_x) * 0.025f;
-                    if (e_x < e_target_x) e_x = e_target_x;
-                }
-                SDL_Rect e_rect = {(int)e_x, (int)e_y - e_surface->h / 2, e_surface->w, e_surface->h};
-                SDL_RenderCopy(renderer, e_texture, NULL, &e_rect);
-                SDL_DestroyTexture(e_texture);
+            if (e_x > e_target_x) {
+                e_x -= (e_x - e_target_x) * 0.025f;
+                if (e_x < e_target_x) e_x = e_target_x;
             }
-            SDL_FreeSurface(e_surface);
-            e_surface = NULL;
+            DrawCachedText(renderer, &e_text, (int)e_x, (int)e_y - e_text.h / 2, 255);
 
             if (frame < TOTAL_FRAMES / 2 && e_x > e_target_x) {
                 ocl_x -= 0.5f;
@@ -666,23 +937,9 @@ void RenderAnimation(SDL_Renderer* renderer, TTF_Font* font) {
         }
 
         if (frame >= TOTAL_FRAMES * 3 / 4 && e_x <= e_target_x) {
-            ditor_surface = TTF_RenderText_Solid(anim_font, "ditor", text_color);
-            if (!ditor_surface) {
-                printf("Failed to render ditor: %s\n", TTF_GetError());
-                break;
-            }
             ditor_alpha += 0.025f;  // Increased fade speed for visibility
             if (ditor_alpha > 1.0f) ditor_alpha = 1.0f;
-            SDL_Texture* ditor_texture = SDL_CreateTextureFromSurface(renderer, ditor_surface);
-            if (ditor_texture) {
-                SDL_SetTextureAlphaMod(ditor_texture, (Uint8)(ditor_alpha * 255));
-                SDL_Rect ditor_rect = {(int)(e_x + 10), (int)e_y - ditor_surface->h / 2, ditor_surface->w, ditor_surface->h};  // Reduced spacing
-                SDL_RenderCopy(renderer, ditor_texture, NULL, &ditor_rect);
-                SDL_DestroyTexture(ditor_texture);
-                printf("Rendering ditor at frame %d, alpha: %.2f\n", frame, ditor_alpha);
-            }
-            SDL_FreeSurface(ditor_surface);
-            ditor_surface = NULL;
+            DrawCachedText(renderer, &ditor_text, (int)(e_x + 10), (int)e_y - ditor_text.h / 2, (Uint8)(ditor_alpha * 255));  // Reduced spacing
         }
 
         SDL_RenderPresent(renderer);
@@ -691,149 +948,938 @@ void RenderAnimation(SDL_Renderer* renderer, TTF_Font* font) {
 
         SDL_Event event;
         while (SDL_PollEvent(&event)) {
-            if (event.type == SDL_QUIT) {
+            if (event.type == SDL_QUIT || event.type == SDL_KEYDOWN || event.type == SDL_MOUSEBUTTONDOWN) {
                 frame = TOTAL_FRAMES;
             }
         }
     }
 
-    if (ocl_surface) SDL_FreeSurface(ocl_surface);
-    if (e_surface) SDL_FreeSurface(e_surface);
-    if (ditor_surface) SDL_FreeSurface(ditor_surface);
-    TTF_CloseFont(anim_font);
+    FreeCachedText(&ocl_text);
+    FreeCachedText(&e_text);
+    FreeCachedText(&ditor_text);
     printf("Animation completed\n");
 }
 
-void RenderEditorFadeIn(SDL_Renderer* renderer, TTF_Font* font, EditorState* editor, 
-                        DropdownMenu* file_menu, DropdownMenu* edit_menu, DropdownMenu* view_menu,
-                        int window_width, int window_height, int left_panel_width, int bottom_panel_height,
-                        int menu_bar_height, char* console_output) {
-    const int FADE_FRAMES = 60;
-    float alpha = 0.0f;
+double ElapsedMs(Uint64 since) {
+    return (double)(SDL_GetPerformanceCounter() - since) * 1000.0 / (double)SDL_GetPerformanceFrequency();
+}
 
-    printf("Starting editor fade-in\n");
-    for (int frame = 0; frame < FADE_FRAMES; frame++) {
-        SDL_SetRenderDrawColor(renderer, theme.bg_dark.r, theme.bg_dark.g, theme.bg_dark.b, 255);
-        SDL_RenderClear(renderer);
+// Orders paths component by component ('\\' sorts before any name character),
+// case-insensitively like the Windows file system
+int CompareEntryPaths(const char* a, const char* b) {
+    for (;; a++, b++) {
+        int ca = *a == '\\' ? 1 : tolower((unsigned char)*a);
+        int cb = *b == '\\' ? 1 : tolower((unsigned char)*b);
+        if (ca != cb || ca == 0) return ca - cb;
+    }
+}
 
-        alpha += 1.0f / FADE_FRAMES;
-        if (alpha > 1.0f) alpha = 1.0f;
-        Uint8 alpha_value = (Uint8)(alpha * 255);
+// Returns the position of `path` in the list, or where it would be inserted
+int FindEntry(FileList* list, const char* path, int* found) {
+    int lo = 0, hi = list->count;
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        int cmp = CompareEntryPaths(list->items[mid].path, path);
+        if (cmp == 0) {
+            *found = 1;
+            return mid;
+        }
+        if (cmp < 0) lo = mid + 1;
+        else hi = mid;
+    }
+    *found = 0;
+    return lo;
+}
 
-        SDL_Rect left_panel = {0, menu_bar_height, left_panel_width, window_height - menu_bar_height - bottom_panel_height};
-        SDL_SetRenderDrawColor(renderer, theme.bg_light.r, theme.bg_light.g, theme.bg_light.b, alpha_value);
-        SDL_RenderFillRect(renderer, &left_panel);
-        SDL_SetRenderDrawColor(renderer, theme.button_border.r, theme.button_border.g, theme.button_border.b, alpha_value);
-        SDL_RenderDrawRect(renderer, &left_panel);
+int PushEntry(FileList* list, const FileEntry* entry) {
+    if (list->count == list->capacity) {
+        int capacity = list->capacity ? list->capacity * 2 : 256;
+        FileEntry* items = realloc(list->items, capacity * sizeof(FileEntry));
+        if (!items) return 0;
+        list->items = items;
+        list->capacity = capacity;
+    }
+    list->items[list->count++] = *entry;
+    return 1;
+}
+
+void InsertEntry(FileList* list, const FileEntry* entry) {
+    int found;
+    int pos = FindEntry(list, entry->path, &found);
+    if (found || !PushEntry(list, entry)) return;
+    memmove(&list->items[pos + 1], &list->items[pos], (list->count - 1 - pos) * sizeof(FileEntry));
+    list->items[pos] = *entry;
+}
+
+// Removes `path` and, if it is a directory, everything below it
+void RemoveEntryTree(FileList* list, const char* path) {
+    int found;
+    int pos = FindEntry(list, path, &found);
+    if (!found) return;
+    size_t len = strlen(path);
+    int end = pos + 1;
+    while (end < list->count && _strnicmp(list->items[end].path, path, len) == 0 && list->items[end].path[len] == '\\') end++;
+    memmove(&list->items[pos], &list->items[end], (list->count - end) * sizeof(FileEntry));
+    list->count -= end - pos;
+}
+
+int IsHiddenPath(const char* rel) {
+    for (const char* p = rel; *p; p++) {
+        if (*p == '.' && (p == rel || p[-1] == '\\')) return 1;
+    }
+    return 0;
+}
+
+int CompareEntries(const void* a, const void* b) {
+    return CompareEntryPaths(((const FileEntry*)a)->path, ((const FileEntry*)b)->path);
+}
+
+int IndexStopping(FileIndex* index) {
+    return WaitForSingleObject(index->stop_event, 0) == WAIT_OBJECT_0;
+}
+
+// Walks `rel` (relative to the index root) into `out`, unsorted. Runs without the lock.
+void ScanDirectory(FileIndex* index, const char* rel, int depth, FileList* out) {
+    char pattern[MAX_PATH];
+    if (snprintf(pattern, sizeof(pattern), rel[0] ? "%s\\%s\\*" : "%s\\*", index->root, rel) >= (int)sizeof(pattern)) return;
+
+    WIN32_FIND_DATA data;
+    HANDLE find = FindFirstFile(pattern, &data);
+    if (find == INVALID_HANDLE_VALUE) return;
+    do {
+        if (data.cFileName[0] == '.') continue; // ".", ".." and hidden entries such as .git
+        FileEntry entry = {0};
+        if (snprintf(entry.path, sizeof(entry.path), rel[0] ? "%s\\%s" : "%s%s", rel, data.cFileName) >= (int)sizeof(entry.path)) continue;
+        entry.depth = depth;
+        entry.is_dir = (data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) != 0;
+        if (!PushEntry(out, &entry)) break;
+        if (entry.is_dir) ScanDirectory(index, entry.path, depth + 1, out);
+    } while (!IndexStopping(index) && FindNextFile(find, &data));
+    FindClose(find);
+}
+
+// Full walk of the workspace, swapped in under the lock once complete
+void RescanIndex(FileIndex* index) {
+    SDL_AtomicSet(&index->scanning, 1);
+    FileList fresh = {0};
+    ScanDirectory(index, "", 0, &fresh);
+    qsort(fresh.items, fresh.count, sizeof(FileEntry), CompareEntries);
+
+    SDL_LockMutex(index->lock);
+    for (int i = 0; i < fresh.count; i++) {
+        int found;
+        if (!fresh.items[i].is_dir) continue;
+        int pos = FindEntry(&index->entries, fresh.items[i].path, &found);
+        if (found) fresh.items[i].expanded = index->entries.items[pos].expanded;
+    }
+    FileList old = index->entries;
+    index->entries = fresh;
+    index->generation++;
+    SDL_UnlockMutex(index->lock);
 
-        SDL_Surface* left_text = TTF_RenderText_Solid(font, "File Explorer", theme.text);
-        if (left_text) {
-            SDL_Texture* left_texture = SDL_CreateTextureFromSurface(renderer, left_text);
-            if (left_texture) {
-                SDL_SetTextureAlphaMod(left_texture, alpha_value);
-                SDL_Rect left_text_rect = {20, menu_bar_height + 20, left_text->w, left_text->h};
-                SDL_RenderCopy(renderer, left_texture, NULL, &left_text_rect);
-                SDL_DestroyTexture(left_texture);
+    free(old.items);
+    SDL_AtomicSet(&index->scanning, 0);
+}
+
+// Applies one ReadDirectoryChangesW batch. New directories are walked before the lock is taken.
+void ApplyIndexChanges(FileIndex* index, FILE_NOTIFY_INFORMATION* info) {
+    for (;;) {
+        char rel[MAX_PATH];
+        int len = WideCharToMultiByte(CP_ACP, 0, info->FileName, info->FileNameLength / sizeof(WCHAR), rel, MAX_PATH - 1, NULL, NULL);
+        rel[len > 0 ? len : 0] = '\0';
+
+        if (len > 0 && !IsHiddenPath(rel)) {
+            if (info->Action == FILE_ACTION_REMOVED || info->Action == FILE_ACTION_RENAMED_OLD_NAME) {
+                SDL_LockMutex(index->lock);
+                RemoveEntryTree(&index->entries, rel);
+                index->generation++;
+                SDL_UnlockMutex(index->lock);
+            } else if (info->Action == FILE_ACTION_ADDED || info->Action == FILE_ACTION_RENAMED_NEW_NAME) {
+                char full[MAX_PATH];
+                snprintf(full, sizeof(full), "%s\\%s", index->root, rel);
+                DWORD attributes = GetFileAttributes(full);
+                if (attributes != INVALID_FILE_ATTRIBUTES) {
+                    FileList added = {0};
+                    FileEntry entry = {0};
+                    strcpy(entry.path, rel);
+                    for (const char* p = rel; *p; p++) entry.depth += *p == '\\';
+                    entry.is_dir = (attributes & FILE_ATTRIBUTE_DIRECTORY) != 0;
+                    PushEntry(&added, &entry);
+                    if (entry.is_dir) ScanDirectory(index, rel, entry.depth + 1, &added);
+
+                    SDL_LockMutex(index->lock);
+                    for (int i = 0; i < added.count; i++) InsertEntry(&index->entries, &added.items[i]);
+                    index->generation++;
+                    SDL_UnlockMutex(index->lock);
+                    free(added.items);
+                }
             }
-            SDL_FreeSurface(left_text);
         }
 
-        SDL_Rect bottom_panel = {0, window_height - bottom_panel_height, window_width, bottom_panel_height};
-        SDL_SetRenderDrawColor(renderer, theme.bg_light.r, theme.bg_light.g, theme.bg_light.b, alpha_value);
-        SDL_RenderFillRect(renderer, &bottom_panel);
-        SDL_SetRenderDrawColor(renderer, theme.button_border.r, theme.button_border.g, theme.button_border.b, alpha_value);
-        SDL_RenderDrawRect(renderer, &bottom_panel);
+        if (!info->NextEntryOffset) break;
+        info = (FILE_NOTIFY_INFORMATION*)((char*)info + info->NextEntryOffset);
+    }
+}
 
-        SDL_Surface* console_surface = TTF_RenderText_Blended_Wrapped(font, console_output, theme.text, bottom_panel.w - 40);
-        if (console_surface) {
-            SDL_Texture* console_texture = SDL_CreateTextureFromSurface(renderer, console_surface);
-            if (console_texture) {
-                SDL_SetTextureAlphaMod(console_texture, alpha_value);
-                SDL_Rect text_rect = {bottom_panel.x + 20, bottom_panel.y + 20, console_surface->w, console_surface->h};
-                SDL_RenderCopy(renderer, console_texture, NULL, &text_rect);
-                SDL_DestroyTexture(console_texture);
-            }
-            SDL_FreeSurface(console_surface);
+int IndexerThread(void* data) {
+    FileIndex* index = (FileIndex*)data;
+
+    // Start watching before the first walk so changes made during it are not lost
+    HANDLE dir = CreateFile(index->root, FILE_LIST_DIRECTORY, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                            NULL, OPEN_EXISTING, FILE_FLAG_BACKUP_SEMANTICS | FILE_FLAG_OVERLAPPED, NULL);
+    OVERLAPPED overlapped = {0};
+    overlapped.hEvent = CreateEvent(NULL, TRUE, FALSE, NULL);
+    DWORD buffer[16384]; // 64 KB, DWORD-aligned as ReadDirectoryChangesW requires
+    const DWORD filter = FILE_NOTIFY_CHANGE_FILE_NAME | FILE_NOTIFY_CHANGE_DIR_NAME;
+    int watching = dir != INVALID_HANDLE_VALUE && overlapped.hEvent &&
+                   ReadDirectoryChangesW(dir, buffer, sizeof(buffer), TRUE, filter, NULL, &overlapped, NULL);
+
+    RescanIndex(index);
+
+    HANDLE waits[2] = {overlapped.hEvent, index->stop_event};
+    while (watching) {
+        if (WaitForMultipleObjects(2, waits, FALSE, INFINITE) != WAIT_OBJECT_0) {
+            CancelIo(dir);
+            DWORD ignored;
+            GetOverlappedResult(dir, &overlapped, &ignored, TRUE);
+            break;
         }
+        DWORD bytes = 0;
+        if (!GetOverlappedResult(dir, &overlapped, &bytes, FALSE)) break;
+        if (bytes == 0) RescanIndex(index); // Change buffer overflowed; events were dropped
+        else ApplyIndexChanges(index, (FILE_NOTIFY_INFORMATION*)buffer);
 
-        SDL_Rect menu_bar = {0, 0, window_width, menu_bar_height};
-        SDL_SetRenderDrawColor(renderer, theme.bg_light.r, theme.bg_light.g, theme.bg_light.b, alpha_value);
-        SDL_RenderFillRect(renderer, &menu_bar);
-        SDL_SetRenderDrawColor(renderer, theme.button_border.r, theme.button_border.g, theme.button_border.b, alpha_value);
-        SDL_RenderDrawRect(renderer, &menu_bar);
+        ResetEvent(overlapped.hEvent);
+        watching = ReadDirectoryChangesW(dir, buffer, sizeof(buffer), TRUE, filter, NULL, &overlapped, NULL);
+    }
 
-        SDL_Rect run_button = {window_width - 180, 10, BUTTON_WIDTH, BUTTON_HEIGHT};
-        SDL_Color run_color = theme.accent;  // No hover during fade-in
-        RenderRoundedRect(renderer, &run_button, CORNER_RADIUS, run_color, alpha_value);
-        SDL_SetRenderDrawColor(renderer, theme.button_border.r, theme.button_border.g, theme.button_border.b, alpha_value);
-        SDL_RenderDrawRect(renderer, &run_button);
+    if (overlapped.hEvent) CloseHandle(overlapped.hEvent);
+    if (dir != INVALID_HANDLE_VALUE) CloseHandle(dir);
+    return 0;
+}
+
+int StartFileIndex(FileIndex* index, const char* root) {
+    memset(index, 0, sizeof(*index));
+    if (!GetFullPathName(root, MAX_PATH, index->root, NULL)) return 0;
+    size_t len = strlen(index->root);
+    if (len > 3 && index->root[len - 1] == '\\') index->root[len - 1] = '\0';
+    index->lock = SDL_CreateMutex();
+    index->stop_event = CreateEvent(NULL, TRUE, FALSE, NULL);
+    if (!index->lock || !index->stop_event) return 0;
+    SDL_AtomicSet(&index->scanning, 1);
+    index->thread = SDL_CreateThread(IndexerThread, "file_indexer", index);
+    if (!index->thread) SDL_AtomicSet(&index->scanning, 0);
+    return index->thread != NULL;
+}
+
+void StopFileIndex(FileIndex* index) {
+    if (index->thread) {
+        SetEvent(index->stop_event);
+        SDL_WaitThread(index->thread, NULL);
+        index->thread = NULL;
+    }
+    if (index->stop_event) CloseHandle(index->stop_event);
+    if (index->lock) SDL_DestroyMutex(index->lock);
+    free(index->entries.items);
+    memset(index, 0, sizeof(*index));
+}
+
+// Called with the index lock held
+void RebuildExplorerRows(FileIndex* index, ExplorerView* view) {
+    FileList* list = &index->entries;
+    if (view->row_capacity < list->count) {
+        int* rows = realloc(view->rows, list->count * sizeof(int));
+        if (!rows) return;
+        view->rows = rows;
+        view->row_capacity = list->count;
+    }
+    view->row_count = 0;
+    int hide_below = -1; // Depth of the collapsed directory whose subtree is being skipped
+    for (int i = 0; i < list->count; i++) {
+        FileEntry* entry = &list->items[i];
+        if (hide_below >= 0 && entry->depth > hide_below) continue;
+        hide_below = -1;
+        view->rows[view->row_count++] = i;
+        if (entry->is_dir && !entry->expanded) hide_below = entry->depth;
+    }
+    view->rows_generation = index->generation;
+    view->dirty = 0;
+    view->version++;
+}
+
+// Only the rows inside the panel are rendered; their textures are kept until the view scrolls or changes
+void RenderFileExplorer(SDL_Renderer* renderer, TTF_Font* font, FileIndex* index, ExplorerView* view, SDL_Rect* panel, int row_height) {
+    int list_top = panel->y + 50;
+    int capacity = (panel->y + panel->h - list_top) / row_height;
+    if (capacity < 0) capacity = 0;
+    if (capacity > MAX_EXPLORER_ROWS) capacity = MAX_EXPLORER_ROWS;
+
+    if (SDL_AtomicGet(&index->scanning)) {
+        DrawCachedText(renderer, &ui_cache.indexing, 20 + ui_cache.file_explorer.w + 10, panel->y + 20, 255);
+    }
+    if (!index->lock) return;
+
+    char labels[MAX_EXPLORER_ROWS][MAX_PATH + 4];
+    int depths[MAX_EXPLORER_ROWS], dirs[MAX_EXPLORER_ROWS];
+    int count = 0, refresh = 0;
+
+    SDL_LockMutex(index->lock);
+    if (view->dirty || view->rows_generation != index->generation) RebuildExplorerRows(index, view);
+    if (view->scroll_row > view->row_count - capacity) view->scroll_row = view->row_count - capacity;
+    if (view->scroll_row < 0) view->scroll_row = 0;
+    count = view->row_count - view->scroll_row;
+    if (count > capacity) count = capacity;
+    if (view->cached_version != view->version || view->cached_first != view->scroll_row || view->cached_count != count) {
+        refresh = 1;
+        for (int i = 0; i < count; i++) {
+            FileEntry* entry = &index->entries.items[view->rows[view->scroll_row + i]];
+            const char* name = strrchr(entry->path, '\\');
+            name = name ? name + 1 : entry->path;
+            snprintf(labels[i], sizeof(labels[i]), "%s %s", entry->is_dir ? (entry->expanded ? "-" : "+") : " ", name);
+            depths[i] = entry->depth;
+            dirs[i] = entry->is_dir;
+        }
+    }
+    SDL_UnlockMutex(index->lock);
+
+    if (refresh) {
+        for (int i = 0; i < view->cached_count; i++) FreeCachedText(&view->row_text[i]);
+        for (int i = 0; i < count; i++) {
+            CacheText(renderer, font, labels[i], dirs[i] ? theme.keyword : theme.text, &view->row_text[i]);
+            view->row_indent[i] = depths[i] * EXPLORER_INDENT;
+        }
+        view->cached_version = view->version;
+        view->cached_first = view->scroll_row;
+        view->cached_count = count;
+    }
+
+    SDL_Rect clip = {panel->x, list_top, panel->w, panel->y + panel->h - list_top};
+    SDL_RenderSetClipRect(renderer, &clip);
+    for (int i = 0; i < view->cached_count; i++) {
+        DrawCachedText(renderer, &view->row_text[i], panel->x + 20 + view->row_indent[i], list_top + i * row_height, 255);
+    }
+    SDL_RenderSetClipRect(renderer, NULL);
+}
+
+// Expands or collapses a directory row, or opens a file row in the editor
+void ClickFileExplorer(FileIndex* index, ExplorerView* view, EditorState* editor, SDL_Rect* panel, int row_height, int mouse_y) {
+    int list_top = panel->y + 50;
+    if (!index->lock || mouse_y < list_top || (mouse_y - list_top) / row_height >= view->cached_count) return;
+    int row = view->cached_first + (mouse_y - list_top) / row_height;
+
+    char path[MAX_PATH * 2] = "";
+    SDL_LockMutex(index->lock);
+    // Row indices are only meaningful for the generation they were built from
+    if (view->rows_generation == index->generation && !view->dirty && row < view->row_count) {
+        FileEntry* entry = &index->entries.items[view->rows[row]];
+        if (entry->is_dir) {
+            entry->expanded = !entry->expanded;
+            view->dirty = 1;
+        } else {
+            snprintf(path, sizeof(path), "%s\\%s", index->root, entry->path);
+        }
+    }
+    SDL_UnlockMutex(index->lock);
+
+    if (path[0]) LoadFileIntoEditor(editor, path);
+}
+
+void FreeExplorerView(ExplorerView* view) {
+    for (int i = 0; i < view->cached_count; i++) FreeCachedText(&view->row_text[i]);
+    free(view->rows);
+    memset(view, 0, sizeof(*view));
+}
+
+// Next match of `query` at or after `from`, wrapping to the start of the buffer; -1 if none
+int FindInBuffer(EditorState* editor, const char* query, int from) {
+    if (!query[0]) return -1;
+    const char* hit = strstr(editor->text + from, query);
+    if (!hit) hit = strstr(editor->text, query);
+    return hit ? (int)(hit - editor->text) : -1;
+}
+
+// Selects [pos, pos + len) and scrolls so its line sits near the top of the view
+void SelectRange(EditorState* editor, int pos, int len) {
+    int line = 0;
+    for (int i = 0; i < pos; i++) line += editor->text[i] == '\n';
+    editor->selection_start = pos;
+    editor->cursor_pos = pos + len;
+    editor->scroll_y = line > 3 ? (line - 3) * editor->line_height : 0;
+}
+
+void FindNext(EditorState* editor, const char* query) {
+    int pos = FindInBuffer(editor, query, editor->cursor_pos);
+    if (pos >= 0) SelectRange(editor, pos, strlen(query));
+}
 
-        SDL_Surface* run_text = TTF_RenderText_Solid(font, "Run", theme.text);
-        if (run_text) {
-            SDL_Texture* run_texture = SDL_CreateTextureFromSurface(renderer, run_text);
-            if (run_texture) {
-                SDL_SetTextureAlphaMod(run_texture, alpha_value);
-                SDL_Rect run_text_rect = {run_button.x + (BUTTON_WIDTH - run_text->w) / 2, run_button.y + 5, run_text->w, run_text->h};
-                SDL_RenderCopy(renderer, run_texture, NULL, &run_text_rect);
-                SDL_DestroyTexture(run_texture);
+// In-file search is incremental from the current match; workspace search waits for typing to pause
+void FindQueryChanged(FindBar* find, EditorState* editor) {
+    find->label_dirty = 1;
+    if (find->mode == FIND_IN_FILE) {
+        int from = editor->cursor_pos;
+        if (editor->selection_start >= 0 && editor->selection_start < from) from = editor->selection_start;
+        int pos = FindInBuffer(editor, find->query, from);
+        if (pos >= 0) SelectRange(editor, pos, strlen(find->query));
+    } else if (find->mode == FIND_IN_WORKSPACE) {
+        find->query_changed_at = SDL_GetTicks() | 1;
+    }
+}
+
+void ReleaseSearchJob(SearchJob* job) {
+    if (job && SDL_AtomicAdd(&job->refs, -1) == 1) {
+        free(job->files);
+        free(job->results);
+        free(job);
+    }
+}
+
+void AppendSearchResults(WorkspaceSearch* search, SearchJob* job, SearchResult* found, int count) {
+    SDL_LockMutex(search->lock);
+    if (!SDL_AtomicGet(&job->cancelled)) {
+        if (job->result_count + count > MAX_SEARCH_RESULTS) count = MAX_SEARCH_RESULTS - job->result_count;
+        if (job->result_count + count > job->result_capacity) {
+            int capacity = job->result_capacity ? job->result_capacity * 2 : 256;
+            while (capacity < job->result_count + count) capacity *= 2;
+            SearchResult* results = realloc(job->results, capacity * sizeof(SearchResult));
+            if (results) {
+                job->results = results;
+                job->result_capacity = capacity;
+            } else {
+                count = 0;
             }
-            SDL_FreeSurface(run_text);
         }
+        if (count > 0) {
+            memcpy(&job->results[job->result_count], found, count * sizeof(SearchResult));
+            job->result_count += count;
+        }
+        if (job->result_count >= MAX_SEARCH_RESULTS) SDL_AtomicSet(&job->next_file, job->file_count); // Full; stop claiming files
+    }
+    SDL_UnlockMutex(search->lock);
+}
 
-        SDL_Rect debug_button = {window_width - 90, 10, BUTTON_WIDTH, BUTTON_HEIGHT};
-        SDL_Color debug_color = theme.accent;  // No hover during fade-in
-        RenderRoundedRect(renderer, &debug_button, CORNER_RADIUS, debug_color, alpha_value);
-        SDL_SetRenderDrawColor(renderer, theme.button_border.r, theme.button_border.g, theme.button_border.b, alpha_value);
-        SDL_RenderDrawRect(renderer, &debug_button);
+// Scans one memory-mapped file. memchr (vectorized in the C runtime) skips to candidates for
+// the first query byte and memcmp confirms them; newlines are only counted up to each hit.
+void SearchFile(WorkspaceSearch* search, SearchJob* job, int file) {
+    HANDLE handle = CreateFile(job->files[file], GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                               NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+    if (handle == INVALID_HANDLE_VALUE) return;
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(handle, &size) || size.QuadPart < job->query_len) {
+        CloseHandle(handle);
+        return;
+    }
+    HANDLE mapping = CreateFileMapping(handle, NULL, PAGE_READONLY, 0, 0, NULL);
+    const char* data = mapping ? (const char*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : NULL;
+    if (data) {
+        const char* end = data + size.QuadPart;
+        const char* p = data;
+        const char* counted = data; // Newlines before this point are already in `line`
+        const char* line_start = data;
+        int line = 1;
+        SearchResult found[64];
+        int found_count = 0;
+
+        while (end - p >= job->query_len && !SDL_AtomicGet(&job->cancelled)) {
+            const char* hit = memchr(p, job->query[0], (end - p) - job->query_len + 1);
+            if (!hit) break;
+            if (memcmp(hit + 1, job->query + 1, job->query_len - 1) != 0) {
+                p = hit + 1;
+                continue;
+            }
+            for (const char* nl; (nl = memchr(counted, '\n', hit - counted)) != NULL; counted = nl + 1) {
+                line++;
+                line_start = nl + 1;
+            }
+            counted = hit;
+            const char* line_end = memchr(hit, '\n', end - hit);
+            if (!line_end) line_end = end;
+
+            SearchResult* result = &found[found_count++];
+            result->file = file;
+            result->line = line;
+            const char* preview = line_start;
+            while (preview < hit && (*preview == ' ' || *preview == '\t')) preview++;
+            size_t len = line_end - preview;
+            if (len >= SEARCH_PREVIEW_LENGTH) len = SEARCH_PREVIEW_LENGTH - 1;
+            for (size_t i = 0; i < len; i++) result->preview[i] = (preview[i] == '\t' || preview[i] == '\r') ? ' ' : preview[i];
+            result->preview[len] = '\0';
+
+            if (found_count == 64) {
+                AppendSearchResults(search, job, found, found_count);
+                found_count = 0;
+            }
+            p = line_end; // One result per line
+        }
+        if (found_count) AppendSearchResults(search, job, found, found_count);
+        UnmapViewOfFile(data);
+    }
+    if (mapping) CloseHandle(mapping);
+    CloseHandle(handle);
+}
+
+// Pool worker: claims files from the current job until it runs out or is cancelled, then sleeps
+int SearchWorker(void* data) {
+    WorkspaceSearch* search = (WorkspaceSearch*)data;
+    SDL_LockMutex(search->lock);
+    while (!search->quit) {
+        SearchJob* job = search->job;
+        if (!job || SDL_AtomicGet(&job->cancelled) || SDL_AtomicGet(&job->next_file) >= job->file_count) {
+            SDL_CondWait(search->wake, search->lock);
+            continue;
+        }
+        SDL_AtomicAdd(&job->refs, 1);
+        SDL_UnlockMutex(search->lock);
+
+        for (;;) {
+            int file = SDL_AtomicAdd(&job->next_file, 1);
+            if (file >= job->file_count || SDL_AtomicGet(&job->cancelled)) break;
+            SearchFile(search, job, file);
+            SDL_AtomicAdd(&job->files_done, 1);
+        }
+        ReleaseSearchJob(job);
+        SDL_LockMutex(search->lock);
+    }
+    SDL_UnlockMutex(search->lock);
+    return 0;
+}
+
+int StartWorkspaceSearch(WorkspaceSearch* search) {
+    memset(search, 0, sizeof(*search));
+    search->status_results = -1;
+    search->lock = SDL_CreateMutex();
+    search->wake = SDL_CreateCond();
+    if (!search->lock || !search->wake) return 0;
+    int threads = SDL_GetCPUCount();
+    if (threads < 1) threads = 1;
+    if (threads > MAX_SEARCH_THREADS) threads = MAX_SEARCH_THREADS;
+    for (int i = 0; i < threads; i++) {
+        search->workers[search->worker_count] = SDL_CreateThread(SearchWorker, "search_worker", search);
+        if (search->workers[search->worker_count]) search->worker_count++;
+    }
+    return search->worker_count > 0;
+}
 
-        SDL_Surface* debug_text = TTF_RenderText_Solid(font, "Debug", theme.text);
-        if (debug_text) {
-            SDL_Texture* debug_texture = SDL_CreateTextureFromSurface(renderer, debug_text);
-            if (debug_texture) {
-                SDL_SetTextureAlphaMod(debug_texture, alpha_value);
-                SDL_Rect debug_text_rect = {debug_button.x + (BUTTON_WIDTH - debug_text->w) / 2, debug_button.y + 5, debug_text->w, debug_text->h};
-                SDL_RenderCopy(renderer, debug_texture, NULL, &debug_text_rect);
-                SDL_DestroyTexture(debug_texture);
+void StopWorkspaceSearch(WorkspaceSearch* search) {
+    if (search->lock) {
+        SDL_LockMutex(search->lock);
+        search->quit = 1;
+        if (search->job) SDL_AtomicSet(&search->job->cancelled, 1);
+        SDL_CondBroadcast(search->wake);
+        SDL_UnlockMutex(search->lock);
+    }
+    for (int i = 0; i < search->worker_count; i++) SDL_WaitThread(search->workers[i], NULL);
+    ReleaseSearchJob(search->job);
+    for (int i = 0; i < search->cached_count; i++) FreeCachedText(&search->row_text[i]);
+    FreeCachedText(&search->status);
+    if (search->wake) SDL_DestroyCond(search->wake);
+    if (search->lock) SDL_DestroyMutex(search->lock);
+    memset(search, 0, sizeof(*search));
+}
+
+// Cancels the running query and starts `query` over the .ocl files currently in the index.
+// An empty query just clears the results.
+void BeginWorkspaceQuery(WorkspaceSearch* search, FileIndex* index, const char* query) {
+    static int next_serial = 1;
+    SearchJob* job = NULL;
+    if (query[0] && index->lock && search->lock) {
+        job = calloc(1, sizeof(SearchJob));
+        if (job) {
+            SDL_AtomicSet(&job->refs, 1);
+            job->serial = next_serial++;
+            strncpy(job->query, query, MAX_QUERY_LENGTH - 1);
+            job->query_len = strlen(job->query);
+
+            SDL_LockMutex(index->lock);
+            job->files = malloc((index->entries.count + 1) * sizeof(*job->files));
+            for (int i = 0; job->files && i < index->entries.count; i++) {
+                FileEntry* entry = &index->entries.items[i];
+                size_t len = strlen(entry->path);
+                if (entry->is_dir || len < 4 || _stricmp(entry->path + len - 4, ".ocl") != 0) continue;
+                if (snprintf(job->files[job->file_count], MAX_PATH, "%s\\%s", index->root, entry->path) < MAX_PATH) job->file_count++;
             }
-            SDL_FreeSurface(debug_text);
+            SDL_UnlockMutex(index->lock);
         }
+    }
 
-        SDL_Rect editor_area = {left_panel_width, menu_bar_height, window_width - left_panel_width, window_height - menu_bar_height - bottom_panel_height};
-        SDL_SetRenderDrawColor(renderer, theme.bg_dark.r, theme.bg_dark.g, theme.bg_dark.b, alpha_value);
-        SDL_RenderFillRect(renderer, &editor_area);
-        SDL_SetRenderDrawColor(renderer, theme.button_border.r, theme.button_border.g, theme.button_border.b, alpha_value);
-        SDL_RenderDrawRect(renderer, &editor_area);
+    if (!search->lock) return;
+    SDL_LockMutex(search->lock);
+    SearchJob* old = search->job;
+    if (old) SDL_AtomicSet(&old->cancelled, 1);
+    search->job = job;
+    search->scroll_row = 0;
+    search->status_results = -1;
+    SDL_CondBroadcast(search->wake);
+    SDL_UnlockMutex(search->lock);
+    ReleaseSearchJob(old);
+}
 
-        SDL_SetRenderDrawColor(renderer, theme.bg_light.r, theme.bg_light.g, theme.bg_light.b, alpha_value);
-        SDL_Rect line_num_bg = {editor_area.x, editor_area.y, 50, editor_area.h};
-        SDL_RenderFillRect(renderer, &line_num_bg);
+void RenderFindBar(SDL_Renderer* renderer, TTF_Font* font, FindBar* find, SDL_Rect* area) {
+    if (find->label_dirty) {
+        char label[MAX_QUERY_LENGTH + 32];
+        snprintf(label, sizeof(label), "%s %s_", find->mode == FIND_IN_WORKSPACE ? "Find in workspace:" : "Find:", find->query);
+        FreeCachedText(&find->label);
+        CacheText(renderer, font, label, theme.text, &find->label);
+        find->label_dirty = 0;
+    }
+    SDL_Rect bar = {area->x + area->w - 420, area->y + 8, 400, find->label.h + 12};
+    if (bar.x < area->x + 8) bar.x = area->x + 8;
+    RenderRoundedRect(renderer, &bar, CORNER_RADIUS, theme.bg_light, 255);
+    SDL_SetRenderDrawColor(renderer, theme.accent.r, theme.accent.g, theme.accent.b, 255);
+    SDL_RenderDrawRect(renderer, &bar);
+    SDL_RenderSetClipRect(renderer, &bar);
+    DrawCachedText(renderer, &find->label, bar.x + 10, bar.y + 6, 255);
+    SDL_RenderSetClipRect(renderer, NULL);
+}
 
-        // Render editor text during fade-in
-        RenderText(renderer, editor, left_panel_width + 60, menu_bar_height + 20, editor_area.w - 80, editor_area.h - 40, menu_bar_height);
+// Results stream in while workers run; only the rows that fit in the panel are rendered
+void RenderSearchResults(SDL_Renderer* renderer, TTF_Font* font, WorkspaceSearch* search, SDL_Rect* panel, int row_height) {
+    int list_top = panel->y + 10 + row_height;
+    int capacity = (panel->y + panel->h - list_top) / row_height;
+    if (capacity < 0) capacity = 0;
+    if (capacity > MAX_EXPLORER_ROWS) capacity = MAX_EXPLORER_ROWS;
+
+    char labels[MAX_EXPLORER_ROWS][MAX_PATH + SEARCH_PREVIEW_LENGTH + 16];
+    int count = 0, refresh = 0, results = 0, done = 0, total = 0, serial = 0;
+
+    SDL_LockMutex(search->lock);
+    SearchJob* job = search->job;
+    if (job) {
+        results = job->result_count;
+        done = SDL_AtomicGet(&job->files_done);
+        total = job->file_count;
+        serial = job->serial;
+        if (search->scroll_row > results - capacity) search->scroll_row = results - capacity;
+        if (search->scroll_row < 0) search->scroll_row = 0;
+        count = results - search->scroll_row;
+        if (count > capacity) count = capacity;
+        // Results are append-only, so rows already cached for this job stay valid
+        if (search->cached_serial != serial || search->cached_first != search->scroll_row || search->cached_count != count) {
+            refresh = 1;
+            for (int i = 0; i < count; i++) {
+                SearchResult* result = &job->results[search->scroll_row + i];
+                const char* name = strrchr(job->files[result->file], '\\');
+                name = name ? name + 1 : job->files[result->file];
+                snprintf(labels[i], sizeof(labels[i]), "%s:%d:  %s", name, result->line, result->preview);
+            }
+        }
+    }
+    SDL_UnlockMutex(search->lock);
+
+    if (search->status_results != results || search->status_done != done) {
+        char status[128];
+        snprintf(status, sizeof(status), "%d%s matches in %d/%d files", results, results >= MAX_SEARCH_RESULTS ? "+" : "", done, total);
+        FreeCachedText(&search->status);
+        CacheText(renderer, font, status, theme.comment, &search->status);
+        search->status_results = results;
+        search->status_done = done;
+    }
+    DrawCachedText(renderer, &search->status, panel->x + 20, panel->y + 10, 255);
+
+    if (refresh) {
+        for (int i = 0; i < search->cached_count; i++) FreeCachedText(&search->row_text[i]);
+        for (int i = 0; i < count; i++) CacheText(renderer, font, labels[i], theme.text, &search->row_text[i]);
+        search->cached_serial = serial;
+        search->cached_first = search->scroll_row;
+        search->cached_count = count;
+    }
 
-        RenderDropdownMenu(renderer, file_menu, font, -1, -1);
-        RenderDropdownMenu(renderer, edit_menu, font, -1, -1);
-        RenderDropdownMenu(renderer, view_menu, font, -1, -1);
+    SDL_Rect clip = {panel->x, list_top, panel->w, panel->y + panel->h - list_top};
+    SDL_RenderSetClipRect(renderer, &clip);
+    for (int i = 0; i < search->cached_count; i++) {
+        DrawCachedText(renderer, &search->row_text[i], panel->x + 20, list_top + i * row_height, 255);
+    }
+    SDL_RenderSetClipRect(renderer, NULL);
+}
 
-        SDL_RenderPresent(renderer);
-        SDL_Delay(1000 / 60);
+// Opens the clicked result's file and puts the cursor on the matching line
+void ClickSearchResults(WorkspaceSearch* search, EditorState* editor, SDL_Rect* panel, int row_height, int mouse_y) {
+    int list_top = panel->y + 10 + row_height;
+    if (mouse_y < list_top || (mouse_y - list_top) / row_height >= search->cached_count) return;
+    int row = search->cached_first + (mouse_y - list_top) / row_height;
+
+    char path[MAX_PATH] = "";
+    int line = 0;
+    SDL_LockMutex(search->lock);
+    SearchJob* job = search->job;
+    if (job && job->serial == search->cached_serial && row < job->result_count) {
+        strcpy(path, job->files[job->results[row].file]);
+        line = job->results[row].line;
+    }
+    SDL_UnlockMutex(search->lock);
+    if (!path[0]) return;
+
+    LoadFileIntoEditor(editor, path);
+    int pos = 0;
+    for (int current = 1; current < line && editor->text[pos]; pos++) current += editor->text[pos] == '\n';
+    int end = pos;
+    while (editor->text[end] && editor->text[end] != '\n') end++;
+    SelectRange(editor, pos, end - pos);
+}
 
-        SDL_Event event;
-        while (SDL_PollEvent(&event)) {
-            if (event.type == SDL_QUIT) {
-                frame = FADE_FRAMES;
+// Launches `main.py --check-server` with its stdin/stdout on pipes. The process stays up
+// between checks so the interpreter start-up and the parser's state are paid for once.
+int StartChecker(DiagnosticsWorker* diag) {
+    SECURITY_ATTRIBUTES sa = {sizeof(sa), NULL, TRUE};
+    HANDLE child_in = NULL, child_out = NULL;
+    if (!CreatePipe(&child_in, &diag->to_child, &sa, 65536)) return 0;
+    if (!CreatePipe(&diag->from_child, &child_out, &sa, 65536)) {
+        CloseHandle(child_in);
+        CloseHandle(diag->to_child);
+        diag->to_child = NULL;
+        return 0;
+    }
+    // Only the child's ends are inherited
+    SetHandleInformation(diag->to_child, HANDLE_FLAG_INHERIT, 0);
+    SetHandleInformation(diag->from_child, HANDLE_FLAG_INHERIT, 0);
+
+    STARTUPINFO si = {0};
+    si.cb = sizeof(si);
+    si.dwFlags = STARTF_USESTDHANDLES;
+    si.hStdInput = child_in;
+    si.hStdOutput = child_out;
+    si.hStdError = NULL;
+    PROCESS_INFORMATION pi;
+    char cmd[512];
+    snprintf(cmd, sizeof(cmd), "\"%s\" \"%s\" --check-server", PYTHON_EXE, OCL_MAIN_PY);
+    BOOL started = CreateProcess(NULL, cmd, NULL, NULL, TRUE, CREATE_NO_WINDOW, NULL, NULL, &si, &pi);
+    CloseHandle(child_in);
+    CloseHandle(child_out);
+    if (!started) {
+        StopChecker(diag);
+        return 0;
+    }
+    CloseHandle(pi.hThread);
+    diag->process = pi.hProcess;
+    return 1;
+}
+
+void StopChecker(DiagnosticsWorker* diag) {
+    if (diag->to_child) CloseHandle(diag->to_child); // EOF on stdin ends the server loop
+    if (diag->from_child) CloseHandle(diag->from_child);
+    if (diag->process) {
+        if (WaitForSingleObject(diag->process, 200) != WAIT_OBJECT_0) TerminateProcess(diag->process, 1);
+        CloseHandle(diag->process);
+    }
+    diag->process = diag->to_child = diag->from_child = NULL;
+}
+
+// Sends one buffer to the checker and reads its diagnostics up to END. Returns 0 if the
+// checker died, timed out or the editor is closing.
+int RunCheck(DiagnosticsWorker* diag, const char* text, Diagnostic* items, int* count) {
+    char header[32];
+    int len = (int)strlen(text);
+    int header_len = snprintf(header, sizeof(header), "CHECK %d\n", len);
+    DWORD written;
+    if (!WriteFile(diag->to_child, header, header_len, &written, NULL) ||
+        (len > 0 && !WriteFile(diag->to_child, text, len, &written, NULL))) return 0;
+
+    char reply[8192];
+    int reply_len = 0;
+    Uint32 started = SDL_GetTicks();
+    *count = 0;
+    for (;;) {
+        DWORD available = 0;
+        if (!PeekNamedPipe(diag->from_child, NULL, 0, NULL, &available, NULL)) return 0;
+        if (available == 0) {
+            if (SDL_GetTicks() - started > DIAG_TIMEOUT_MS) return 0;
+            SDL_LockMutex(diag->lock);
+            int quitting = diag->quit;
+            SDL_UnlockMutex(diag->lock);
+            if (quitting) return 0;
+            SDL_Delay(2);
+            continue;
+        }
+        DWORD got = 0;
+        DWORD room = (DWORD)(sizeof(reply) - 1 - reply_len);
+        if (!ReadFile(diag->from_child, reply + reply_len, available < room ? available : room, &got, NULL) || got == 0) return 0;
+        reply_len += got;
+        reply[reply_len] = '\0';
+
+        // Consume every complete line
+        char* line = reply;
+        char* newline;
+        while ((newline = strchr(line, '\n'))) {
+            *newline = '\0';
+            if (newline > line && newline[-1] == '\r') newline[-1] = '\0';
+            if (strcmp(line, "END") == 0) return 1;
+            Diagnostic d;
+            char severity;
+            int consumed = 0;
+            if (*count < MAX_DIAGNOSTICS && sscanf(line, "%c %d %d %n", &severity, &d.line, &d.column, &consumed) == 3) {
+                d.is_error = severity == 'E';
+                strncpy(d.message, line + consumed, sizeof(d.message) - 1);
+                d.message[sizeof(d.message) - 1] = '\0';
+                items[(*count)++] = d;
             }
+            line = newline + 1;
+        }
+        reply_len -= (int)(line - reply);
+        memmove(reply, line, reply_len);
+        if (reply_len >= (int)sizeof(reply) - 1) reply_len = 0; // Overlong line, drop it
+    }
+}
+
+int DiagnosticsThread(void* data) {
+    DiagnosticsWorker* diag = (DiagnosticsWorker*)data;
+    static char text[MAX_TEXT_LENGTH];
+    Diagnostic items[MAX_DIAGNOSTICS];
+    int done_revision = 0;
+    for (;;) {
+        SDL_LockMutex(diag->lock);
+        while (!diag->quit && diag->pending_revision == done_revision) SDL_CondWait(diag->wake, diag->lock);
+        if (diag->quit) {
+            SDL_UnlockMutex(diag->lock);
+            break;
+        }
+        int revision = diag->pending_revision;
+        memcpy(text, diag->pending, sizeof(text));
+        SDL_UnlockMutex(diag->lock);
+
+        if (!diag->process && !StartChecker(diag)) {
+            // No Python available: stop trying until the next edit
+            done_revision = revision;
+            continue;
+        }
+        int count = 0;
+        if (!RunCheck(diag, text, items, &count)) {
+            // Hung or crashed: kill it, the next revision starts a fresh one
+            StopChecker(diag);
+            done_revision = revision;
+            continue;
         }
-        printf("Fade-in frame %d, alpha: %.2f\n", frame, alpha);
+        SDL_LockMutex(diag->lock);
+        if (diag->pending_revision == revision) {  // Otherwise the text changed meanwhile, drop it
+            memcpy(diag->items, items, count * sizeof(Diagnostic));
+            diag->count = count;
+            diag->result_revision = revision;
+        }
+        SDL_UnlockMutex(diag->lock);
+        done_revision = revision;
+    }
+    StopChecker(diag);
+    return 0;
+}
+
+int StartDiagnostics(DiagnosticsWorker* diag) {
+    memset(diag, 0, sizeof(*diag));
+    diag->lock = SDL_CreateMutex();
+    diag->wake = SDL_CreateCond();
+    if (!diag->lock || !diag->wake) return 0;
+    diag->thread = SDL_CreateThread(DiagnosticsThread, "diagnostics", diag);
+    return diag->thread != NULL;
+}
+
+void StopDiagnostics(DiagnosticsWorker* diag) {
+    if (diag->lock) {
+        SDL_LockMutex(diag->lock);
+        diag->quit = 1;
+        SDL_CondSignal(diag->wake);
+        SDL_UnlockMutex(diag->lock);
+    }
+    if (diag->thread) SDL_WaitThread(diag->thread, NULL);
+    for (int i = 0; i < diag->shown_count; i++) FreeCachedText(&diag->messages[i]);
+    if (diag->wake) SDL_DestroyCond(diag->wake);
+    if (diag->lock) SDL_DestroyMutex(diag->lock);
+    memset(diag, 0, sizeof(*diag));
+}
+
+// Called once per frame: submits the buffer once typing pauses and picks up new results.
+void UpdateDiagnostics(DiagnosticsWorker* diag, EditorState* editor) {
+    if (!diag->thread) return;
+    Uint32 now = SDL_GetTicks();
+    if (strcmp(editor->text, diag->seen) != 0) {
+        strcpy(diag->seen, editor->text);
+        diag->changed_at = now ? now : 1;
+    }
+    if (diag->changed_at && now - diag->changed_at >= DIAG_DEBOUNCE_MS) {
+        SDL_LockMutex(diag->lock);
+        strcpy(diag->pending, diag->seen);
+        diag->pending_revision++;
+        SDL_CondSignal(diag->wake);
+        SDL_UnlockMutex(diag->lock);
+        diag->changed_at = 0;
+    }
+
+    SDL_LockMutex(diag->lock);
+    if (diag->result_revision != diag->shown_revision) {
+        for (int i = 0; i < diag->shown_count; i++) FreeCachedText(&diag->messages[i]);
+        memcpy(diag->shown, diag->items, diag->count * sizeof(Diagnostic));
+        diag->shown_count = diag->count;
+        diag->shown_revision = diag->result_revision;
+    }
+    SDL_UnlockMutex(diag->lock);
+}
+
+// Draws a gutter marker, an underline from the reported column and the message after the
+// end of each diagnosed line. Uses RenderText's fixed 10px advance and line layout.
+void RenderDiagnostics(SDL_Renderer* renderer, TTF_Font* font, DiagnosticsWorker* diag, EditorState* editor, int x, int y, int height, int menu_bar_height) {
+    if (diag->shown_count == 0) return;
+    int first_line = editor->scroll_y / editor->line_height + 1;
+    int last_line = (editor->scroll_y + height) / editor->line_height + 1;
+
+    // One pass over the buffer for the lengths of the visible lines
+    static int line_lengths[1024];
+    int visible = last_line - first_line + 1;
+    if (visible > 1024) visible = 1024;
+    int line = 1, len = 0;
+    for (const char* p = editor->text;; p++) {
+        if (*p == '\n' || *p == '\0') {
+            if (line >= first_line && line < first_line + visible) line_lengths[line - first_line] = len;
+            if (*p == '\0' || ++line >= first_line + visible) break;
+            len = 0;
+        } else {
+            len++;
+        }
+    }
+
+    int previous_line = 0;
+    for (int i = 0; i < diag->shown_count; i++) {
+        Diagnostic* d = &diag->shown[i];
+        if (d->line < first_line || d->line >= first_line + visible || d->line > line) continue;
+        int row_y = y + (d->line - 1) * editor->line_height - editor->scroll_y;
+        if (row_y < menu_bar_height) continue;
+        SDL_Color color = d->is_error ? theme.error : theme.warning;
+        int line_len = line_lengths[d->line - first_line];
+
+        SDL_SetRenderDrawColor(renderer, color.r, color.g, color.b, 255);
+        SDL_Rect marker = {x - 60, row_y, 3, editor->line_height};
+        SDL_RenderFillRect(renderer, &marker);
+
+        int column = d->column > 0 ? d->column - 1 : 0;
+        if (column > line_len) column = line_len;
+        int underline_w = (line_len - column) * 10;
+        if (underline_w < 10) underline_w = 10;
+        SDL_Rect underline = {x + column * 10, row_y + editor->line_height - 2, underline_w, 2};
+        SDL_RenderFillRect(renderer, &underline);
+
+        // Only the first message on a line fits after it
+        if (d->line == previous_line) continue;
+        previous_line = d->line;
+        if (!diag->messages[i].texture) CacheText(renderer, font, d->message, color, &diag->messages[i]);
+        DrawCachedText(renderer, &diag->messages[i], x + line_len * 10 + 20, row_y, 200);
     }
-    printf("Editor fade-in completed\n");
 }
 
 int main(int argc, char* argv[]) {
+    Uint64 startup_start = SDL_GetPerformanceCounter();
+    int benchmark_startup = 0, show_splash = 1;
+    const char* workspace = ".";
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--benchmark-startup") == 0) {
+            benchmark_startup = 1;
+            show_splash = 0;
+        } else if (strcmp(argv[i], "--no-splash") == 0) {
+            show_splash = 0;
+        } else if (strcmp(argv[i], "--workspace") == 0 && i + 1 < argc) {
+            workspace = argv[++i];
+        }
+    }
+
     if (SDL_Init(SDL_INIT_VIDEO) < 0 || TTF_Init() < 0) {
         printf("Initialization failed: %s\n", SDL_GetError());
         return 1;
     }
+    double init_ms = ElapsedMs(startup_start);
 
     int window_width = 1000, window_height = 600;  // Reduced height from 800 to 600
     SDL_Window* window = SDL_CreateWindow("OCL Editor - Enhanced OCL Support", SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED,
@@ -855,6 +1901,8 @@ int main(int argc, char* argv[]) {
         return 1;
     }
 
+    double window_ms = ElapsedMs(startup_start);
+
     TTF_Font* font = TTF_OpenFont("C:\\Windows\\Fonts\\consola.ttf", 14);
     if (!font) font = TTF_OpenFont("C:\\Windows\\Fonts\\arial.ttf", 14);
     if (!font) {
@@ -866,21 +1914,45 @@ int main(int argc, char* argv[]) {
         return 1;
     }
 
+    double font_ms = ElapsedMs(startup_start);
+
+    // Index the workspace in the background while the splash and UI come up
+    FileIndex file_index;
+    ExplorerView explorer = {0};
+    explorer.cached_version = -1;
+    if (!StartFileIndex(&file_index, workspace)) {
+        printf("File indexer failed to start for %s\n", workspace);
+    }
+    int explorer_row_height = TTF_FontHeight(font) + EXPLORER_ROW_PADDING;
+    WorkspaceSearch search;
+    if (!StartWorkspaceSearch(&search)) {
+        printf("Workspace search threads failed to start\n");
+    }
+    FindBar find = {0};
+    static DiagnosticsWorker diagnostics;
+    if (!StartDiagnostics(&diagnostics)) {
+        printf("Diagnostics thread failed to start\n");
+    }
+
     InitTheme();
-    printf("Running animation\n");
-    RenderAnimation(renderer, font);
+    if (show_splash) {
+        printf("Running animation\n");
+        RenderAnimation(renderer);
+    }
+    double splash_ms = ElapsedMs(startup_start);
 
     EditorState editor;
     InitEditorState(&editor, font);
     DropdownMenu file_menu, edit_menu, view_menu;
     InitMenus(&file_menu, &edit_menu, &view_menu);
+    DropdownMenu* menus[] = {&file_menu, &edit_menu, &view_menu};
+    BuildUiCache(renderer, font, menus, 3);
+    double ui_cache_ms = ElapsedMs(startup_start);
 
     int left_panel_width = 250, bottom_panel_height = 150, menu_bar_height = 50;  // Adjusted bottom panel height
     char console_output[1024] = "> OCL Editor Enhanced - Ready\n";
-    printf("Running editor fade-in\n");
-    RenderEditorFadeIn(renderer, font, &editor, &file_menu, &edit_menu, &view_menu,
-                       window_width, window_height, left_panel_width, bottom_panel_height,
-                       menu_bar_height, console_output);
+    Uint32 fade_start = SDL_GetTicks();
+    int first_frame_shown = 0;
 
     SDL_Cursor* resize_cursor_hor = SDL_CreateSystemCursor(SDL_SYSTEM_CURSOR_SIZEWE);
     SDL_Cursor* resize_cursor_ver = SDL_CreateSystemCursor(SDL_SYSTEM_CURSOR_SIZENS);
@@ -902,7 +1974,27 @@ int main(int argc, char* argv[]) {
             switch (event.type) {
                 case SDL_QUIT: quit = 1; break;
                 case SDL_KEYDOWN:
-                    if (event.key.keysym.sym == SDLK_F11) ToggleFullscreen(window);
+                    if (event.key.keysym.sym == SDLK_f && (event.key.keysym.mod & KMOD_CTRL)) {
+                        find.mode = (event.key.keysym.mod & KMOD_SHIFT) ? FIND_IN_WORKSPACE : FIND_IN_FILE;
+                        FindQueryChanged(&find, &editor);
+                        break;
+                    }
+                    if (find.mode != FIND_CLOSED) {
+                        size_t query_len = strlen(find.query);
+                        if (event.key.keysym.sym == SDLK_ESCAPE) find.mode = FIND_CLOSED;
+                        else if (event.key.keysym.sym == SDLK_BACKSPACE && query_len > 0) {
+                            find.query[query_len - 1] = '\0';
+                            FindQueryChanged(&find, &editor);
+                        }
+                        else if (event.key.keysym.sym == SDLK_RETURN || event.key.keysym.sym == SDLK_KP_ENTER || event.key.keysym.sym == SDLK_F3) {
+                            if (find.mode == FIND_IN_FILE) FindNext(&editor, find.query);
+                        }
+                        break;
+                    }
+                    if (event.key.keysym.sym == SDLK_F3) FindNext(&editor, find.query);
+                    else if (event.key.keysym.sym == SDLK_ESCAPE && search.job) BeginWorkspaceQuery(&search, &file_index, "");
+                    else if (event.key.keysym.sym == SDLK_F11) ToggleFullscreen(window);
+                    else if (event.key.keysym.sym == SDLK_F5) RunLive(&editor, console_output);
                     else if (event.key.keysym.sym == SDLK_BACKSPACE) DeleteText(&editor);
                     else if (event.key.keysym.sym == SDLK_RETURN || event.key.keysym.sym == SDLK_KP_ENTER) InsertText(&editor, "\n");
                     else if (event.key.keysym.sym == SDLK_TAB) InsertText(&editor, "    ");
@@ -965,7 +2057,17 @@ int main(int argc, char* argv[]) {
                         }
                     }
                     break;
-                case SDL_TEXTINPUT: InsertText(&editor, event.text.text); break;
+                case SDL_TEXTINPUT:
+                    if (find.mode != FIND_CLOSED) {
+                        size_t query_len = strlen(find.query);
+                        if (query_len + strlen(event.text.text) < MAX_QUERY_LENGTH) {
+                            strcat(find.query, event.text.text);
+                            FindQueryChanged(&find, &editor);
+                        }
+                    } else {
+                        InsertText(&editor, event.text.text);
+                    }
+                    break;
                 case SDL_MOUSEBUTTONDOWN:
                     if (event.button.button == SDL_BUTTON_LEFT) {
                         if (abs(mouse_x - left_panel_width) < EDGE_MARGIN && mouse_y > menu_bar_height) resizing_left_panel = 1;
@@ -992,6 +2094,13 @@ int main(int argc, char* argv[]) {
                                 }
                             }
                             if (!SDL_PointInRect(&(SDL_Point){mouse_x, mouse_y}, &active_menu->rect)) active_menu->open = 0;
+                        } else if (search.job && mouse_y > window_height - bottom_panel_height) {
+                            SDL_Rect bottom_panel = {0, window_height - bottom_panel_height, window_width, bottom_panel_height};
+                            ClickSearchResults(&search, &editor, &bottom_panel, explorer_row_height, mouse_y);
+                            find.mode = FIND_CLOSED;
+                        } else if (mouse_x < left_panel_width && mouse_y < window_height - bottom_panel_height) {
+                            SDL_Rect left_panel = {0, menu_bar_height, left_panel_width, window_height - menu_bar_height - bottom_panel_height};
+                            ClickFileExplorer(&file_index, &explorer, &editor, &left_panel, explorer_row_height, mouse_y);
                         } else if (mouse_x >= left_panel_width && mouse_x <= window_width &&
                                    mouse_y >= menu_bar_height && mouse_y <= window_height - bottom_panel_height) {
                             int editor_x = left_panel_width + 60;
@@ -1011,6 +2120,7 @@ int main(int argc, char* argv[]) {
                                    (pos - (pos - strlen(&editor.text[pos]))) * 10 < rel_x) pos++;
                             editor.cursor_pos = pos;
                             editor.selection_start = -1;
+                            find.mode = FIND_CLOSED;
                         }
                     }
                     break;
@@ -1036,6 +2146,14 @@ int main(int argc, char* argv[]) {
                     }
                     break;
                 case SDL_MOUSEWHEEL:
+                    if (mouse_x < left_panel_width && mouse_y > menu_bar_height && mouse_y < window_height - bottom_panel_height) {
+                        explorer.scroll_row -= event.wheel.y * 3; // Clamped when the panel is drawn
+                        break;
+                    }
+                    if (search.job && mouse_y > window_height - bottom_panel_height) {
+                        search.scroll_row -= event.wheel.y * 3;
+                        break;
+                    }
                     editor.scroll_y -= event.wheel.y * SCROLL_SPEED;
                     if (editor.scroll_y < 0) editor.scroll_y = 0;
                     break;
@@ -1048,6 +2166,12 @@ int main(int argc, char* argv[]) {
             }
         }
 
+        if (find.mode == FIND_IN_WORKSPACE && find.query_changed_at && SDL_GetTicks() - find.query_changed_at >= SEARCH_DEBOUNCE_MS) {
+            BeginWorkspaceQuery(&search, &file_index, find.query);
+            find.query_changed_at = 0;
+        }
+        UpdateDiagnostics(&diagnostics, &editor);
+
         SDL_SetRenderDrawColor(renderer, theme.bg_dark.r, theme.bg_dark.g, theme.bg_dark.b, 255);
         SDL_RenderClear(renderer);
 
@@ -1057,16 +2181,8 @@ int main(int argc, char* argv[]) {
         SDL_SetRenderDrawColor(renderer, theme.button_border.r, theme.button_border.g, theme.button_border.b, 255);
         SDL_RenderDrawRect(renderer, &left_panel);
 
-        SDL_Surface* left_text = TTF_RenderText_Solid(font, "File Explorer", theme.text);
-        if (left_text) {
-            SDL_Texture* left_texture = SDL_CreateTextureFromSurface(renderer, left_text);
-            if (left_texture) {
-                SDL_Rect left_text_rect = {20, menu_bar_height + 20, left_text->w, left_text->h};
-                SDL_RenderCopy(renderer, left_texture, NULL, &left_text_rect);
-                SDL_DestroyTexture(left_texture);
-            }
-            SDL_FreeSurface(left_text);
-        }
+        DrawCachedText(renderer, &ui_cache.file_explorer, 20, menu_bar_height + 20, 255);
+        RenderFileExplorer(renderer, font, &file_index, &explorer, &left_panel, explorer_row_height);
 
         SDL_Rect bottom_panel = {0, window_height - bottom_panel_height, window_width, bottom_panel_height};
         SDL_SetRenderDrawColor(renderer, theme.bg_light.r, theme.bg_light.g, theme.bg_light.b, 255);
@@ -1074,16 +2190,8 @@ int main(int argc, char* argv[]) {
         SDL_SetRenderDrawColor(renderer, theme.button_border.r, theme.button_border.g, theme.button_border.b, 255);
         SDL_RenderDrawRect(renderer, &bottom_panel);
 
-        SDL_Surface* console_surface = TTF_RenderText_Blended_Wrapped(font, console_output, theme.text, bottom_panel.w - 40);
-        if (console_surface) {
-            SDL_Texture* console_texture = SDL_CreateTextureFromSurface(renderer, console_surface);
-            if (console_texture) {
-                SDL_Rect text_rect = {bottom_panel.x + 20, bottom_panel.y + 20, console_surface->w, console_surface->h};
-                SDL_RenderCopy(renderer, console_texture, NULL, &text_rect);
-                SDL_DestroyTexture(console_texture);
-            }
-            SDL_FreeSurface(console_surface);
-        }
+        if (search.job) RenderSearchResults(renderer, font, &search, &bottom_panel, explorer_row_height);
+        else RenderConsole(renderer, font, console_output, &bottom_panel);
 
         SDL_Rect menu_bar = {0, 0, window_width, menu_bar_height};
         SDL_SetRenderDrawColor(renderer, theme.bg_light.r, theme.bg_light.g, theme.bg_light.b, 255);
@@ -1097,16 +2205,7 @@ int main(int argc, char* argv[]) {
         SDL_SetRenderDrawColor(renderer, theme.button_border.r, theme.button_border.g, theme.button_border.b, 255);
         SDL_RenderDrawRect(renderer, &run_button);
 
-        SDL_Surface* run_text = TTF_RenderText_Solid(font, "Run", theme.text);
-        if (run_text) {
-            SDL_Texture* run_texture = SDL_CreateTextureFromSurface(renderer, run_text);
-            if (run_texture) {
-                SDL_Rect run_text_rect = {run_button.x + (BUTTON_WIDTH - run_text->w) / 2, run_button.y + 5, run_text->w, run_text->h};
-                SDL_RenderCopy(renderer, run_texture, NULL, &run_text_rect);
-                SDL_DestroyTexture(run_texture);
-            }
-            SDL_FreeSurface(run_text);
-        }
+        DrawCachedText(renderer, &ui_cache.run, run_button.x + (BUTTON_WIDTH - ui_cache.run.w) / 2, run_button.y + 5, 255);
 
         SDL_Rect debug_button = {window_width - 90, 10, BUTTON_WIDTH, BUTTON_HEIGHT};
         SDL_Color debug_color = SDL_PointInRect(&(SDL_Point){mouse_x, mouse_y}, &debug_button) ? theme.hover : theme.accent;
@@ -1114,16 +2213,7 @@ int main(int argc, char* argv[]) {
         SDL_SetRenderDrawColor(renderer, theme.button_border.r, theme.button_border.g, theme.button_border.b, 255);
         SDL_RenderDrawRect(renderer, &debug_button);
 
-        SDL_Surface* debug_text = TTF_RenderText_Solid(font, "Debug", theme.text);
-        if (debug_text) {
-            SDL_Texture* debug_texture = SDL_CreateTextureFromSurface(renderer, debug_text);
-            if (debug_texture) {
-                SDL_Rect debug_text_rect = {debug_button.x + (BUTTON_WIDTH - debug_text->w) / 2, debug_button.y + 5, debug_text->w, debug_text->h};
-                SDL_RenderCopy(renderer, debug_texture, NULL, &debug_text_rect);
-                SDL_DestroyTexture(debug_texture);
-            }
-            SDL_FreeSurface(debug_text);
-        }
+        DrawCachedText(renderer, &ui_cache.debug, debug_button.x + (BUTTON_WIDTH - ui_cache.debug.w) / 2, debug_button.y + 5, 255);
 
         SDL_Rect editor_area = {left_panel_width, menu_bar_height, window_width - left_panel_width, window_height - menu_bar_height - bottom_panel_height};
         SDL_SetRenderDrawColor(renderer, theme.bg_dark.r, theme.bg_dark.g, theme.bg_dark.b, 255);
@@ -1132,18 +2222,53 @@ int main(int argc, char* argv[]) {
         SDL_RenderDrawRect(renderer, &editor_area);
 
         RenderText(renderer, &editor, left_panel_width + 60, menu_bar_height + 20, editor_area.w - 80, editor_area.h - 40, menu_bar_height);
-
-        RenderDropdownMenu(renderer, &file_menu, font, mouse_x, mouse_y);
-        RenderDropdownMenu(renderer, &edit_menu, font, mouse_x, mouse_y);
-        RenderDropdownMenu(renderer, &view_menu, font, mouse_x, mouse_y);
+        RenderDiagnostics(renderer, font, &diagnostics, &editor, left_panel_width + 60, menu_bar_height + 20, editor_area.h - 40, menu_bar_height);
+        if (find.mode != FIND_CLOSED) RenderFindBar(renderer, font, &find, &editor_area);
+
+        RenderDropdownMenu(renderer, &file_menu, mouse_x, mouse_y);
+        RenderDropdownMenu(renderer, &edit_menu, mouse_x, mouse_y);
+        RenderDropdownMenu(renderer, &view_menu, mouse_x, mouse_y);
+
+        // Fade in by covering the finished frame, so input works from the first frame
+        Uint32 fade_elapsed = SDL_GetTicks() - fade_start;
+        if (fade_elapsed < EDITOR_FADE_MS) {
+            SDL_BlendMode blend_mode;
+            SDL_GetRenderDrawBlendMode(renderer, &blend_mode);
+            SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_BLEND);
+            SDL_SetRenderDrawColor(renderer, theme.bg_dark.r, theme.bg_dark.g, theme.bg_dark.b, (Uint8)(255 - fade_elapsed * 255 / EDITOR_FADE_MS));
+            SDL_RenderFillRect(renderer, NULL);
+            SDL_SetRenderDrawBlendMode(renderer, blend_mode);
+        }
 
         SDL_RenderPresent(renderer);
+
+        if (!first_frame_shown) {
+            first_frame_shown = 1;
+            if (benchmark_startup) {
+                double first_frame_ms = ElapsedMs(startup_start);
+                printf("Startup benchmark (ms, cumulative):\n");
+                printf("  SDL + TTF init       %8.2f\n", init_ms);
+                printf("  window + renderer    %8.2f\n", window_ms);
+                printf("  font                 %8.2f\n", font_ms);
+                printf("  splash               %8.2f (skipped)\n", splash_ms);
+                printf("  UI text cache        %8.2f\n", ui_cache_ms);
+                printf("  first editable frame %8.2f\n", first_frame_ms);
+                quit = 1;
+            }
+        }
         SDL_Delay(16);
     }
 
     if (resize_cursor_hor) SDL_FreeCursor(resize_cursor_hor);
     if (resize_cursor_ver) SDL_FreeCursor(resize_cursor_ver);
     if (default_cursor) SDL_FreeCursor(default_cursor);
+    StopWorkspaceSearch(&search);
+    StopDiagnostics(&diagnostics);
+    if (live_process) CloseHandle(live_process); // The session keeps running on its own
+    FreeCachedText(&find.label);
+    StopFileIndex(&file_index);
+    FreeExplorerView(&explorer);
+    FreeUiCache(menus, 3);
     TTF_CloseFont(font);
     SDL_DestroyRenderer(renderer);
     SDL_DestroyWindow(window);
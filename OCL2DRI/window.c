@@ -1,7 +1,22 @@
 #include <SDL3/SDL.h>
+#include <SDL3_ttf/SDL_ttf.h>
 #include <stdbool.h>
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define OCL2DRI_X86 1
+#include <immintrin.h>
+// GCC and Clang only emit SSE/AVX inside functions marked for it; MSVC always can
+#if defined(__GNUC__) || defined(__clang__)
+#define OCL2DRI_TARGET_SSE __attribute__((target("sse")))
+#define OCL2DRI_TARGET_AVX __attribute__((target("avx")))
+#else
+#define OCL2DRI_TARGET_SSE
+#define OCL2DRI_TARGET_AVX
+#endif
+#endif
 
 #ifdef _WIN32
 #define EXPORT __declspec(dllexport)
@@ -9,29 +24,1177 @@
 #define EXPORT
 #endif
 
+#define OCL2DRI_MAX_QUEUE_DEPTH 3
+#define OCL2DRI_COMMAND_LIST_COUNT (OCL2DRI_MAX_QUEUE_DEPTH + 1)
+
+// Input recordings: "OCLI", a little-endian u32 version, then one record per frame:
+// f32 delta_time, f32 mouse_x, f32 mouse_y, u8 mouse buttons, u16 change count and that
+// many u16 key changes (scancode, high bit set for down). Unchanged keys cost nothing.
+#define OCL2DRI_INPUT_MAGIC "OCLI"
+#define OCL2DRI_INPUT_VERSION 1
+#define OCL2DRI_KEY_DOWN_BIT 0x8000
+
+#define OCL2DRI_FRAME_HISTORY 1024      // Frames kept for ocl2dri_get_frame_stats
+#define OCL2DRI_DEADLINE_SLACK_NS 1000000 // Vsync rounding allowed before a frame counts as missed
+#define OCL2DRI_OVERLAY_FRAMES 120      // Bars drawn by the stats overlay
+
+#define OCL2DRI_TILE_CHUNK 32           // Tilemap chunks are 32x32 tiles
+#define OCL2DRI_TILE_KINDS 256          // Tile ids are bytes; 0 is empty
+
+#define OCL2DRI_MAX_FONTS 16
+#define OCL2DRI_ATLAS_SIZE 1024         // Glyph atlas pages are square
+#define OCL2DRI_GLYPH_SLOTS 1024        // Open-addressed codepoint table per font
+#define OCL2DRI_TEXT_CACHE_SETS 128     // Shaped strings: 128 sets of 4, LRU within a set
+#define OCL2DRI_TEXT_CACHE_WAYS 4
+
+#define OCL2DRI_MAX_EMITTERS 64
+#define OCL2DRI_MAX_PARTICLE_DT 0.1f    // Longer frames (e.g. a stall) are simulated as this
+
+#define OCL2DRI_MAX_TEXTURES 4096
+#define OCL2DRI_MAX_LAYERS 16
+#define OCL2DRI_RECT_BATCH 256          // Most rects per SDL_RenderFillRects/SDL_RenderRects call
+#define OCL2DRI_MAX_ASSET_WORKERS 4
+#define OCL2DRI_UPLOAD_BUDGET_NS 2000000  // Default time per frame for texture uploads
+
+typedef enum {
+    OCL2DRI_CMD_FILL_RECT,
+    OCL2DRI_CMD_DRAW_RECT,
+    OCL2DRI_CMD_DRAW_LINE,
+    OCL2DRI_CMD_TILEMAP,
+    OCL2DRI_CMD_TEXT,
+    OCL2DRI_CMD_PARTICLES,
+    OCL2DRI_CMD_TEXTURE,
+    OCL2DRI_CMD_LAYER
+} OCL2DRI_CommandType;
+
+typedef struct OCL2DRI_Tilemap OCL2DRI_Tilemap;
+
+typedef struct {
+    OCL2DRI_CommandType type;
+    Uint8 r, g, b, a;
+    float x, y, w, h;  // DRAW_LINE stores x1, y1, x2, y2; TILEMAP the scroll in x, y
+    void* resource;    // TILEMAP, PARTICLES: NULL once destroyed; TEXT: the atlas page; TEXTURE: the slot; LAYER: the layer
+    int first, count;  // TEXT, PARTICLES: range of the list's vertices
+    int depth;         // From ocl2dri_set_depth; lists are sorted by it before submission
+} OCL2DRI_Command;
+
+// Runs of one tile id within a chunk, stored contiguously in the chunk's rects.
+typedef struct {
+    Uint8 tile;
+    int first, count;
+} OCL2DRI_TileGroup;
+
+// Prebuilt geometry for OCL2DRI_TILE_CHUNK x OCL2DRI_TILE_CHUNK tiles: horizontal runs
+// of equal tiles as map-space rects, grouped by tile so each group is one fill call.
+typedef struct {
+    SDL_FRect* rects;
+    int rect_count, rect_capacity;
+    OCL2DRI_TileGroup* groups;
+    int group_count;
+    bool dirty;
+} OCL2DRI_TileChunk;
+
+// A retained tile layer. Tiles are palette indices; geometry is rebuilt per chunk,
+// only for chunks that changed and only when they are next drawn on screen.
+struct OCL2DRI_Tilemap {
+    struct OCL2DRI_Context* ctx;
+    int width, height;       // In tiles
+    float tile_w, tile_h;
+    Uint8* tiles;
+    int chunks_x, chunks_y;
+    OCL2DRI_TileChunk* chunks;
+    SDL_Color palette[OCL2DRI_TILE_KINDS];
+    SDL_FRect* scratch;      // Visible rects shifted by the scroll offset
+    int scratch_capacity;
+};
+
+// A particle emitter. Particles are stored as parallel arrays so the update kernels
+// can stream through them SIMD-width at a time; dead ones are swapped off the end.
+typedef struct {
+    struct OCL2DRI_Context* ctx;
+    int capacity, count;
+    float *x, *y, *vx, *vy;
+    float *life;      // Seconds left
+    float *inv_life;  // 1 / lifetime at spawn
+    float *fade;      // life * inv_life: 1 at birth, 0 at death; picks the colour
+    int* indices;     // Two triangles per particle, built once for the whole capacity
+    float pos_x, pos_y;
+    int depth;               // The draw depth when created; every frame's particles go there
+    float rate, spawn_debt;  // Particles per second, fractional particles owed
+    float angle, spread;     // Radians
+    float speed_min, speed_max;
+    float life_min, life_max;
+    float gravity_x, gravity_y;
+    float size;
+    SDL_FColor start_color, end_color;
+    Uint32 rng;
+} OCL2DRI_Emitter;
+
+typedef void (*OCL2DRI_ParticleKernel)(OCL2DRI_Emitter* e, float dt);
+
+typedef enum {
+    OCL2DRI_TEXTURE_QUEUED,   // Waiting for or being decoded by a worker
+    OCL2DRI_TEXTURE_DECODED,  // Surface ready, waiting for upload
+    OCL2DRI_TEXTURE_READY,
+    OCL2DRI_TEXTURE_FAILED
+} OCL2DRI_TextureState;
+
+// A texture from ocl2dri_load_texture_async. `state` and `surface` are shared with the
+// workers and guarded by asset_mutex; `texture` is only touched where the renderer lives.
+typedef struct {
+    char* path;
+    OCL2DRI_TextureState state;
+    SDL_Surface* surface;
+    SDL_Texture* texture;
+} OCL2DRI_TextureSlot;
+
+// FIFO of texture handles.
+typedef struct {
+    int* items;
+    int head, count, capacity;
+} OCL2DRI_HandleQueue;
+
+// Table slot for one cell. Building touches only slots, one cache line per entry.
+typedef struct {
+    int cx, cy;
+    int index;  // Into `cells`; -1 when empty
+    int fill;   // While building: entries counted, then the next write position
+} OCL2DRI_GridSlot;
+
+// One occupied grid cell: its coordinates and its run of entity ids in `entries`.
+typedef struct {
+    int cx, cy;
+    int first, count;
+} OCL2DRI_GridCell;
+
+// Broadphase over axis-aligned boxes, rebuilt in bulk from a packed x, y, w, h array.
+// Only occupied cells exist; they are found through an open-addressed table keyed by
+// cell coordinates, so the world has no bounds. Entity ids are indices into the array.
 typedef struct {
+    float cell_size, inv_cell_size;
+    float* boxes;         // Copy of the last update
+    int count, box_capacity;
+    OCL2DRI_GridCell* cells;
+    int cell_count, cell_capacity;
+    OCL2DRI_GridSlot* slots;
+    int slot_mask;
+    int* entries;         // Entity ids grouped by cell; a box spanning cells is in each
+    float* entry_boxes;   // The box of each entry, so pair tests read memory in order
+    int* entry_cells;     // Scratch for update: the slot of each entry in id order
+    int entry_capacity;
+    Uint32* stamps;       // Per entity, the last rect query that looked at it
+    int stamp_capacity;
+    Uint32 stamp;
+} OCL2DRI_SpatialHash;
+
+typedef struct {
+    Uint32 codepoint;
+    bool used;
+    SDL_Rect rect;  // In the atlas; empty for glyphs with nothing to draw
+    int advance;
+} OCL2DRI_Glyph;
+
+typedef struct OCL2DRI_Font OCL2DRI_Font;
+
+// One page of a font's glyph atlas. Glyphs are rasterized into `pixels` while
+// recording; the dirty part is uploaded to `atlas` when text is drawn.
+typedef struct OCL2DRI_AtlasPage {
+    OCL2DRI_Font* font;
+    SDL_Surface* pixels;  // CPU copy of the atlas, white glyphs with alpha
+    SDL_Texture* atlas;   // NULL until first drawn
+    SDL_Rect dirty;       // Part of `pixels` not yet uploaded; w == 0 when clean
+    int refs;             // TEXT commands recorded against the page and not yet dropped
+    struct OCL2DRI_AtlasPage* next;  // Older, retired page
+} OCL2DRI_AtlasPage;
+
+// A loaded font. Glyphs are rasterized once, on first use, into the newest page. A
+// full page that recorded text still points into is retired rather than reused, and
+// freed once no command list refers to it.
+struct OCL2DRI_Font {
+    TTF_Font* font;
+    OCL2DRI_AtlasPage* page;  // Newest first
+    int pen_x, pen_y, row_h;  // Shelf packer for `page`
+    Uint32 generation;        // Bumped when a new page is started
+    int line_skip;
+    OCL2DRI_Glyph glyphs[OCL2DRI_GLYPH_SLOTS];  // On `page`
+    int glyph_count;
+};
+
+// One glyph of a shaped string, relative to the string's origin.
+typedef struct {
+    float x, y, w, h;
+    float u0, v0, u1, v1;
+} OCL2DRI_GlyphQuad;
+
+// A string laid out once and reused while it keeps being drawn unchanged.
+typedef struct {
+    char* text;  // NULL for a free entry
+    Uint64 hash;
+    int font;
+    Uint32 generation;  // Atlas generation the quads refer to
+    Uint64 last_used;   // Frame number
+    OCL2DRI_GlyphQuad* quads;
+    int quad_count;
+} OCL2DRI_ShapedText;
+
+typedef struct {
+    OCL2DRI_Command* commands;
+    int count;
+    int capacity;
+    Uint8 bg_r, bg_g, bg_b;
+    bool state_sorting;      // ocl2dri_set_state_sorting when the frame was submitted
+    char overlay_text[128];  // Stats overlay line, drawn after the commands when set
+    SDL_Vertex* vertices;    // Text quads, six vertices per glyph
+    int vertex_count;
+    int vertex_capacity;
+    int culled;              // Draws dropped at record time for lying outside the window
+} OCL2DRI_CommandList;
+
+// A named layer: what the script drew between layer_begin and layer_end, kept in a
+// render target and composited every frame until drawn again.
+typedef struct {
+    char name[32];
+    int z;                         // Below the frame's own drawing when negative
+    bool visible;
+    OCL2DRI_CommandList drawn;
+    OCL2DRI_CommandList staging;   // Being recorded
+    SDL_Texture* texture;          // NULL until first composited
+    bool dirty;                    // `drawn` changed since `texture` was rendered
+    int redraws;
+} OCL2DRI_Layer;
+
+// Where one frame's time went, from the end of one ocl2dri_update to the end of the next.
+// Pipelined contexts present a frame queue_depth updates after it is recorded; the wait
+// for its sort, its drawing and its present are then added to its own slot.
+typedef struct {
+    Uint64 script_ns;   // Script logic between updates
+    Uint64 submit_ns;   // Executing or queueing the frame's commands, events and input
+    Uint64 present_ns;  // SDL_RenderPresent, including any vsync wait
+    Uint64 sleep_ns;    // Frame-rate pacing
+} OCL2DRI_FrameTiming;
+
+typedef struct {
+    Uint64 key;
+    int index;
+} OCL2DRI_SortItem;
+
+// Scratch for ocl2dri_sort_commands. The main thread and the sort thread have one each.
+typedef struct {
+    OCL2DRI_Command* commands;
+    OCL2DRI_SortItem* items;  // Two halves of capacity each
+    int capacity;
+    SDL_Vertex* vertices;     // Vertices repacked into sorted order
+    int vertex_capacity;
+} OCL2DRI_SortBuffers;
+
+// What the last presented frame cost the renderer, returned by ocl2dri_get_draw_stats.
+typedef struct {
+    int commands;       // Commands submitted, layers and overlay included
+    int culled;         // Draws dropped for lying outside the window
+    int draw_calls;     // SDL draw calls, layer redraws included
+    int state_changes;  // Draw colour, texture and render target switches
+} OCL2DRI_DrawStats;
+
+// Summary returned by ocl2dri_get_frame_stats. Frame times are totals over all phases.
+typedef struct {
+    int frames;   // Frames summarized, at most OCL2DRI_FRAME_HISTORY
+    int missed;   // Frames longer than the frame-rate deadline
+    float min_ms, avg_ms, p50_ms, p95_ms, p99_ms, max_ms;
+    float script_ms, submit_ms, present_ms, sleep_ms;  // Per-phase averages
+} OCL2DRI_FrameStats;
+
+typedef enum {
+    OCL2DRI_INPUT_LIVE,    // Queries go straight to SDL
+    OCL2DRI_INPUT_RECORD,  // Input is snapshotted once per frame and written out
+    OCL2DRI_INPUT_REPLAY   // Input and delta time come from a recording
+} OCL2DRI_InputMode;
+
+// Everything the input queries can observe during one frame.
+typedef struct {
+    float delta_time;
+    float mouse_x, mouse_y;
+    Uint8 mouse_buttons;  // Bit 0 left, 1 middle, 2 right
+    bool keys[SDL_SCANCODE_COUNT];
+} OCL2DRI_InputFrame;
+
+typedef struct OCL2DRI_Context {
     SDL_Window* window;
     SDL_Renderer* renderer;
-    int width;
+    int width;                            // Render output size in pixels; draws outside it are culled
     int height;
     bool running;
     Uint8 bg_r, bg_g, bg_b;
+    Uint8 draw_r, draw_g, draw_b, draw_a;
+    int depth;                            // Given to every command recorded
+    bool state_sorting;                   // Also group equal depths by texture and colour
+    float camera_x, camera_y, camera_zoom;
+    OCL2DRI_SortBuffers sort;             // Main thread's sort buffers
+    OCL2DRI_DrawStats draw_stats;         // Last presented frame
     Uint32 frame_delay;
     Uint32 last_frame_time;
+
+    // Frames are recorded into command_lists[record_index] and submitted by
+    // ocl2dri_update. In pipelined mode submitted lists form a ring of up to
+    // queue_depth + 1 frames: sort_thread sorts them in order while the main thread
+    // presents the oldest, so sorting one frame overlaps presenting the one before.
+    // The renderer is only ever used on the main thread.
+    OCL2DRI_CommandList command_lists[OCL2DRI_COMMAND_LIST_COUNT];
+    int record_index;
+    bool pipelined;
+    int queue_depth;
+    int queue_head;    // Oldest submitted frame
+    int queue_count;   // Submitted and not yet presented
+    int sorted_count;  // How many of those, from queue_head, sort_thread has finished
+    bool sort_quit;
+    SDL_Thread* sort_thread;
+    SDL_Mutex* queue_mutex;
+    SDL_Condition* queue_cond;
+    OCL2DRI_SortBuffers thread_sort;  // sort_thread's sort buffers
+
+    // Record/replay, chosen at init from OCL2DRI_RECORD / OCL2DRI_REPLAY. Outside
+    // live mode every input query reads `input`, which changes only in ocl2dri_update.
+    OCL2DRI_InputMode input_mode;
+    FILE* input_file;
+    OCL2DRI_InputFrame input;
+    float fixed_delta_time;  // Replay: used instead of the recorded deltas when > 0
+    Uint64 last_update_ns;
+    bool headless;           // Offscreen window, no vsync and no frame pacing
+
+    // Ring of the last OCL2DRI_FRAME_HISTORY frames; frame_count - 1 is the newest
+    OCL2DRI_FrameTiming frame_timings[OCL2DRI_FRAME_HISTORY];
+    Uint64 frame_count;
+    Uint64 frame_end_ns;
+    bool stats_overlay;
+    char* stats_csv_path;    // OCL2DRI_FRAME_STATS: CSV written by ocl2dri_destroy
+
+    // Fonts from ocl2dri_load_font, addressed by index, and the strings drawn with them
+    OCL2DRI_Font* fonts[OCL2DRI_MAX_FONTS];
+    int font_count;
+    bool ttf_ready;
+    OCL2DRI_ShapedText text_cache[OCL2DRI_TEXT_CACHE_SETS][OCL2DRI_TEXT_CACHE_WAYS];
+
+    // Emitters are stepped and drawn by ocl2dri_update, in creation order
+    OCL2DRI_Emitter* emitters[OCL2DRI_MAX_EMITTERS];
+    int emitter_count;
+    Uint64 particle_ns;  // When the emitters were last stepped
+
+    // Asynchronous textures: workers decode files from load_queue, and the main thread
+    // uploads from upload_queue for at most upload_budget_ns per frame.
+    OCL2DRI_TextureSlot* textures[OCL2DRI_MAX_TEXTURES];
+    int texture_count;
+    OCL2DRI_HandleQueue load_queue;
+    OCL2DRI_HandleQueue upload_queue;
+    SDL_Mutex* asset_mutex;
+    SDL_Condition* asset_cond;
+    SDL_Thread* asset_workers[OCL2DRI_MAX_ASSET_WORKERS];
+    int asset_worker_count;
+    bool asset_quit;
+    Uint64 upload_budget_ns;
+
+    // Layers by handle, their handles sorted by z (stable), and the one being drawn
+    OCL2DRI_Layer* layers[OCL2DRI_MAX_LAYERS];
+    int layer_order[OCL2DRI_MAX_LAYERS];
+    int layer_count;
+    OCL2DRI_Layer* drawing_layer;
 } OCL2DRI_Context;
 
+// Draw calls go to the layer between layer_begin and layer_end, else to the frame.
+static OCL2DRI_CommandList* ocl2dri_recording_list(OCL2DRI_Context* ctx) {
+    return ctx->drawing_layer ? &ctx->drawing_layer->staging : &ctx->command_lists[ctx->record_index];
+}
+
+static OCL2DRI_Command* ocl2dri_append_command(OCL2DRI_Context* ctx, OCL2DRI_CommandList* list, OCL2DRI_CommandType type) {
+    if (list->count == list->capacity) {
+        int capacity = list->capacity ? list->capacity * 2 : 256;
+        OCL2DRI_Command* commands = (OCL2DRI_Command*)realloc(list->commands, capacity * sizeof(OCL2DRI_Command));
+        if (!commands) return NULL;
+        list->commands = commands;
+        list->capacity = capacity;
+    }
+    OCL2DRI_Command* cmd = &list->commands[list->count++];
+    cmd->type = type;
+    cmd->r = ctx->draw_r;
+    cmd->g = ctx->draw_g;
+    cmd->b = ctx->draw_b;
+    cmd->a = ctx->draw_a;
+    cmd->resource = NULL;
+    cmd->depth = ctx->depth;
+    return cmd;
+}
+
+static OCL2DRI_Command* ocl2dri_push_command(OCL2DRI_Context* ctx, OCL2DRI_CommandType type) {
+    return ocl2dri_append_command(ctx, ocl2dri_recording_list(ctx), type);
+}
+
+// Maps a box from world to window coordinates through the camera. Returns false, and
+// counts the draw as culled, when none of it lands in the window.
+static bool ocl2dri_place_box(OCL2DRI_Context* ctx, float* x, float* y, float* w, float* h) {
+    *x = (*x - ctx->camera_x) * ctx->camera_zoom;
+    *y = (*y - ctx->camera_y) * ctx->camera_zoom;
+    *w *= ctx->camera_zoom;
+    *h *= ctx->camera_zoom;
+    float x0 = SDL_min(*x, *x + *w), x1 = SDL_max(*x, *x + *w);
+    float y0 = SDL_min(*y, *y + *h), y1 = SDL_max(*y, *y + *h);
+    if (x1 < 0.0f || y1 < 0.0f || x0 > (float)ctx->width || y0 > (float)ctx->height) {
+        ocl2dri_recording_list(ctx)->culled++;
+        return false;
+    }
+    return true;
+}
+
+// Sort key: depth in the high half, order-preserving for negatives. With state sorting
+// the low half groups by kind, then texture, then colour; hash collisions only cost
+// some batching, never the depth order.
+static Uint64 ocl2dri_command_key(bool state_sorting, const OCL2DRI_Command* cmd) {
+    Uint64 key = (Uint64)((Uint32)cmd->depth ^ 0x80000000u) << 32;
+    if (!state_sorting) return key;
+    Uint32 resource = (Uint32)(((uintptr_t)cmd->resource >> 4) * 2654435761u) >> 20;
+    Uint32 color = ((Uint32)cmd->r << 24 | cmd->g << 16 | cmd->b << 8 | cmd->a) * 2654435761u >> 16;
+    return key | (Uint64)cmd->type << 28 | resource << 16 | color;
+}
+
+static bool ocl2dri_reserve_sort(OCL2DRI_SortBuffers* buffers, int count) {
+    if (count <= buffers->capacity) return true;
+    OCL2DRI_Command* commands = (OCL2DRI_Command*)realloc(buffers->commands, count * sizeof(OCL2DRI_Command));
+    if (commands) buffers->commands = commands;
+    OCL2DRI_SortItem* items = (OCL2DRI_SortItem*)realloc(buffers->items, 2 * count * sizeof(OCL2DRI_SortItem));
+    if (items) buffers->items = items;
+    if (!commands || !items) return false;
+    buffers->capacity = count;
+    return true;
+}
+
+// Stable LSD radix sort of a recorded list by ocl2dri_command_key, skipping the bytes
+// every key shares, so runs that share state reach the renderer together. Vertices
+// are repacked in the new order so text in one font stays one draw call. Touches only
+// the list and `buffers`, so the sort thread can run it.
+static void ocl2dri_sort_commands(OCL2DRI_SortBuffers* buffers, OCL2DRI_CommandList* list, bool state_sorting) {
+    int n = list->count;
+    if (n < 2) return;
+    Uint64 first = ocl2dri_command_key(state_sorting, &list->commands[0]), prev = first, differ = 0;
+    bool sorted = true;
+    for (int i = 1; i < n; i++) {
+        Uint64 key = ocl2dri_command_key(state_sorting, &list->commands[i]);
+        sorted &= key >= prev;
+        differ |= key ^ first;
+        prev = key;
+    }
+    if (sorted || !ocl2dri_reserve_sort(buffers, n)) return;  // In order is the usual case
+
+    OCL2DRI_SortItem* src = buffers->items;
+    OCL2DRI_SortItem* dst = buffers->items + n;
+    for (int i = 0; i < n; i++) {
+        src[i].key = ocl2dri_command_key(state_sorting, &list->commands[i]);
+        src[i].index = i;
+    }
+    for (int shift = 0; shift < 64; shift += 8) {
+        if (((differ >> shift) & 0xFF) == 0) continue;
+        int offsets[257] = {0};
+        for (int i = 0; i < n; i++) offsets[((src[i].key >> shift) & 0xFF) + 1]++;
+        for (int d = 0; d < 256; d++) offsets[d + 1] += offsets[d];
+        for (int i = 0; i < n; i++) dst[offsets[(src[i].key >> shift) & 0xFF]++] = src[i];
+        OCL2DRI_SortItem* t = src;
+        src = dst;
+        dst = t;
+    }
+    for (int i = 0; i < n; i++) buffers->commands[i] = list->commands[src[i].index];
+    memcpy(list->commands, buffers->commands, n * sizeof(OCL2DRI_Command));
+
+    if (list->vertex_count == 0) return;
+    if (list->vertex_capacity > buffers->vertex_capacity) {
+        SDL_Vertex* vertices = (SDL_Vertex*)realloc(buffers->vertices, list->vertex_capacity * sizeof(SDL_Vertex));
+        if (!vertices) return;  // Still correct, just fewer merged text batches
+        buffers->vertices = vertices;
+        buffers->vertex_capacity = list->vertex_capacity;
+    }
+    int used = 0;
+    for (int c = 0; c < n; c++) {
+        OCL2DRI_Command* cmd = &list->commands[c];
+        if (cmd->type != OCL2DRI_CMD_TEXT && cmd->type != OCL2DRI_CMD_PARTICLES) continue;
+        memcpy(&buffers->vertices[used], &list->vertices[cmd->first], cmd->count * sizeof(SDL_Vertex));
+        cmd->first = used;
+        used += cmd->count;
+    }
+    SDL_Vertex* vertices = list->vertices;
+    int capacity = list->vertex_capacity;
+    list->vertices = buffers->vertices;
+    list->vertex_capacity = buffers->vertex_capacity;
+    buffers->vertices = vertices;
+    buffers->vertex_capacity = capacity;
+}
+
+static int ocl2dri_render_tilemap(SDL_Renderer* renderer, OCL2DRI_Tilemap* map, float scroll_x, float scroll_y);
+static void ocl2dri_render_text(SDL_Renderer* renderer, OCL2DRI_AtlasPage* page, const SDL_Vertex* vertices, int count);
+static void ocl2dri_release_text(OCL2DRI_CommandList* list);
+static void ocl2dri_upload_textures(OCL2DRI_Context* ctx, SDL_Renderer* renderer);
+static void ocl2dri_render_layer(SDL_Renderer* renderer, OCL2DRI_Layer* layer, OCL2DRI_DrawStats* stats);
+
+// Draws the commands onto the current target, adding what it cost to `stats`. Runs of
+// same-coloured rects go out as one call. Returns false if a texture was skipped
+// because it has not finished loading.
+static bool ocl2dri_run_commands(SDL_Renderer* renderer, const OCL2DRI_CommandList* list, OCL2DRI_DrawStats* stats) {
+    bool complete = true;
+    bool color_set = false;      // Whether the renderer's draw colour is `color`
+    Uint8 color[4] = {0, 0, 0, 0};
+    const void* bound = NULL;    // Texture of the last textured draw
+    SDL_FRect batch[OCL2DRI_RECT_BATCH];
+    for (int i = 0; i < list->count; i++) {
+        const OCL2DRI_Command* cmd = &list->commands[i];
+        SDL_FRect rect = {cmd->x, cmd->y, cmd->w, cmd->h};
+        if (cmd->type == OCL2DRI_CMD_FILL_RECT || cmd->type == OCL2DRI_CMD_DRAW_RECT || cmd->type == OCL2DRI_CMD_DRAW_LINE) {
+            if (!color_set || color[0] != cmd->r || color[1] != cmd->g || color[2] != cmd->b || color[3] != cmd->a) {
+                SDL_SetRenderDrawColor(renderer, cmd->r, cmd->g, cmd->b, cmd->a);
+                color[0] = cmd->r;
+                color[1] = cmd->g;
+                color[2] = cmd->b;
+                color[3] = cmd->a;
+                color_set = true;
+                stats->state_changes++;
+            }
+        }
+        switch (cmd->type) {
+            case OCL2DRI_CMD_FILL_RECT:
+            case OCL2DRI_CMD_DRAW_RECT: {
+                int n = 0;
+                batch[n++] = rect;
+                while (n < OCL2DRI_RECT_BATCH && i + 1 < list->count) {
+                    const OCL2DRI_Command* next = &list->commands[i + 1];
+                    if (next->type != cmd->type || next->r != cmd->r || next->g != cmd->g ||
+                        next->b != cmd->b || next->a != cmd->a) break;
+                    batch[n++] = (SDL_FRect){next->x, next->y, next->w, next->h};
+                    i++;
+                }
+                if (cmd->type == OCL2DRI_CMD_FILL_RECT) {
+                    SDL_RenderFillRects(renderer, batch, n);
+                } else {
+                    SDL_RenderRects(renderer, batch, n);
+                }
+                stats->draw_calls++;
+                break;
+            }
+            case OCL2DRI_CMD_DRAW_LINE:
+                SDL_RenderLine(renderer, cmd->x, cmd->y, cmd->w, cmd->h);
+                stats->draw_calls++;
+                break;
+            case OCL2DRI_CMD_TILEMAP:
+                if (cmd->resource) {
+                    int calls = ocl2dri_render_tilemap(renderer, (OCL2DRI_Tilemap*)cmd->resource, cmd->x, cmd->y);
+                    stats->draw_calls += calls;
+                    stats->state_changes += calls;  // One colour per tile group
+                    color_set = false;
+                }
+                break;
+            case OCL2DRI_CMD_TEXT: {
+                // Consecutive labels on one atlas page with adjacent vertices: one draw call
+                int count = cmd->count;
+                while (i + 1 < list->count && list->commands[i + 1].type == OCL2DRI_CMD_TEXT &&
+                       list->commands[i + 1].resource == cmd->resource &&
+                       list->commands[i + 1].first == cmd->first + count) {
+                    count += list->commands[++i].count;
+                }
+                if (bound != cmd->resource) stats->state_changes++;
+                bound = cmd->resource;
+                ocl2dri_render_text(renderer, (OCL2DRI_AtlasPage*)cmd->resource, &list->vertices[cmd->first], count);
+                stats->draw_calls++;
+                break;
+            }
+            case OCL2DRI_CMD_TEXTURE: {
+                // Drawn from the first frame its upload has finished; until then, nothing
+                SDL_Texture* texture = ((const OCL2DRI_TextureSlot*)cmd->resource)->texture;
+                if (!texture) {
+                    complete = false;
+                    break;
+                }
+                if (rect.w <= 0.0f || rect.h <= 0.0f) {
+                    rect.w = (float)texture->w;
+                    rect.h = (float)texture->h;
+                }
+                if (bound != cmd->resource) stats->state_changes++;
+                bound = cmd->resource;
+                SDL_SetTextureAlphaMod(texture, cmd->a);
+                SDL_RenderTexture(renderer, texture, NULL, &rect);
+                stats->draw_calls++;
+                break;
+            }
+            case OCL2DRI_CMD_PARTICLES:
+                if (cmd->resource) {
+                    SDL_RenderGeometry(renderer, NULL, &list->vertices[cmd->first], cmd->count,
+                                       ((OCL2DRI_Emitter*)cmd->resource)->indices, cmd->count / 4 * 6);
+                    if (bound) stats->state_changes++;
+                    bound = NULL;
+                    stats->draw_calls++;
+                }
+                break;
+            case OCL2DRI_CMD_LAYER:
+                ocl2dri_render_layer(renderer, (OCL2DRI_Layer*)cmd->resource, stats);
+                bound = cmd->resource;
+                color_set = false;
+                break;
+        }
+    }
+    return complete;
+}
+
+static void ocl2dri_execute_commands(SDL_Renderer* renderer, const OCL2DRI_CommandList* list, OCL2DRI_DrawStats* stats) {
+    *stats = (OCL2DRI_DrawStats){list->count, list->culled, 0, 0};
+    SDL_SetRenderDrawColor(renderer, list->bg_r, list->bg_g, list->bg_b, 255);
+    SDL_RenderClear(renderer);
+    ocl2dri_run_commands(renderer, list, stats);
+    if (list->overlay_text[0]) {
+        SDL_SetRenderDrawColor(renderer, 255, 255, 255, 255);
+        SDL_RenderDebugText(renderer, 8.0f, 8.0f, list->overlay_text);
+    }
+}
+
+EXPORT bool ocl2dri_get_frame_stats(OCL2DRI_Context* ctx, OCL2DRI_FrameStats* out);
+
+static const OCL2DRI_FrameTiming* ocl2dri_frame_timing(const OCL2DRI_Context* ctx, Uint64 frame) {
+    return &ctx->frame_timings[frame % OCL2DRI_FRAME_HISTORY];
+}
+
+// Frames whose timing is complete. Queued pipelined frames are not presented yet.
+static Uint64 ocl2dri_timed_frames(const OCL2DRI_Context* ctx) {
+    return ctx->pipelined ? ctx->frame_count - (Uint64)ctx->queue_count : ctx->frame_count;
+}
+
+static Uint64 ocl2dri_frame_total_ns(const OCL2DRI_FrameTiming* t) {
+    return t->script_ns + t->submit_ns + t->present_ns + t->sleep_ns;
+}
+
+static int ocl2dri_compare_u64(const void* a, const void* b) {
+    Uint64 x = *(const Uint64*)a, y = *(const Uint64*)b;
+    return (x > y) - (x < y);
+}
+
+// Queues the stats overlay into the frame being presented: one stacked bar per recent
+// frame (script green, submit blue, present yellow) under a deadline line, plus a
+// summary line. It goes through the command list like any other drawing.
+static void ocl2dri_queue_stats_overlay(OCL2DRI_Context* ctx, OCL2DRI_CommandList* list) {
+    list->overlay_text[0] = '\0';
+    Uint64 frames = ocl2dri_timed_frames(ctx);
+    if (!ctx->stats_overlay || frames == 0) return;
+
+    const float scale = 4.0f;  // Pixels per millisecond
+    const float base_y = 24.0f + 40.0f * scale;
+    Uint64 first = frames > OCL2DRI_OVERLAY_FRAMES ? frames - OCL2DRI_OVERLAY_FRAMES : 0;
+    for (Uint64 frame = first; frame < frames; frame++) {
+        const OCL2DRI_FrameTiming* t = ocl2dri_frame_timing(ctx, frame);
+        const Uint64 phases[3] = {t->script_ns, t->submit_ns, t->present_ns};
+        static const Uint8 colors[3][3] = {{80, 220, 120}, {90, 150, 255}, {240, 210, 80}};
+        float y = base_y;
+        for (int p = 0; p < 3; p++) {
+            float h = (float)phases[p] / SDL_NS_PER_MS * scale;
+            if (y - h < 24.0f) h = y - 24.0f;
+            if (h <= 0.0f) continue;
+            OCL2DRI_Command* cmd = ocl2dri_append_command(ctx, list, OCL2DRI_CMD_FILL_RECT);
+            if (!cmd) return;
+            cmd->r = colors[p][0];
+            cmd->g = colors[p][1];
+            cmd->b = colors[p][2];
+            cmd->a = 200;
+            cmd->x = 8.0f + (float)(frame - first) * 2.0f;
+            cmd->y = y - h;
+            cmd->w = 2.0f;
+            cmd->h = h;
+            y -= h;
+        }
+    }
+    OCL2DRI_Command* line = ocl2dri_append_command(ctx, list, OCL2DRI_CMD_DRAW_LINE);
+    if (line) {
+        line->r = 255; line->g = 80; line->b = 80; line->a = 255;
+        line->x = 8.0f;
+        line->y = line->h = base_y - ctx->frame_delay * scale;
+        line->w = 8.0f + OCL2DRI_OVERLAY_FRAMES * 2.0f;
+    }
+
+    OCL2DRI_FrameStats stats;
+    ocl2dri_get_frame_stats(ctx, &stats);
+    snprintf(list->overlay_text, sizeof(list->overlay_text), "avg %.2f p99 %.2f max %.2f ms  missed %d/%d",
+             stats.avg_ms, stats.p99_ms, stats.max_ms, stats.missed, stats.frames);
+}
+
+static void ocl2dri_write_u16(FILE* file, Uint16 value) {
+    Uint8 bytes[2] = {(Uint8)value, (Uint8)(value >> 8)};
+    fwrite(bytes, 1, 2, file);
+}
+
+static void ocl2dri_write_u32(FILE* file, Uint32 value) {
+    Uint8 bytes[4] = {(Uint8)value, (Uint8)(value >> 8), (Uint8)(value >> 16), (Uint8)(value >> 24)};
+    fwrite(bytes, 1, 4, file);
+}
+
+static void ocl2dri_write_f32(FILE* file, float value) {
+    Uint32 bits;
+    memcpy(&bits, &value, 4);
+    ocl2dri_write_u32(file, bits);
+}
+
+static bool ocl2dri_read_u16(FILE* file, Uint16* value) {
+    Uint8 bytes[2];
+    if (fread(bytes, 1, 2, file) != 2) return false;
+    *value = (Uint16)(bytes[0] | (bytes[1] << 8));
+    return true;
+}
+
+static bool ocl2dri_read_u32(FILE* file, Uint32* value) {
+    Uint8 bytes[4];
+    if (fread(bytes, 1, 4, file) != 4) return false;
+    *value = (Uint32)bytes[0] | ((Uint32)bytes[1] << 8) | ((Uint32)bytes[2] << 16) | ((Uint32)bytes[3] << 24);
+    return true;
+}
+
+static bool ocl2dri_read_f32(FILE* file, float* value) {
+    Uint32 bits;
+    if (!ocl2dri_read_u32(file, &bits)) return false;
+    memcpy(value, &bits, 4);
+    return true;
+}
+
+// Snapshots SDL's input as the next frame's and appends it to the recording.
+static void ocl2dri_record_frame(OCL2DRI_Context* ctx) {
+    Uint64 now = SDL_GetTicksNS();
+    OCL2DRI_InputFrame* input = &ctx->input;
+    input->delta_time = (float)((double)(now - ctx->last_update_ns) / SDL_NS_PER_SECOND);
+    ctx->last_update_ns = now;
+    SDL_MouseButtonFlags buttons = SDL_GetMouseState(&input->mouse_x, &input->mouse_y);
+    input->mouse_buttons = (Uint8)(((buttons & SDL_BUTTON_LMASK) ? 1 : 0) |
+                                   ((buttons & SDL_BUTTON_MMASK) ? 2 : 0) |
+                                   ((buttons & SDL_BUTTON_RMASK) ? 4 : 0));
+
+    int key_count = 0;
+    const bool* keys = SDL_GetKeyboardState(&key_count);
+    if (key_count > SDL_SCANCODE_COUNT) key_count = SDL_SCANCODE_COUNT;
+    Uint16 changes[SDL_SCANCODE_COUNT];
+    int change_count = 0;
+    for (int i = 0; i < key_count; i++) {
+        if (keys[i] != input->keys[i]) {
+            input->keys[i] = keys[i];
+            changes[change_count++] = (Uint16)(i | (keys[i] ? OCL2DRI_KEY_DOWN_BIT : 0));
+        }
+    }
+
+    FILE* file = ctx->input_file;
+    ocl2dri_write_f32(file, input->delta_time);
+    ocl2dri_write_f32(file, input->mouse_x);
+    ocl2dri_write_f32(file, input->mouse_y);
+    fputc(input->mouse_buttons, file);
+    ocl2dri_write_u16(file, (Uint16)change_count);
+    for (int i = 0; i < change_count; i++) ocl2dri_write_u16(file, changes[i]);
+}
+
+// Loads the next recorded frame into ctx->input. Returns false at the end of the
+// recording, leaving the last frame's input in place.
+static bool ocl2dri_replay_frame(OCL2DRI_Context* ctx) {
+    FILE* file = ctx->input_file;
+    OCL2DRI_InputFrame* input = &ctx->input;
+    float delta_time, mouse_x, mouse_y;
+    Uint16 change_count;
+    int buttons;
+    if (!ocl2dri_read_f32(file, &delta_time) || !ocl2dri_read_f32(file, &mouse_x) ||
+        !ocl2dri_read_f32(file, &mouse_y) || (buttons = fgetc(file)) == EOF ||
+        !ocl2dri_read_u16(file, &change_count)) {
+        return false;
+    }
+    for (int i = 0; i < change_count; i++) {
+        Uint16 change;
+        if (!ocl2dri_read_u16(file, &change)) return false;
+        int scancode = change & ~OCL2DRI_KEY_DOWN_BIT;
+        if (scancode < SDL_SCANCODE_COUNT) input->keys[scancode] = (change & OCL2DRI_KEY_DOWN_BIT) != 0;
+    }
+    input->delta_time = ctx->fixed_delta_time > 0.0f ? ctx->fixed_delta_time : delta_time;
+    input->mouse_x = mouse_x;
+    input->mouse_y = mouse_y;
+    input->mouse_buttons = (Uint8)buttons;
+    return true;
+}
+
+// Reads OCL2DRI_RECORD / OCL2DRI_REPLAY (a file path) and OCL2DRI_FIXED_DT (seconds)
+// and opens the recording. Frame 0's input is captured or loaded here, every later
+// frame's in ocl2dri_update.
+static bool ocl2dri_open_input(OCL2DRI_Context* ctx) {
+    const char* record_path = getenv("OCL2DRI_RECORD");
+    const char* replay_path = getenv("OCL2DRI_REPLAY");
+    ctx->last_update_ns = SDL_GetTicksNS();
+    if (replay_path && *replay_path) {
+        ctx->input_file = fopen(replay_path, "rb");
+        char magic[4];
+        Uint32 version;
+        if (!ctx->input_file || fread(magic, 1, 4, ctx->input_file) != 4 || memcmp(magic, OCL2DRI_INPUT_MAGIC, 4) != 0 ||
+            !ocl2dri_read_u32(ctx->input_file, &version) || version != OCL2DRI_INPUT_VERSION) {
+            return false;
+        }
+        const char* fixed_dt = getenv("OCL2DRI_FIXED_DT");
+        ctx->fixed_delta_time = fixed_dt ? (float)atof(fixed_dt) : 0.0f;
+        ctx->input_mode = OCL2DRI_INPUT_REPLAY;
+        if (!ocl2dri_replay_frame(ctx)) ctx->running = false;
+    } else if (record_path && *record_path) {
+        ctx->input_file = fopen(record_path, "wb");
+        if (!ctx->input_file) return false;
+        fwrite(OCL2DRI_INPUT_MAGIC, 1, 4, ctx->input_file);
+        ocl2dri_write_u32(ctx->input_file, OCL2DRI_INPUT_VERSION);
+        ctx->input_mode = OCL2DRI_INPUT_RECORD;
+        ocl2dri_record_frame(ctx);
+    }
+    ctx->frame_end_ns = SDL_GetTicksNS();
+    return true;
+}
+
+static bool ocl2dri_queue_push(OCL2DRI_HandleQueue* queue, int handle) {
+    if (queue->count == queue->capacity) {
+        int capacity = queue->capacity ? queue->capacity * 2 : 64;
+        int* items = (int*)malloc((size_t)capacity * sizeof(int));
+        if (!items) return false;
+        for (int i = 0; i < queue->count; i++) items[i] = queue->items[(queue->head + i) % queue->capacity];
+        free(queue->items);
+        queue->items = items;
+        queue->head = 0;
+        queue->capacity = capacity;
+    }
+    queue->items[(queue->head + queue->count++) % queue->capacity] = handle;
+    return true;
+}
+
+static int ocl2dri_queue_pop(OCL2DRI_HandleQueue* queue) {
+    if (queue->count == 0) return -1;
+    int handle = queue->items[queue->head];
+    queue->head = (queue->head + 1) % queue->capacity;
+    queue->count--;
+    return handle;
+}
+
+// Decodes queued files to surfaces in the renderer's preferred layout, so the upload
+// left for the frame loop is a plain copy.
+static int ocl2dri_asset_worker(void* data) {
+    OCL2DRI_Context* ctx = (OCL2DRI_Context*)data;
+    SDL_LockMutex(ctx->asset_mutex);
+    for (;;) {
+        while (ctx->load_queue.count == 0 && !ctx->asset_quit) {
+            SDL_WaitCondition(ctx->asset_cond, ctx->asset_mutex);
+        }
+        if (ctx->asset_quit) break;
+        int handle = ocl2dri_queue_pop(&ctx->load_queue);
+        const char* path = ctx->textures[handle]->path;
+        SDL_UnlockMutex(ctx->asset_mutex);
+
+        SDL_Surface* surface = SDL_LoadBMP(path);
+        if (surface && surface->format != SDL_PIXELFORMAT_ARGB8888) {
+            SDL_Surface* converted = SDL_ConvertSurface(surface, SDL_PIXELFORMAT_ARGB8888);
+            SDL_DestroySurface(surface);
+            surface = converted;
+        }
+
+        SDL_LockMutex(ctx->asset_mutex);
+        OCL2DRI_TextureSlot* slot = ctx->textures[handle];
+        if (surface && ocl2dri_queue_push(&ctx->upload_queue, handle)) {
+            slot->surface = surface;
+            slot->state = OCL2DRI_TEXTURE_DECODED;
+        } else {
+            if (surface) SDL_DestroySurface(surface);
+            slot->state = OCL2DRI_TEXTURE_FAILED;
+        }
+    }
+    SDL_UnlockMutex(ctx->asset_mutex);
+    return 0;
+}
+
+static bool ocl2dri_start_asset_workers(OCL2DRI_Context* ctx) {
+    ctx->asset_mutex = SDL_CreateMutex();
+    ctx->asset_cond = SDL_CreateCondition();
+    if (!ctx->asset_mutex || !ctx->asset_cond) return false;
+    // Leave a core for the script and one for the renderer where there are enough
+    int workers = SDL_clamp(SDL_GetNumLogicalCPUCores() - 2, 1, OCL2DRI_MAX_ASSET_WORKERS);
+    for (int i = 0; i < workers; i++) {
+        SDL_Thread* thread = SDL_CreateThread(ocl2dri_asset_worker, "ocl2dri_assets", ctx);
+        if (thread) ctx->asset_workers[ctx->asset_worker_count++] = thread;
+    }
+    return ctx->asset_worker_count > 0;
+}
+
+static void ocl2dri_stop_asset_workers(OCL2DRI_Context* ctx) {
+    if (ctx->asset_mutex) {
+        SDL_LockMutex(ctx->asset_mutex);
+        ctx->asset_quit = true;
+        SDL_BroadcastCondition(ctx->asset_cond);
+        SDL_UnlockMutex(ctx->asset_mutex);
+    }
+    for (int i = 0; i < ctx->asset_worker_count; i++) {
+        SDL_WaitThread(ctx->asset_workers[i], NULL);
+    }
+    ctx->asset_worker_count = 0;
+    if (ctx->asset_cond) SDL_DestroyCondition(ctx->asset_cond);
+    if (ctx->asset_mutex) SDL_DestroyMutex(ctx->asset_mutex);
+    ctx->asset_cond = NULL;
+    ctx->asset_mutex = NULL;
+}
+
+// Turns decoded surfaces into textures until the frame's upload budget is spent. Runs
+// on the main thread; at least one upload happens per call so loading always makes
+// progress.
+static void ocl2dri_upload_textures(OCL2DRI_Context* ctx, SDL_Renderer* renderer) {
+    if (!ctx->asset_mutex) return;
+    Uint64 deadline = SDL_GetTicksNS() + ctx->upload_budget_ns;
+    for (;;) {
+        SDL_LockMutex(ctx->asset_mutex);
+        int handle = ocl2dri_queue_pop(&ctx->upload_queue);
+        OCL2DRI_TextureSlot* slot = handle >= 0 ? ctx->textures[handle] : NULL;
+        SDL_Surface* surface = slot ? slot->surface : NULL;
+        if (slot) slot->surface = NULL;
+        SDL_UnlockMutex(ctx->asset_mutex);
+        if (!slot) break;
+
+        SDL_Texture* texture = SDL_CreateTextureFromSurface(renderer, surface);
+        SDL_DestroySurface(surface);
+        if (texture) SDL_SetTextureBlendMode(texture, SDL_BLENDMODE_BLEND);
+        slot->texture = texture;
+        SDL_LockMutex(ctx->asset_mutex);
+        slot->state = texture ? OCL2DRI_TEXTURE_READY : OCL2DRI_TEXTURE_FAILED;
+        SDL_UnlockMutex(ctx->asset_mutex);
+        if (SDL_GetTicksNS() >= deadline) break;
+    }
+}
+
+// Starts loading a BMP in the background and returns its handle at once, or -1. The
+// handle can be drawn straight away; it shows up once decoded and uploaded.
+EXPORT int ocl2dri_load_texture_async(OCL2DRI_Context* ctx, const char* path) {
+    if (!ctx || !path || ctx->texture_count == OCL2DRI_MAX_TEXTURES) return -1;
+    if (!ctx->asset_mutex && !ocl2dri_start_asset_workers(ctx)) {
+        ocl2dri_stop_asset_workers(ctx);
+        return -1;
+    }
+    OCL2DRI_TextureSlot* slot = (OCL2DRI_TextureSlot*)calloc(1, sizeof(OCL2DRI_TextureSlot));
+    if (!slot) return -1;
+    slot->path = SDL_strdup(path);
+    if (!slot->path) {
+        free(slot);
+        return -1;
+    }
+    int handle = ctx->texture_count;
+    SDL_LockMutex(ctx->asset_mutex);
+    bool queued = ocl2dri_queue_push(&ctx->load_queue, handle);
+    if (queued) {
+        ctx->textures[ctx->texture_count++] = slot;
+        SDL_SignalCondition(ctx->asset_cond);
+    }
+    SDL_UnlockMutex(ctx->asset_mutex);
+    if (!queued) {
+        SDL_free(slot->path);
+        free(slot);
+        return -1;
+    }
+    return handle;
+}
+
+// 1 when the texture can be drawn, 0 while it is loading, -1 if it failed or is unknown.
+EXPORT int ocl2dri_texture_status(OCL2DRI_Context* ctx, int handle) {
+    if (!ctx || handle < 0 || handle >= ctx->texture_count) return -1;
+    SDL_LockMutex(ctx->asset_mutex);
+    OCL2DRI_TextureState state = ctx->textures[handle]->state;
+    SDL_UnlockMutex(ctx->asset_mutex);
+    if (state == OCL2DRI_TEXTURE_READY) return 1;
+    return state == OCL2DRI_TEXTURE_FAILED ? -1 : 0;
+}
+
+// Fraction of the requested textures that have finished, ready or failed; 1 with none.
+EXPORT float ocl2dri_texture_progress(OCL2DRI_Context* ctx) {
+    if (!ctx || ctx->texture_count == 0) return 1.0f;
+    int finished = 0;
+    SDL_LockMutex(ctx->asset_mutex);
+    for (int i = 0; i < ctx->texture_count; i++) {
+        OCL2DRI_TextureState state = ctx->textures[i]->state;
+        finished += state == OCL2DRI_TEXTURE_READY || state == OCL2DRI_TEXTURE_FAILED;
+    }
+    SDL_UnlockMutex(ctx->asset_mutex);
+    return (float)finished / ctx->texture_count;
+}
+
+// Caps the time each frame spends creating textures from decoded images.
+EXPORT void ocl2dri_set_upload_budget(OCL2DRI_Context* ctx, float ms) {
+    if (!ctx) return;
+    ctx->upload_budget_ns = (Uint64)(SDL_max(ms, 0.0f) * SDL_NS_PER_MS);
+}
+
+// Records a texture at (x, y); w or h <= 0 uses its own size, which the camera moves
+// but neither scales nor culls. The draw colour's alpha fades it.
+EXPORT void ocl2dri_draw_texture(OCL2DRI_Context* ctx, int handle, float x, float y, float w, float h) {
+    if (!ctx || handle < 0 || handle >= ctx->texture_count) return;
+    if (w > 0.0f && h > 0.0f) {
+        if (!ocl2dri_place_box(ctx, &x, &y, &w, &h)) return;
+    } else {
+        x = (x - ctx->camera_x) * ctx->camera_zoom;
+        y = (y - ctx->camera_y) * ctx->camera_zoom;
+    }
+    OCL2DRI_Command* cmd = ocl2dri_push_command(ctx, OCL2DRI_CMD_TEXTURE);
+    if (!cmd) return;
+    cmd->resource = ctx->textures[handle];
+    cmd->x = x;
+    cmd->y = y;
+    cmd->w = w;
+    cmd->h = h;
+}
+
+// Brings the layer's render target up to date if needed and draws it over the whole
+// output.
+static void ocl2dri_render_layer(SDL_Renderer* renderer, OCL2DRI_Layer* layer, OCL2DRI_DrawStats* stats) {
+    int w, h;
+    SDL_GetRenderOutputSize(renderer, &w, &h);
+    if (layer->texture && (layer->texture->w != w || layer->texture->h != h)) {
+        SDL_DestroyTexture(layer->texture);
+        layer->texture = NULL;
+    }
+    if (!layer->texture) {
+        layer->texture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_TARGET, w, h);
+        if (layer->texture) SDL_SetTextureBlendMode(layer->texture, SDL_BLENDMODE_BLEND);
+        layer->dirty = true;
+    }
+    if (layer->texture && layer->dirty) {
+        SDL_SetRenderTarget(renderer, layer->texture);
+        SDL_SetRenderDrawColor(renderer, 0, 0, 0, 0);
+        SDL_RenderClear(renderer);
+        // A texture still loading leaves the layer dirty so it is drawn again once it arrives
+        layer->dirty = !ocl2dri_run_commands(renderer, &layer->drawn, stats);
+        SDL_SetRenderTarget(renderer, NULL);
+        layer->redraws++;
+        stats->state_changes += 2;
+    }
+    if (layer->texture) {
+        SDL_RenderTexture(renderer, layer->texture, NULL, NULL);
+        stats->draw_calls++;
+        stats->state_changes++;
+    }
+}
+
+// Queues the visible layers around what the frame drew itself: negative z first, in
+// order, then the rest after it.
+static void ocl2dri_queue_layers(OCL2DRI_Context* ctx, OCL2DRI_CommandList* list) {
+    OCL2DRI_Command below[OCL2DRI_MAX_LAYERS];
+    int below_count = 0;
+    int frame_count = list->count;
+    for (int i = 0; i < ctx->layer_count; i++) {
+        OCL2DRI_Layer* layer = ctx->layers[ctx->layer_order[i]];
+        if (!layer->visible) continue;
+        OCL2DRI_Command* cmd = ocl2dri_append_command(ctx, list, OCL2DRI_CMD_LAYER);
+        if (!cmd) return;
+        cmd->resource = layer;
+        if (layer->z < 0) below[below_count++] = *cmd;
+    }
+    if (below_count) {
+        memmove(&list->commands[below_count], list->commands, (size_t)frame_count * sizeof(OCL2DRI_Command));
+        memcpy(list->commands, below, (size_t)below_count * sizeof(OCL2DRI_Command));
+    }
+}
+
+// Returns the handle of the layer called `name`, creating it if needed, and places it
+// at `z` among the others. Layers with negative z are drawn under the frame's own
+// drawing, the rest over it; equal z keeps creation order.
+EXPORT int ocl2dri_layer_create(OCL2DRI_Context* ctx, const char* name, int z) {
+    if (!ctx || !name) return -1;
+    int handle = -1;
+    for (int i = 0; i < ctx->layer_count; i++) {
+        if (SDL_strncmp(ctx->layers[i]->name, name, sizeof(ctx->layers[i]->name) - 1) == 0) handle = i;
+    }
+    if (handle < 0) {
+        if (ctx->layer_count == OCL2DRI_MAX_LAYERS) return -1;
+        OCL2DRI_Layer* layer = (OCL2DRI_Layer*)calloc(1, sizeof(OCL2DRI_Layer));
+        if (!layer) return -1;
+        SDL_strlcpy(layer->name, name, sizeof(layer->name));
+        layer->visible = true;
+        layer->dirty = true;
+        handle = ctx->layer_count;
+        ctx->layers[handle] = layer;
+        ctx->layer_order[ctx->layer_count++] = handle;
+    }
+    ctx->layers[handle]->z = z;
+
+    // Stable insertion sort of the handles by z
+    for (int i = 1; i < ctx->layer_count; i++) {
+        int key = ctx->layer_order[i];
+        int j = i - 1;
+        for (; j >= 0 && ctx->layers[ctx->layer_order[j]]->z > ctx->layers[key]->z; j--) {
+            ctx->layer_order[j + 1] = ctx->layer_order[j];
+        }
+        ctx->layer_order[j + 1] = key;
+    }
+    return handle;
+}
+
+EXPORT void ocl2dri_layer_end(OCL2DRI_Context* ctx) {
+    if (!ctx || !ctx->drawing_layer) return;
+    OCL2DRI_Layer* layer = ctx->drawing_layer;
+    ocl2dri_sort_commands(&ctx->sort, &layer->staging, ctx->state_sorting);
+    OCL2DRI_CommandList drawn = layer->drawn;
+    layer->drawn = layer->staging;
+    layer->staging = drawn;
+    layer->dirty = true;
+    ctx->drawing_layer = NULL;
+}
+
+// Sends draw calls to the layer, replacing what it held, until ocl2dri_layer_end.
+EXPORT void ocl2dri_layer_begin(OCL2DRI_Context* ctx, int handle) {
+    if (!ctx || handle < 0 || handle >= ctx->layer_count) return;
+    if (ctx->drawing_layer) ocl2dri_layer_end(ctx);
+    ctx->drawing_layer = ctx->layers[handle];
+    ocl2dri_release_text(&ctx->drawing_layer->staging);
+    ctx->drawing_layer->staging.count = 0;
+    ctx->drawing_layer->staging.vertex_count = 0;
+    ctx->drawing_layer->staging.culled = 0;
+}
+
+EXPORT void ocl2dri_layer_set_visible(OCL2DRI_Context* ctx, int handle, bool visible) {
+    if (!ctx || handle < 0 || handle >= ctx->layer_count) return;
+    ctx->layers[handle]->visible = visible;
+}
+
+// How many times the layer has been rendered into its target; a static layer should
+// stay at 1.
+EXPORT int ocl2dri_layer_redraws(OCL2DRI_Context* ctx, int handle) {
+    if (!ctx || handle < 0 || handle >= ctx->layer_count) return -1;
+    return ctx->layers[handle]->redraws;
+}
+
+// Sorts submitted frames in order, for the main thread to present. It only touches
+// the lists it sorts and its own buffers; every renderer call stays on the main thread.
+static int ocl2dri_sort_thread(void* data) {
+    OCL2DRI_Context* ctx = (OCL2DRI_Context*)data;
+    SDL_LockMutex(ctx->queue_mutex);
+    for (;;) {
+        while (ctx->sorted_count == ctx->queue_count && !ctx->sort_quit) {
+            SDL_WaitCondition(ctx->queue_cond, ctx->queue_mutex);
+        }
+        if (ctx->sort_quit) break;
+        OCL2DRI_CommandList* list = &ctx->command_lists[(ctx->queue_head + ctx->sorted_count) % (ctx->queue_depth + 1)];
+        SDL_UnlockMutex(ctx->queue_mutex);
+        ocl2dri_sort_commands(&ctx->thread_sort, list, list->state_sorting);
+        SDL_LockMutex(ctx->queue_mutex);
+        ctx->sorted_count++;
+        SDL_BroadcastCondition(ctx->queue_cond);
+    }
+    SDL_UnlockMutex(ctx->queue_mutex);
+    return 0;
+}
+
+// Blocks until the sort thread has finished every submitted frame.
+static void ocl2dri_wait_sorted(OCL2DRI_Context* ctx) {
+    SDL_LockMutex(ctx->queue_mutex);
+    while (ctx->sorted_count < ctx->queue_count) SDL_WaitCondition(ctx->queue_cond, ctx->queue_mutex);
+    SDL_UnlockMutex(ctx->queue_mutex);
+}
+
 EXPORT OCL2DRI_Context* ocl2dri_init(int width, int height, const char* title) {
+    // OCL2DRI_HEADLESS=1 runs without a visible window, e.g. to replay a recording in CI
+    const char* headless_env = getenv("OCL2DRI_HEADLESS");
+    bool headless = headless_env && *headless_env && strcmp(headless_env, "0") != 0;
+    if (headless) SDL_SetHint(SDL_HINT_VIDEO_DRIVER, "offscreen");
     if (SDL_Init(SDL_INIT_VIDEO | SDL_INIT_EVENTS) < 0) {
         return NULL;
     }
 
-    OCL2DRI_Context* ctx = (OCL2DRI_Context*)malloc(sizeof(OCL2DRI_Context));
+    OCL2DRI_Context* ctx = (OCL2DRI_Context*)calloc(1, sizeof(OCL2DRI_Context));
     if (!ctx) {
         SDL_Quit();
         return NULL;
     }
 
-    ctx->window = SDL_CreateWindow(title, width, height, SDL_WINDOW_RESIZABLE);
+    ctx->window = SDL_CreateWindow(title, width, height, headless ? SDL_WINDOW_HIDDEN : SDL_WINDOW_RESIZABLE);
     if (!ctx->window) {
         free(ctx);
         SDL_Quit();
@@ -46,16 +1209,37 @@ EXPORT OCL2DRI_Context* ocl2dri_init(int width, int height, const char* title) {
         return NULL;
     }
 
-    SDL_SetRenderVSync(ctx->renderer, 1);
+    ctx->headless = headless;
+    if (!headless) SDL_SetRenderVSync(ctx->renderer, 1);
 
     ctx->width = width;
     ctx->height = height;
+    SDL_GetRenderOutputSize(ctx->renderer, &ctx->width, &ctx->height);  // Differs on high-DPI displays
     ctx->running = true;
     ctx->bg_r = 0;
     ctx->bg_g = 0;
     ctx->bg_b = 0;
+    ctx->draw_r = 255;
+    ctx->draw_g = 255;
+    ctx->draw_b = 255;
+    ctx->draw_a = 255;
     ctx->frame_delay = 16;
     ctx->last_frame_time = SDL_GetTicks();
+    ctx->upload_budget_ns = OCL2DRI_UPLOAD_BUDGET_NS;
+    ctx->camera_zoom = 1.0f;
+
+    const char* stats_path = getenv("OCL2DRI_FRAME_STATS");
+    if (stats_path && *stats_path) ctx->stats_csv_path = SDL_strdup(stats_path);
+
+    if (!ocl2dri_open_input(ctx)) {
+        if (ctx->input_file) fclose(ctx->input_file);
+        SDL_free(ctx->stats_csv_path);
+        SDL_DestroyRenderer(ctx->renderer);
+        SDL_DestroyWindow(ctx->window);
+        free(ctx);
+        SDL_Quit();
+        return NULL;
+    }
 
     return ctx;
 }
@@ -75,8 +1259,9 @@ EXPORT void ocl2dri_set_title(OCL2DRI_Context* ctx, const char* title) {
 EXPORT void ocl2dri_set_size(OCL2DRI_Context* ctx, int width, int height) {
     if (!ctx || !ctx->window) return;
     SDL_SetWindowSize(ctx->window, width, height);
-    ctx->width = width;
-    ctx->height = height;
+    // width and height hold the output in pixels; a resize that lands later arrives
+    // as SDL_EVENT_WINDOW_PIXEL_SIZE_CHANGED
+    if (ctx->renderer) SDL_GetRenderOutputSize(ctx->renderer, &ctx->width, &ctx->height);
 }
 
 EXPORT void ocl2dri_set_position(OCL2DRI_Context* ctx, int x, int y) {
@@ -149,11 +1334,19 @@ EXPORT void ocl2dri_set_icon(OCL2DRI_Context* ctx, const char* icon_path) {
 
 EXPORT void ocl2dri_get_mouse_position(OCL2DRI_Context* ctx, float* x, float* y) {
     if (!ctx || !x || !y) return;
+    if (ctx->input_mode != OCL2DRI_INPUT_LIVE) {
+        *x = ctx->input.mouse_x;
+        *y = ctx->input.mouse_y;
+        return;
+    }
     SDL_GetMouseState(x, y);
 }
 
 EXPORT int ocl2dri_get_mouse_button_state(OCL2DRI_Context* ctx, int button) {
     if (!ctx) return 0;
+    if (ctx->input_mode != OCL2DRI_INPUT_LIVE) {
+        return button >= 1 && button <= 3 ? (ctx->input.mouse_buttons >> (button - 1)) & 1 : 0;
+    }
     float x, y;
     Uint32 state = SDL_GetMouseState(&x, &y);
     switch (button) {
@@ -164,34 +1357,1381 @@ EXPORT int ocl2dri_get_mouse_button_state(OCL2DRI_Context* ctx, int button) {
     }
 }
 
+// Live: seconds since the previous call. Recording or replaying: the current frame's
+// delta, the same for every call until the next ocl2dri_update.
 EXPORT float ocl2dri_get_delta_time(OCL2DRI_Context* ctx) {
     if (!ctx) return 0.0f;
+    if (ctx->input_mode != OCL2DRI_INPUT_LIVE) return ctx->input.delta_time;
     Uint32 current_time = SDL_GetTicks();
     float delta_time = (current_time - ctx->last_frame_time) / 1000.0f;
     ctx->last_frame_time = current_time;
     return delta_time;
 }
 
+EXPORT void ocl2dri_set_draw_color(OCL2DRI_Context* ctx, Uint8 r, Uint8 g, Uint8 b, Uint8 a) {
+    if (!ctx) return;
+    ctx->draw_r = r;
+    ctx->draw_g = g;
+    ctx->draw_b = b;
+    ctx->draw_a = a;
+}
+
+// Draws recorded from now on go at this depth. Each frame is stably sorted by depth
+// before it is submitted, so lower depths end up underneath whatever the call order.
+EXPORT void ocl2dri_set_depth(OCL2DRI_Context* ctx, int depth) {
+    if (!ctx) return;
+    ctx->depth = depth;
+}
+
+// With state sorting, draws at the same depth are also grouped by kind, texture and
+// colour so they batch into fewer calls. Overlapping draws at one depth may then
+// change order; give them different depths to keep it.
+EXPORT void ocl2dri_set_state_sorting(OCL2DRI_Context* ctx, bool enabled) {
+    if (!ctx) return;
+    ctx->state_sorting = enabled;
+}
+
+// Shapes, text and textures are drawn relative to a camera at (x, y) in world units,
+// magnified by zoom; whatever then lands outside the window is dropped on the spot.
+// Tilemaps keep their own scroll and particles stay in window coordinates.
+EXPORT void ocl2dri_set_camera(OCL2DRI_Context* ctx, float x, float y, float zoom) {
+    if (!ctx || zoom <= 0.0f) return;
+    ctx->camera_x = x;
+    ctx->camera_y = y;
+    ctx->camera_zoom = zoom;
+}
+
+EXPORT bool ocl2dri_get_draw_stats(OCL2DRI_Context* ctx, OCL2DRI_DrawStats* out) {
+    if (!ctx || !out) return false;
+    *out = ctx->draw_stats;
+    return true;
+}
+
+EXPORT void ocl2dri_fill_rect(OCL2DRI_Context* ctx, float x, float y, float w, float h) {
+    if (!ctx || !ocl2dri_place_box(ctx, &x, &y, &w, &h)) return;
+    OCL2DRI_Command* cmd = ocl2dri_push_command(ctx, OCL2DRI_CMD_FILL_RECT);
+    if (!cmd) return;
+    cmd->x = x;
+    cmd->y = y;
+    cmd->w = w;
+    cmd->h = h;
+}
+
+// rects points at count packed x, y, w, h groups, typically an OCL float array.
+EXPORT void ocl2dri_fill_rects(OCL2DRI_Context* ctx, const float* rects, int count) {
+    if (!ctx || !rects) return;
+    for (int i = 0; i < count; i++) {
+        float x = rects[i * 4], y = rects[i * 4 + 1], w = rects[i * 4 + 2], h = rects[i * 4 + 3];
+        if (!ocl2dri_place_box(ctx, &x, &y, &w, &h)) continue;
+        OCL2DRI_Command* cmd = ocl2dri_push_command(ctx, OCL2DRI_CMD_FILL_RECT);
+        if (!cmd) return;
+        cmd->x = x;
+        cmd->y = y;
+        cmd->w = w;
+        cmd->h = h;
+    }
+}
+
+EXPORT void ocl2dri_draw_rect(OCL2DRI_Context* ctx, float x, float y, float w, float h) {
+    if (!ctx || !ocl2dri_place_box(ctx, &x, &y, &w, &h)) return;
+    OCL2DRI_Command* cmd = ocl2dri_push_command(ctx, OCL2DRI_CMD_DRAW_RECT);
+    if (!cmd) return;
+    cmd->x = x;
+    cmd->y = y;
+    cmd->w = w;
+    cmd->h = h;
+}
+
+EXPORT void ocl2dri_draw_line(OCL2DRI_Context* ctx, float x1, float y1, float x2, float y2) {
+    float dx = x2 - x1, dy = y2 - y1;
+    if (!ctx || !ocl2dri_place_box(ctx, &x1, &y1, &dx, &dy)) return;
+    OCL2DRI_Command* cmd = ocl2dri_push_command(ctx, OCL2DRI_CMD_DRAW_LINE);
+    if (!cmd) return;
+    cmd->x = x1;
+    cmd->y = y1;
+    cmd->w = x1 + dx;
+    cmd->h = y1 + dy;
+}
+
+static void ocl2dri_rebuild_chunk(OCL2DRI_Tilemap* map, int cx, int cy) {
+    OCL2DRI_TileChunk* chunk = &map->chunks[cy * map->chunks_x + cx];
+    int x0 = cx * OCL2DRI_TILE_CHUNK, y0 = cy * OCL2DRI_TILE_CHUNK;
+    int x1 = SDL_min(x0 + OCL2DRI_TILE_CHUNK, map->width), y1 = SDL_min(y0 + OCL2DRI_TILE_CHUNK, map->height);
+
+    // Pass 1 counts runs per tile id so pass 2 can write every group in place
+    int counts[OCL2DRI_TILE_KINDS] = {0};
+    int runs = 0;
+    for (int y = y0; y < y1; y++) {
+        const Uint8* row = &map->tiles[(size_t)y * map->width];
+        for (int x = x0; x < x1; x++) {
+            if (row[x] && (x == x0 || row[x - 1] != row[x])) {
+                counts[row[x]]++;
+                runs++;
+            }
+        }
+    }
+    chunk->dirty = false;
+    chunk->group_count = 0;
+    chunk->rect_count = 0;
+    if (runs == 0) return;
+
+    if (runs > chunk->rect_capacity) {
+        SDL_FRect* rects = (SDL_FRect*)realloc(chunk->rects, runs * sizeof(SDL_FRect));
+        if (!rects) return;
+        chunk->rects = rects;
+        chunk->rect_capacity = runs;
+    }
+    if (!chunk->groups) {
+        chunk->groups = (OCL2DRI_TileGroup*)malloc(OCL2DRI_TILE_KINDS * sizeof(OCL2DRI_TileGroup));
+        if (!chunk->groups) return;
+    }
+    int next[OCL2DRI_TILE_KINDS];
+    int offset = 0;
+    for (int tile = 1; tile < OCL2DRI_TILE_KINDS; tile++) {
+        if (!counts[tile]) continue;
+        chunk->groups[chunk->group_count++] = (OCL2DRI_TileGroup){(Uint8)tile, offset, counts[tile]};
+        next[tile] = offset;
+        offset += counts[tile];
+    }
+
+    for (int y = y0; y < y1; y++) {
+        const Uint8* row = &map->tiles[(size_t)y * map->width];
+        int x = x0;
+        while (x < x1) {
+            Uint8 tile = row[x];
+            int start = x;
+            while (x < x1 && row[x] == tile) x++;
+            if (tile) {
+                chunk->rects[next[tile]++] = (SDL_FRect){start * map->tile_w, y * map->tile_h,
+                                                         (x - start) * map->tile_w, map->tile_h};
+            }
+        }
+    }
+    chunk->rect_count = runs;
+}
+
+// Draws the chunks that intersect the render output, rebuilding dirty ones first.
+// Returns the number of draw calls made.
+static int ocl2dri_render_tilemap(SDL_Renderer* renderer, OCL2DRI_Tilemap* map, float scroll_x, float scroll_y) {
+    int calls = 0;
+    int view_w = 0, view_h = 0;
+    SDL_GetRenderOutputSize(renderer, &view_w, &view_h);
+    float chunk_w = map->tile_w * OCL2DRI_TILE_CHUNK, chunk_h = map->tile_h * OCL2DRI_TILE_CHUNK;
+    int cx0 = SDL_max((int)SDL_floorf(scroll_x / chunk_w), 0);
+    int cy0 = SDL_max((int)SDL_floorf(scroll_y / chunk_h), 0);
+    int cx1 = SDL_min((int)SDL_floorf((scroll_x + view_w) / chunk_w), map->chunks_x - 1);
+    int cy1 = SDL_min((int)SDL_floorf((scroll_y + view_h) / chunk_h), map->chunks_y - 1);
+
+    for (int cy = cy0; cy <= cy1; cy++) {
+        for (int cx = cx0; cx <= cx1; cx++) {
+            OCL2DRI_TileChunk* chunk = &map->chunks[cy * map->chunks_x + cx];
+            if (chunk->dirty) ocl2dri_rebuild_chunk(map, cx, cy);
+            if (chunk->rect_count > map->scratch_capacity) {
+                SDL_FRect* scratch = (SDL_FRect*)realloc(map->scratch, chunk->rect_count * sizeof(SDL_FRect));
+                if (!scratch) continue;
+                map->scratch = scratch;
+                map->scratch_capacity = chunk->rect_count;
+            }
+            for (int i = 0; i < chunk->rect_count; i++) {
+                map->scratch[i] = chunk->rects[i];
+                map->scratch[i].x -= scroll_x;
+                map->scratch[i].y -= scroll_y;
+            }
+            for (int g = 0; g < chunk->group_count; g++) {
+                const OCL2DRI_TileGroup* group = &chunk->groups[g];
+                SDL_Color c = map->palette[group->tile];
+                SDL_SetRenderDrawColor(renderer, c.r, c.g, c.b, c.a);
+                SDL_RenderFillRects(renderer, &map->scratch[group->first], group->count);
+                calls++;
+            }
+        }
+    }
+    return calls;
+}
+
+static void ocl2dri_mark_tiles_dirty(OCL2DRI_Tilemap* map, int x, int y, int w, int h) {
+    for (int cy = y / OCL2DRI_TILE_CHUNK; cy <= (y + h - 1) / OCL2DRI_TILE_CHUNK; cy++) {
+        for (int cx = x / OCL2DRI_TILE_CHUNK; cx <= (x + w - 1) / OCL2DRI_TILE_CHUNK; cx++) {
+            map->chunks[cy * map->chunks_x + cx].dirty = true;
+        }
+    }
+}
+
+// Clips a tile rectangle to the map; returns false if nothing is left.
+static bool ocl2dri_clip_tiles(const OCL2DRI_Tilemap* map, int* x, int* y, int* w, int* h) {
+    if (*x < 0) { *w += *x; *x = 0; }
+    if (*y < 0) { *h += *y; *y = 0; }
+    if (*x + *w > map->width) *w = map->width - *x;
+    if (*y + *h > map->height) *h = map->height - *y;
+    return *w > 0 && *h > 0;
+}
+
+EXPORT OCL2DRI_Tilemap* ocl2dri_tilemap_create(OCL2DRI_Context* ctx, int width, int height, float tile_w, float tile_h) {
+    if (!ctx || width <= 0 || height <= 0 || tile_w <= 0.0f || tile_h <= 0.0f) return NULL;
+    OCL2DRI_Tilemap* map = (OCL2DRI_Tilemap*)calloc(1, sizeof(OCL2DRI_Tilemap));
+    if (!map) return NULL;
+    map->ctx = ctx;
+    map->width = width;
+    map->height = height;
+    map->tile_w = tile_w;
+    map->tile_h = tile_h;
+    map->chunks_x = (width + OCL2DRI_TILE_CHUNK - 1) / OCL2DRI_TILE_CHUNK;
+    map->chunks_y = (height + OCL2DRI_TILE_CHUNK - 1) / OCL2DRI_TILE_CHUNK;
+    map->tiles = (Uint8*)calloc((size_t)width * height, 1);
+    map->chunks = (OCL2DRI_TileChunk*)calloc((size_t)map->chunks_x * map->chunks_y, sizeof(OCL2DRI_TileChunk));
+    if (!map->tiles || !map->chunks) {
+        free(map->chunks);
+        free(map->tiles);
+        free(map);
+        return NULL;
+    }
+    for (int i = 1; i < OCL2DRI_TILE_KINDS; i++) {
+        map->palette[i] = (SDL_Color){255, 255, 255, 255};
+    }
+    return map;
+}
+
+EXPORT void ocl2dri_tilemap_set_color(OCL2DRI_Tilemap* map, int tile, Uint8 r, Uint8 g, Uint8 b, Uint8 a) {
+    if (!map || tile <= 0 || tile >= OCL2DRI_TILE_KINDS) return;
+    map->palette[tile] = (SDL_Color){r, g, b, a};  // Looked up at draw time, no rebuild
+}
+
+EXPORT void ocl2dri_tilemap_set_tile(OCL2DRI_Tilemap* map, int x, int y, int tile) {
+    if (!map || x < 0 || y < 0 || x >= map->width || y >= map->height) return;
+    Uint8 value = (Uint8)SDL_clamp(tile, 0, OCL2DRI_TILE_KINDS - 1);
+    Uint8* cell = &map->tiles[(size_t)y * map->width + x];
+    if (*cell == value) return;
+    *cell = value;
+    ocl2dri_mark_tiles_dirty(map, x, y, 1, 1);
+}
+
+EXPORT int ocl2dri_tilemap_get_tile(OCL2DRI_Tilemap* map, int x, int y) {
+    if (!map || x < 0 || y < 0 || x >= map->width || y >= map->height) return 0;
+    return map->tiles[(size_t)y * map->width + x];
+}
+
+// Copies a w x h block of tile ids, row by row, to (x, y). `tiles` is typically an
+// OCL int array; values are clamped to 0-255 and the part outside the map is dropped.
+EXPORT void ocl2dri_tilemap_set_tiles(OCL2DRI_Tilemap* map, int x, int y, int w, int h, const int* tiles) {
+    if (!map || !tiles || w <= 0 || h <= 0) return;
+    int src_x = x, src_y = y, src_w = w;
+    if (!ocl2dri_clip_tiles(map, &x, &y, &w, &h)) return;
+    for (int row = 0; row < h; row++) {
+        const int* src = &tiles[(size_t)(y - src_y + row) * src_w + (x - src_x)];
+        Uint8* dst = &map->tiles[(size_t)(y + row) * map->width + x];
+        for (int col = 0; col < w; col++) {
+            dst[col] = (Uint8)SDL_clamp(src[col], 0, OCL2DRI_TILE_KINDS - 1);
+        }
+    }
+    ocl2dri_mark_tiles_dirty(map, x, y, w, h);
+}
+
+EXPORT void ocl2dri_tilemap_fill(OCL2DRI_Tilemap* map, int x, int y, int w, int h, int tile) {
+    if (!map || !ocl2dri_clip_tiles(map, &x, &y, &w, &h)) return;
+    Uint8 value = (Uint8)SDL_clamp(tile, 0, OCL2DRI_TILE_KINDS - 1);
+    for (int row = 0; row < h; row++) {
+        memset(&map->tiles[(size_t)(y + row) * map->width + x], value, w);
+    }
+    ocl2dri_mark_tiles_dirty(map, x, y, w, h);
+}
+
+// Queues the map for this frame with the view's top-left at (scroll_x, scroll_y) in
+// map pixels. Only the chunks on screen are touched when the frame is rendered.
+EXPORT void ocl2dri_tilemap_draw(OCL2DRI_Context* ctx, OCL2DRI_Tilemap* map, float scroll_x, float scroll_y) {
+    if (!ctx || !map) return;
+    OCL2DRI_Command* cmd = ocl2dri_push_command(ctx, OCL2DRI_CMD_TILEMAP);
+    if (!cmd) return;
+    cmd->x = scroll_x;
+    cmd->y = scroll_y;
+    cmd->resource = map;
+}
+
+static void ocl2dri_wait_sorted(OCL2DRI_Context* ctx);
+
+// Makes `resource` safe to free: commands recorded this frame, and in frames still
+// queued when pipelined, are turned into no-ops.
+static void ocl2dri_release_resource(OCL2DRI_Context* ctx, void* resource) {
+    if (ctx->pipelined) ocl2dri_wait_sorted(ctx);  // The sort thread is done moving commands
+    // Lists that are neither queued nor being recorded are empty
+    for (int n = 0; n < OCL2DRI_COMMAND_LIST_COUNT; n++) {
+        OCL2DRI_CommandList* list = &ctx->command_lists[n];
+        for (int i = 0; i < list->count; i++) {
+            if (list->commands[i].resource == resource) list->commands[i].resource = NULL;
+        }
+    }
+    // Layers keep their commands; the ones that drew it are redrawn without it
+    for (int n = 0; n < ctx->layer_count; n++) {
+        OCL2DRI_Layer* layer = ctx->layers[n];
+        for (int i = 0; i < layer->staging.count; i++) {
+            if (layer->staging.commands[i].resource == resource) layer->staging.commands[i].resource = NULL;
+        }
+        for (int i = 0; i < layer->drawn.count; i++) {
+            if (layer->drawn.commands[i].resource != resource) continue;
+            layer->drawn.commands[i].resource = NULL;
+            layer->dirty = true;
+        }
+    }
+}
+
+EXPORT void ocl2dri_tilemap_destroy(OCL2DRI_Tilemap* map) {
+    if (!map) return;
+    ocl2dri_release_resource(map->ctx, map);
+    for (int i = 0; i < map->chunks_x * map->chunks_y; i++) {
+        free(map->chunks[i].rects);
+        free(map->chunks[i].groups);
+    }
+    free(map->scratch);
+    free(map->chunks);
+    free(map->tiles);
+    free(map);
+}
+
+static void ocl2dri_particles_step_scalar(OCL2DRI_Emitter* e, float dt) {
+    for (int i = 0; i < e->count; i++) {
+        e->vx[i] += e->gravity_x * dt;
+        e->vy[i] += e->gravity_y * dt;
+        e->x[i] += e->vx[i] * dt;
+        e->y[i] += e->vy[i] * dt;
+        e->life[i] -= dt;
+        e->fade[i] = SDL_max(e->life[i] * e->inv_life[i], 0.0f);
+    }
+}
+
+#ifdef OCL2DRI_X86
+OCL2DRI_TARGET_SSE static void ocl2dri_particles_step_sse(OCL2DRI_Emitter* e, float dt) {
+    const __m128 vdt = _mm_set1_ps(dt), zero = _mm_setzero_ps();
+    const __m128 gx = _mm_set1_ps(e->gravity_x * dt), gy = _mm_set1_ps(e->gravity_y * dt);
+    int i = 0;
+    for (; i + 4 <= e->count; i += 4) {
+        __m128 vx = _mm_add_ps(_mm_loadu_ps(&e->vx[i]), gx);
+        __m128 vy = _mm_add_ps(_mm_loadu_ps(&e->vy[i]), gy);
+        _mm_storeu_ps(&e->vx[i], vx);
+        _mm_storeu_ps(&e->vy[i], vy);
+        _mm_storeu_ps(&e->x[i], _mm_add_ps(_mm_loadu_ps(&e->x[i]), _mm_mul_ps(vx, vdt)));
+        _mm_storeu_ps(&e->y[i], _mm_add_ps(_mm_loadu_ps(&e->y[i]), _mm_mul_ps(vy, vdt)));
+        __m128 life = _mm_sub_ps(_mm_loadu_ps(&e->life[i]), vdt);
+        _mm_storeu_ps(&e->life[i], life);
+        _mm_storeu_ps(&e->fade[i], _mm_max_ps(_mm_mul_ps(life, _mm_loadu_ps(&e->inv_life[i])), zero));
+    }
+    for (; i < e->count; i++) {
+        e->vx[i] += e->gravity_x * dt;
+        e->vy[i] += e->gravity_y * dt;
+        e->x[i] += e->vx[i] * dt;
+        e->y[i] += e->vy[i] * dt;
+        e->life[i] -= dt;
+        e->fade[i] = SDL_max(e->life[i] * e->inv_life[i], 0.0f);
+    }
+}
+
+OCL2DRI_TARGET_AVX static void ocl2dri_particles_step_avx(OCL2DRI_Emitter* e, float dt) {
+    const __m256 vdt = _mm256_set1_ps(dt), zero = _mm256_setzero_ps();
+    const __m256 gx = _mm256_set1_ps(e->gravity_x * dt), gy = _mm256_set1_ps(e->gravity_y * dt);
+    int i = 0;
+    for (; i + 8 <= e->count; i += 8) {
+        __m256 vx = _mm256_add_ps(_mm256_loadu_ps(&e->vx[i]), gx);
+        __m256 vy = _mm256_add_ps(_mm256_loadu_ps(&e->vy[i]), gy);
+        _mm256_storeu_ps(&e->vx[i], vx);
+        _mm256_storeu_ps(&e->vy[i], vy);
+        _mm256_storeu_ps(&e->x[i], _mm256_add_ps(_mm256_loadu_ps(&e->x[i]), _mm256_mul_ps(vx, vdt)));
+        _mm256_storeu_ps(&e->y[i], _mm256_add_ps(_mm256_loadu_ps(&e->y[i]), _mm256_mul_ps(vy, vdt)));
+        __m256 life = _mm256_sub_ps(_mm256_loadu_ps(&e->life[i]), vdt);
+        _mm256_storeu_ps(&e->life[i], life);
+        _mm256_storeu_ps(&e->fade[i], _mm256_max_ps(_mm256_mul_ps(life, _mm256_loadu_ps(&e->inv_life[i])), zero));
+    }
+    for (; i < e->count; i++) {
+        e->vx[i] += e->gravity_x * dt;
+        e->vy[i] += e->gravity_y * dt;
+        e->x[i] += e->vx[i] * dt;
+        e->y[i] += e->vy[i] * dt;
+        e->life[i] -= dt;
+        e->fade[i] = SDL_max(e->life[i] * e->inv_life[i], 0.0f);
+    }
+}
+#endif
+
+// Widest kernel the CPU supports; OCL2DRI_PARTICLE_KERNEL=scalar|sse|avx caps it,
+// e.g. to compare them in a benchmark.
+static OCL2DRI_ParticleKernel ocl2dri_particle_kernel(void) {
+    static OCL2DRI_ParticleKernel kernel = NULL;
+    if (kernel) return kernel;
+    const char* forced = getenv("OCL2DRI_PARTICLE_KERNEL");
+    kernel = ocl2dri_particles_step_scalar;
+#ifdef OCL2DRI_X86
+    bool allow_avx = !forced || strcmp(forced, "avx") == 0;
+    bool allow_sse = allow_avx || strcmp(forced, "sse") == 0;
+    if (allow_avx && SDL_HasAVX()) {
+        kernel = ocl2dri_particles_step_avx;
+    } else if (allow_sse && SDL_HasSSE()) {
+        kernel = ocl2dri_particles_step_sse;
+    }
+#else
+    (void)forced;
+#endif
+    return kernel;
+}
+
+static float ocl2dri_emitter_random(OCL2DRI_Emitter* e) {
+    // xorshift32: cheap, and the same sequence on every run for record/replay
+    e->rng ^= e->rng << 13;
+    e->rng ^= e->rng >> 17;
+    e->rng ^= e->rng << 5;
+    return (e->rng >> 8) * (1.0f / 16777216.0f);
+}
+
+static void ocl2dri_emitter_spawn(OCL2DRI_Emitter* e, int count) {
+    count = SDL_min(count, e->capacity - e->count);
+    for (int n = 0; n < count; n++) {
+        int i = e->count++;
+        float angle = e->angle + (ocl2dri_emitter_random(e) - 0.5f) * e->spread;
+        float speed = e->speed_min + (e->speed_max - e->speed_min) * ocl2dri_emitter_random(e);
+        float life = e->life_min + (e->life_max - e->life_min) * ocl2dri_emitter_random(e);
+        e->x[i] = e->pos_x;
+        e->y[i] = e->pos_y;
+        e->vx[i] = SDL_cosf(angle) * speed;
+        e->vy[i] = SDL_sinf(angle) * speed;
+        e->life[i] = life;
+        e->inv_life[i] = 1.0f / SDL_max(life, 0.001f);
+        e->fade[i] = 1.0f;
+    }
+}
+
+// Advances every emitter by `dt` and records one batched quad draw per emitter.
+static void ocl2dri_step_emitters(OCL2DRI_Context* ctx, OCL2DRI_CommandList* list, float dt) {
+    OCL2DRI_ParticleKernel kernel = ctx->emitter_count ? ocl2dri_particle_kernel() : NULL;
+    for (int n = 0; n < ctx->emitter_count; n++) {
+        OCL2DRI_Emitter* e = ctx->emitters[n];
+        kernel(e, dt);
+        for (int i = 0; i < e->count;) {
+            if (e->life[i] > 0.0f) {
+                i++;
+                continue;
+            }
+            int last = --e->count;
+            e->x[i] = e->x[last];
+            e->y[i] = e->y[last];
+            e->vx[i] = e->vx[last];
+            e->vy[i] = e->vy[last];
+            e->life[i] = e->life[last];
+            e->inv_life[i] = e->inv_life[last];
+            e->fade[i] = e->fade[last];
+        }
+        e->spawn_debt += e->rate * dt;
+        int spawn = (int)e->spawn_debt;
+        e->spawn_debt -= spawn;
+        ocl2dri_emitter_spawn(e, spawn);
+        if (e->count == 0) continue;
+
+        int needed = list->vertex_count + e->count * 4;
+        if (needed > list->vertex_capacity) {
+            int capacity = list->vertex_capacity ? list->vertex_capacity : 1536;
+            while (capacity < needed) capacity *= 2;
+            SDL_Vertex* vertices = (SDL_Vertex*)realloc(list->vertices, capacity * sizeof(SDL_Vertex));
+            if (!vertices) continue;
+            list->vertices = vertices;
+            list->vertex_capacity = capacity;
+        }
+        OCL2DRI_Command* cmd = ocl2dri_append_command(ctx, list, OCL2DRI_CMD_PARTICLES);
+        if (!cmd) continue;
+        cmd->resource = e;
+        cmd->depth = e->depth;
+        cmd->first = list->vertex_count;
+        cmd->count = e->count * 4;
+
+        const float half = e->size * 0.5f;
+        const SDL_FColor c0 = e->end_color;
+        const SDL_FColor dc = {e->start_color.r - c0.r, e->start_color.g - c0.g,
+                               e->start_color.b - c0.b, e->start_color.a - c0.a};
+        SDL_Vertex* v = &list->vertices[list->vertex_count];
+        for (int i = 0; i < e->count; i++, v += 4) {
+            float t = e->fade[i];
+            SDL_FColor color = {c0.r + dc.r * t, c0.g + dc.g * t, c0.b + dc.b * t, c0.a + dc.a * t};
+            float x0 = e->x[i] - half, y0 = e->y[i] - half, x1 = e->x[i] + half, y1 = e->y[i] + half;
+            v[0] = (SDL_Vertex){{x0, y0}, color, {0.0f, 0.0f}};
+            v[1] = (SDL_Vertex){{x1, y0}, color, {0.0f, 0.0f}};
+            v[2] = (SDL_Vertex){{x0, y1}, color, {0.0f, 0.0f}};
+            v[3] = (SDL_Vertex){{x1, y1}, color, {0.0f, 0.0f}};
+        }
+        list->vertex_count = needed;
+    }
+}
+
+// Creates an emitter for up to `capacity` live particles. It spawns nothing until
+// given a rate or a burst; ocl2dri_update then moves and draws it every frame, at the
+// depth set when it was created.
+EXPORT OCL2DRI_Emitter* ocl2dri_emitter_create(OCL2DRI_Context* ctx, int capacity) {
+    if (!ctx || capacity <= 0 || ctx->emitter_count == OCL2DRI_MAX_EMITTERS) return NULL;
+    OCL2DRI_Emitter* e = (OCL2DRI_Emitter*)calloc(1, sizeof(OCL2DRI_Emitter));
+    if (!e) return NULL;
+    // One 32-byte aligned block; every array starts on a multiple of 8 floats
+    int stride = (capacity + 7) & ~7;
+    float* block = (float*)SDL_aligned_alloc(32, (size_t)stride * 7 * sizeof(float));
+    e->indices = (int*)malloc((size_t)capacity * 6 * sizeof(int));
+    if (!block || !e->indices) {
+        SDL_aligned_free(block);
+        free(e->indices);
+        free(e);
+        return NULL;
+    }
+    float** arrays[7] = {&e->x, &e->y, &e->vx, &e->vy, &e->life, &e->inv_life, &e->fade};
+    for (int a = 0; a < 7; a++) *arrays[a] = block + (size_t)a * stride;
+    for (int i = 0; i < capacity; i++) {
+        int* q = &e->indices[i * 6];
+        q[0] = i * 4;
+        q[1] = i * 4 + 1;
+        q[2] = i * 4 + 2;
+        q[3] = i * 4 + 2;
+        q[4] = i * 4 + 1;
+        q[5] = i * 4 + 3;
+    }
+    e->ctx = ctx;
+    e->capacity = capacity;
+    e->spread = 2.0f * SDL_PI_F;
+    e->speed_min = e->speed_max = 50.0f;
+    e->life_min = e->life_max = 1.0f;
+    e->size = 2.0f;
+    e->start_color = (SDL_FColor){1.0f, 1.0f, 1.0f, 1.0f};
+    e->end_color = (SDL_FColor){1.0f, 1.0f, 1.0f, 0.0f};
+    e->depth = ctx->depth;
+    e->rng = 0x9E3779B9u ^ (Uint32)(ctx->emitter_count + 1);
+    if (ctx->emitter_count == 0) ctx->particle_ns = SDL_GetTicksNS();
+    ctx->emitters[ctx->emitter_count++] = e;
+    return e;
+}
+
+EXPORT void ocl2dri_emitter_set_position(OCL2DRI_Emitter* e, float x, float y) {
+    if (!e) return;
+    e->pos_x = x;
+    e->pos_y = y;
+}
+
+EXPORT void ocl2dri_emitter_set_rate(OCL2DRI_Emitter* e, float per_second) {
+    if (!e) return;
+    e->rate = SDL_max(per_second, 0.0f);
+}
+
+// Particles leave at `angle` degrees (0 = right, 90 = down), give or take spread / 2.
+EXPORT void ocl2dri_emitter_set_velocity(OCL2DRI_Emitter* e, float angle, float spread, float speed_min, float speed_max) {
+    if (!e) return;
+    e->angle = angle * (SDL_PI_F / 180.0f);
+    e->spread = spread * (SDL_PI_F / 180.0f);
+    e->speed_min = speed_min;
+    e->speed_max = SDL_max(speed_min, speed_max);
+}
+
+EXPORT void ocl2dri_emitter_set_life(OCL2DRI_Emitter* e, float min_seconds, float max_seconds) {
+    if (!e) return;
+    e->life_min = SDL_max(min_seconds, 0.0f);
+    e->life_max = SDL_max(e->life_min, max_seconds);
+}
+
+EXPORT void ocl2dri_emitter_set_gravity(OCL2DRI_Emitter* e, float gx, float gy) {
+    if (!e) return;
+    e->gravity_x = gx;
+    e->gravity_y = gy;
+}
+
+EXPORT void ocl2dri_emitter_set_size(OCL2DRI_Emitter* e, float size) {
+    if (!e) return;
+    e->size = SDL_max(size, 0.0f);
+}
+
+// Particles fade linearly from the start colour at birth to the end colour at death.
+EXPORT void ocl2dri_emitter_set_colors(OCL2DRI_Emitter* e, Uint8 r0, Uint8 g0, Uint8 b0, Uint8 a0,
+                                       Uint8 r1, Uint8 g1, Uint8 b1, Uint8 a1) {
+    if (!e) return;
+    e->start_color = (SDL_FColor){r0 / 255.0f, g0 / 255.0f, b0 / 255.0f, a0 / 255.0f};
+    e->end_color = (SDL_FColor){r1 / 255.0f, g1 / 255.0f, b1 / 255.0f, a1 / 255.0f};
+}
+
+EXPORT void ocl2dri_emitter_burst(OCL2DRI_Emitter* e, int count) {
+    if (!e || count <= 0) return;
+    ocl2dri_emitter_spawn(e, count);
+}
+
+EXPORT int ocl2dri_emitter_count(OCL2DRI_Emitter* e) {
+    if (!e) return 0;
+    return e->count;
+}
+
+EXPORT void ocl2dri_emitter_destroy(OCL2DRI_Emitter* e) {
+    if (!e) return;
+    OCL2DRI_Context* ctx = e->ctx;
+    ocl2dri_release_resource(ctx, e);
+    for (int n = 0; n < ctx->emitter_count; n++) {
+        if (ctx->emitters[n] != e) continue;
+        memmove(&ctx->emitters[n], &ctx->emitters[n + 1], (ctx->emitter_count - n - 1) * sizeof(OCL2DRI_Emitter*));
+        ctx->emitter_count--;
+        break;
+    }
+    SDL_aligned_free(e->x);
+    free(e->indices);
+    free(e);
+}
+
+static bool ocl2dri_grow(void** buffer, int* capacity, int needed, size_t item_size) {
+    if (needed <= *capacity) return true;
+    int grown = *capacity ? *capacity : 64;
+    while (grown < needed) grown *= 2;
+    void* resized = realloc(*buffer, (size_t)grown * item_size);
+    if (!resized) return false;
+    *buffer = resized;
+    *capacity = grown;
+    return true;
+}
+
+static Uint32 ocl2dri_cell_slot(const OCL2DRI_SpatialHash* grid, int cx, int cy) {
+    // Neighbouring cells land near each other, which keeps the table cache-friendly
+    return ((Uint32)cx * 73856093u ^ (Uint32)cy * 19349663u) & (Uint32)grid->slot_mask;
+}
+
+// Returns the index of cell (cx, cy), or -1 if it holds nothing.
+static int ocl2dri_find_cell(const OCL2DRI_SpatialHash* grid, int cx, int cy) {
+    if (grid->cell_count == 0) return -1;
+    for (Uint32 slot = ocl2dri_cell_slot(grid, cx, cy);; slot = (slot + 1) & grid->slot_mask) {
+        const OCL2DRI_GridSlot* s = &grid->slots[slot];
+        if (s->index < 0 || (s->cx == cx && s->cy == cy)) return s->index;
+    }
+}
+
+// floor() to int without a libm call; cell lookups do four of these per box.
+static inline int ocl2dri_cell_coord(float value) {
+    int truncated = (int)value;
+    return truncated - (value < (float)truncated);
+}
+
+static void ocl2dri_cell_range(const OCL2DRI_SpatialHash* grid, const float* box, int* cx0, int* cy0, int* cx1, int* cy1) {
+    *cx0 = ocl2dri_cell_coord(box[0] * grid->inv_cell_size);
+    *cy0 = ocl2dri_cell_coord(box[1] * grid->inv_cell_size);
+    *cx1 = ocl2dri_cell_coord((box[0] + box[2]) * grid->inv_cell_size);
+    *cy1 = ocl2dri_cell_coord((box[1] + box[3]) * grid->inv_cell_size);
+}
+
+static bool ocl2dri_boxes_overlap(const float* a, const float* b) {
+    return a[0] < b[0] + b[2] && b[0] < a[0] + a[2] && a[1] < b[1] + b[3] && b[1] < a[1] + a[3];
+}
+
+EXPORT OCL2DRI_SpatialHash* ocl2dri_spatial_create(float cell_size) {
+    if (cell_size <= 0.0f) return NULL;
+    OCL2DRI_SpatialHash* grid = (OCL2DRI_SpatialHash*)calloc(1, sizeof(OCL2DRI_SpatialHash));
+    if (!grid) return NULL;
+    grid->cell_size = cell_size;
+    grid->inv_cell_size = 1.0f / cell_size;
+    return grid;
+}
+
+// Replaces every box with `count` x, y, w, h groups from `boxes`. The index is rebuilt
+// from scratch with a counting sort, which for boxes that all move each frame is
+// cheaper than patching cells. Returns false if memory ran out (the grid is then empty).
+EXPORT bool ocl2dri_spatial_update(OCL2DRI_SpatialHash* grid, const float* boxes, int count) {
+    if (!grid) return false;
+    grid->count = 0;
+    grid->cell_count = 0;
+    if (count <= 0 || !boxes) return true;
+    if (!ocl2dri_grow((void**)&grid->boxes, &grid->box_capacity, count * 4, sizeof(float))) return false;
+    memcpy(grid->boxes, boxes, (size_t)count * 4 * sizeof(float));
+
+    Sint64 entries = 0;
+    for (int i = 0; i < count; i++) {
+        int cx0, cy0, cx1, cy1;
+        ocl2dri_cell_range(grid, &boxes[i * 4], &cx0, &cy0, &cx1, &cy1);
+        entries += (Sint64)(cx1 - cx0 + 1) * (cy1 - cy0 + 1);
+    }
+    if (entries > SDL_MAX_SINT32 / 4) return false;  // Cells far too small for these boxes
+    int entry_count = (int)entries;
+    int slot_count = 64;
+    while (slot_count < entry_count + entry_count / 2) slot_count *= 2;
+    if (slot_count - 1 != grid->slot_mask || !grid->slots) {
+        OCL2DRI_GridSlot* slots = (OCL2DRI_GridSlot*)realloc(grid->slots, (size_t)slot_count * sizeof(OCL2DRI_GridSlot));
+        if (!slots) return false;
+        grid->slots = slots;
+        grid->slot_mask = slot_count - 1;
+    }
+    memset(grid->slots, 0, (size_t)slot_count * sizeof(OCL2DRI_GridSlot));
+    if (entry_count > grid->entry_capacity) {
+        int capacity = grid->entry_capacity ? grid->entry_capacity : 64;
+        while (capacity < entry_count) capacity *= 2;
+        int* entries = (int*)realloc(grid->entries, (size_t)capacity * sizeof(int));
+        if (entries) grid->entries = entries;
+        int* entry_cells = (int*)realloc(grid->entry_cells, (size_t)capacity * sizeof(int));
+        if (entry_cells) grid->entry_cells = entry_cells;
+        float* entry_boxes = (float*)realloc(grid->entry_boxes, (size_t)capacity * 4 * sizeof(float));
+        if (entry_boxes) grid->entry_boxes = entry_boxes;
+        if (!entries || !entry_cells || !entry_boxes) return false;
+        grid->entry_capacity = capacity;
+    }
+    if (!ocl2dri_grow((void**)&grid->cells, &grid->cell_capacity, entry_count, sizeof(OCL2DRI_GridCell))) return false;
+
+    // Pass 1: count entities per touched cell, remembering each entry's slot
+    int entry = 0;
+    for (int i = 0; i < count; i++) {
+        int cx0, cy0, cx1, cy1;
+        ocl2dri_cell_range(grid, &boxes[i * 4], &cx0, &cy0, &cx1, &cy1);
+        for (int cy = cy0; cy <= cy1; cy++) {
+            for (int cx = cx0; cx <= cx1; cx++) {
+                Uint32 slot = ocl2dri_cell_slot(grid, cx, cy);
+                OCL2DRI_GridSlot* s = &grid->slots[slot];
+                while (s->fill > 0 && (s->cx != cx || s->cy != cy)) {
+                    slot = (slot + 1) & grid->slot_mask;
+                    s = &grid->slots[slot];
+                }
+                s->cx = cx;
+                s->cy = cy;
+                s->fill++;
+                grid->entry_cells[entry++] = (int)slot;
+            }
+        }
+    }
+    // One sweep of the table lays the cells out and turns counts into write positions
+    int offset = 0;
+    for (int slot = 0; slot < slot_count; slot++) {
+        OCL2DRI_GridSlot* s = &grid->slots[slot];
+        if (s->fill == 0) {
+            s->index = -1;
+            continue;
+        }
+        s->index = grid->cell_count;
+        grid->cells[grid->cell_count++] = (OCL2DRI_GridCell){s->cx, s->cy, offset, s->fill};
+        int first = offset;
+        offset += s->fill;
+        s->fill = first;
+    }
+    // Pass 2: place ids in the same order, so each cell's run is in ascending id order
+    entry = 0;
+    for (int i = 0; i < count; i++) {
+        int cx0, cy0, cx1, cy1;
+        ocl2dri_cell_range(grid, &boxes[i * 4], &cx0, &cy0, &cx1, &cy1);
+        for (int n = (cx1 - cx0 + 1) * (cy1 - cy0 + 1); n > 0; n--) {
+            int position = grid->slots[grid->entry_cells[entry++]].fill++;
+            grid->entries[position] = i;
+            memcpy(&grid->entry_boxes[position * 4], &boxes[i * 4], 4 * sizeof(float));
+        }
+    }
+    grid->count = count;
+    return true;
+}
+
+// Writes up to max_pairs overlapping (a, b) id pairs, a < b, into `out` and returns how
+// many there are in total; call again with a bigger buffer if that is more than fit.
+// A pair sharing several cells is reported only by the cell holding the top-left corner
+// of the two boxes' intersection, so no de-duplication pass is needed.
+EXPORT int ocl2dri_spatial_query_pairs(OCL2DRI_SpatialHash* grid, int* out, int max_pairs) {
+    if (!grid) return 0;
+    int total = 0;
+    for (int c = 0; c < grid->cell_count; c++) {
+        const OCL2DRI_GridCell* cell = &grid->cells[c];
+        const int* ids = &grid->entries[cell->first];
+        const float* cell_boxes = &grid->entry_boxes[cell->first * 4];
+        for (int i = 0; i < cell->count; i++) {
+            const float* a = &cell_boxes[i * 4];
+            for (int j = i + 1; j < cell->count; j++) {
+                const float* b = &cell_boxes[j * 4];
+                if (!ocl2dri_boxes_overlap(a, b)) continue;
+                int ox = ocl2dri_cell_coord(SDL_max(a[0], b[0]) * grid->inv_cell_size);
+                int oy = ocl2dri_cell_coord(SDL_max(a[1], b[1]) * grid->inv_cell_size);
+                if (ox != cell->cx || oy != cell->cy) continue;
+                if (out && total < max_pairs) {
+                    out[total * 2] = ids[i];
+                    out[total * 2 + 1] = ids[j];
+                }
+                total++;
+            }
+        }
+    }
+    return total;
+}
+
+// Writes up to max_ids ids of boxes overlapping the rect, each once, and returns the total.
+EXPORT int ocl2dri_spatial_query_rect(OCL2DRI_SpatialHash* grid, float x, float y, float w, float h, int* out, int max_ids) {
+    if (!grid || grid->count == 0) return 0;
+    if (grid->count > grid->stamp_capacity || ++grid->stamp == 0) {
+        if (!ocl2dri_grow((void**)&grid->stamps, &grid->stamp_capacity, grid->count, sizeof(Uint32))) return 0;
+        memset(grid->stamps, 0, (size_t)grid->stamp_capacity * sizeof(Uint32));
+        grid->stamp = 1;
+    }
+    const float query[4] = {x, y, w, h};
+    int cx0, cy0, cx1, cy1;
+    ocl2dri_cell_range(grid, query, &cx0, &cy0, &cx1, &cy1);
+    // A rect covering more cells than are occupied is cheaper to answer by walking them all
+    bool scan = (Sint64)(cx1 - cx0 + 1) * (cy1 - cy0 + 1) > grid->cell_count;
+    int total = 0;
+    int c = 0, cx = cx0, cy = cy0;
+    for (;;) {
+        const OCL2DRI_GridCell* cell;
+        if (scan) {
+            if (c == grid->cell_count) break;
+            cell = &grid->cells[c++];
+            if (cell->cx < cx0 || cell->cx > cx1 || cell->cy < cy0 || cell->cy > cy1) continue;
+        } else {
+            if (cy > cy1) break;
+            int index = ocl2dri_find_cell(grid, cx, cy);
+            if (++cx > cx1) {
+                cx = cx0;
+                cy++;
+            }
+            if (index < 0) continue;
+            cell = &grid->cells[index];
+        }
+        for (int i = 0; i < cell->count; i++) {
+            int id = grid->entries[cell->first + i];
+            if (grid->stamps[id] == grid->stamp) continue;
+            grid->stamps[id] = grid->stamp;
+            if (!ocl2dri_boxes_overlap(query, &grid->boxes[id * 4])) continue;
+            if (out && total < max_ids) out[total] = id;
+            total++;
+        }
+    }
+    return total;
+}
+
+// Writes up to max_ids ids of boxes containing the point and returns the total.
+EXPORT int ocl2dri_spatial_query_point(OCL2DRI_SpatialHash* grid, float x, float y, int* out, int max_ids) {
+    if (!grid) return 0;
+    int index = ocl2dri_find_cell(grid, ocl2dri_cell_coord(x * grid->inv_cell_size), ocl2dri_cell_coord(y * grid->inv_cell_size));
+    if (index < 0) return 0;
+    const OCL2DRI_GridCell* cell = &grid->cells[index];
+    int total = 0;
+    for (int i = 0; i < cell->count; i++) {
+        int id = grid->entries[cell->first + i];
+        const float* box = &grid->boxes[id * 4];
+        if (x < box[0] || x >= box[0] + box[2] || y < box[1] || y >= box[1] + box[3]) continue;
+        if (out && total < max_ids) out[total] = id;
+        total++;
+    }
+    return total;
+}
+
+EXPORT void ocl2dri_spatial_destroy(OCL2DRI_SpatialHash* grid) {
+    if (!grid) return;
+    free(grid->boxes);
+    free(grid->cells);
+    free(grid->slots);
+    free(grid->entries);
+    free(grid->entry_boxes);
+    free(grid->entry_cells);
+    free(grid->stamps);
+    free(grid);
+}
+
+// Uploads whatever glyphs were added since the last frame, then draws `count` vertices.
+static void ocl2dri_render_text(SDL_Renderer* renderer, OCL2DRI_AtlasPage* page, const SDL_Vertex* vertices, int count) {
+    if (!page->atlas) {
+        page->atlas = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STATIC,
+                                        OCL2DRI_ATLAS_SIZE, OCL2DRI_ATLAS_SIZE);
+        if (page->atlas) {
+            SDL_SetTextureBlendMode(page->atlas, SDL_BLENDMODE_BLEND);
+            page->dirty = (SDL_Rect){0, 0, OCL2DRI_ATLAS_SIZE, OCL2DRI_ATLAS_SIZE};
+        }
+    }
+    if (page->atlas && page->dirty.w > 0) {
+        const Uint8* pixels = (const Uint8*)page->pixels->pixels + page->dirty.y * page->pixels->pitch + page->dirty.x * 4;
+        SDL_UpdateTexture(page->atlas, &page->dirty, pixels, page->pixels->pitch);
+        page->dirty.w = 0;
+    }
+    if (page->atlas) SDL_RenderGeometry(renderer, page->atlas, vertices, count, NULL, 0);
+}
+
+static OCL2DRI_AtlasPage* ocl2dri_create_page(OCL2DRI_Font* font) {
+    OCL2DRI_AtlasPage* page = (OCL2DRI_AtlasPage*)calloc(1, sizeof(OCL2DRI_AtlasPage));
+    if (!page) return NULL;
+    page->pixels = SDL_CreateSurface(OCL2DRI_ATLAS_SIZE, OCL2DRI_ATLAS_SIZE, SDL_PIXELFORMAT_ARGB8888);
+    if (!page->pixels) {
+        free(page);
+        return NULL;
+    }
+    page->font = font;
+    return page;
+}
+
+static void ocl2dri_destroy_page(OCL2DRI_AtlasPage* page) {
+    if (page->atlas) SDL_DestroyTexture(page->atlas);
+    SDL_DestroySurface(page->pixels);
+    free(page);
+}
+
+// Drops the page references of the TEXT commands in `list`, which is about to be
+// cleared, freeing retired pages that nothing draws from any more.
+static void ocl2dri_release_text(OCL2DRI_CommandList* list) {
+    for (int i = 0; i < list->count; i++) {
+        if (list->commands[i].type != OCL2DRI_CMD_TEXT) continue;
+        OCL2DRI_AtlasPage* page = (OCL2DRI_AtlasPage*)list->commands[i].resource;
+        if (--page->refs > 0 || page == page->font->page) continue;
+        OCL2DRI_AtlasPage** link = &page->font->page;
+        while (*link != page) link = &(*link)->next;
+        *link = page->next;
+        ocl2dri_destroy_page(page);
+    }
+}
+
+// Returns the glyph for `codepoint`, rasterizing it into the atlas on first use. When
+// the page is full a new one is started (or the old one reused if nothing refers to
+// it) and the generation bumped, which makes every cached string reshape.
+static const OCL2DRI_Glyph* ocl2dri_get_glyph(OCL2DRI_Font* font, Uint32 codepoint) {
+    Uint32 slot = (codepoint * 2654435761u) & (OCL2DRI_GLYPH_SLOTS - 1);
+    while (font->glyphs[slot].used) {
+        if (font->glyphs[slot].codepoint == codepoint) return &font->glyphs[slot];
+        slot = (slot + 1) & (OCL2DRI_GLYPH_SLOTS - 1);
+    }
+
+    SDL_Surface* surface = TTF_RenderGlyph_Blended(font->font, codepoint, (SDL_Color){255, 255, 255, 255});
+    int w = surface ? surface->w : 0, h = surface ? surface->h : 0;
+    if (w > OCL2DRI_ATLAS_SIZE || h > OCL2DRI_ATLAS_SIZE) w = h = 0;  // Never fits; draw nothing
+    bool full = font->glyph_count >= OCL2DRI_GLYPH_SLOTS * 3 / 4;
+    if (!full && font->pen_x + w > OCL2DRI_ATLAS_SIZE) {
+        font->pen_x = 0;
+        font->pen_y += font->row_h + 1;
+        font->row_h = 0;
+    }
+    if (full || font->pen_y + h > OCL2DRI_ATLAS_SIZE) {
+        if (font->page->refs > 0) {
+            OCL2DRI_AtlasPage* page = ocl2dri_create_page(font);
+            if (!page) {
+                // Nowhere to put it; draw nothing this time and try again next time
+                if (surface) SDL_DestroySurface(surface);
+                static OCL2DRI_Glyph missing;
+                return &missing;
+            }
+            page->next = font->page;
+            font->page = page;
+        }
+        memset(font->glyphs, 0, sizeof(font->glyphs));
+        font->glyph_count = 0;
+        font->pen_x = font->pen_y = font->row_h = 0;
+        font->generation++;
+        slot = (codepoint * 2654435761u) & (OCL2DRI_GLYPH_SLOTS - 1);
+    }
+
+    OCL2DRI_Glyph* glyph = &font->glyphs[slot];
+    glyph->codepoint = codepoint;
+    glyph->used = true;
+    glyph->rect = (SDL_Rect){0, 0, 0, 0};
+    glyph->advance = surface ? surface->w : 0;
+    TTF_GetGlyphMetrics(font->font, codepoint, NULL, NULL, NULL, NULL, &glyph->advance);
+    font->glyph_count++;
+    if (!surface) return glyph;
+
+    if (w > 0 && h > 0) {
+        glyph->rect = (SDL_Rect){font->pen_x, font->pen_y, w, h};
+        SDL_SetSurfaceBlendMode(surface, SDL_BLENDMODE_NONE);
+        SDL_Rect* dirty = &font->page->dirty;
+        SDL_BlitSurface(surface, NULL, font->page->pixels, &glyph->rect);
+        if (dirty->w == 0) {
+            *dirty = glyph->rect;
+        } else {
+            int x1 = SDL_max(dirty->x + dirty->w, glyph->rect.x + w);
+            int y1 = SDL_max(dirty->y + dirty->h, glyph->rect.y + h);
+            dirty->x = SDL_min(dirty->x, glyph->rect.x);
+            dirty->y = SDL_min(dirty->y, glyph->rect.y);
+            dirty->w = x1 - dirty->x;
+            dirty->h = y1 - dirty->y;
+        }
+        font->pen_x += w + 1;
+        font->row_h = SDL_max(font->row_h, h);
+    }
+    SDL_DestroySurface(surface);
+    return glyph;
+}
+
+// Lays `text` out into entry->quads. Returns false if a new page was started halfway,
+// leaving quads that point into different pages.
+static bool ocl2dri_shape_text(OCL2DRI_Font* font, const char* text, OCL2DRI_ShapedText* entry) {
+    size_t length = strlen(text);
+    OCL2DRI_GlyphQuad* quads = (OCL2DRI_GlyphQuad*)realloc(entry->quads, (length ? length : 1) * sizeof(OCL2DRI_GlyphQuad));
+    if (!quads) return true;
+    entry->quads = quads;
+    entry->quad_count = 0;
+    entry->generation = font->generation;
+
+    const float inv_size = 1.0f / OCL2DRI_ATLAS_SIZE;
+    float pen_x = 0.0f, pen_y = 0.0f;
+    Uint32 previous = 0;
+    while (length > 0) {
+        Uint32 codepoint = SDL_StepUTF8(&text, &length);
+        if (codepoint == '\n') {
+            pen_x = 0.0f;
+            pen_y += font->line_skip;
+            previous = 0;
+            continue;
+        }
+        int kerning = 0;
+        if (previous && TTF_GetGlyphKerning(font->font, previous, codepoint, &kerning)) pen_x += kerning;
+        previous = codepoint;
+
+        const OCL2DRI_Glyph* glyph = ocl2dri_get_glyph(font, codepoint);
+        if (glyph->rect.w > 0) {
+            const SDL_Rect* r = &glyph->rect;
+            entry->quads[entry->quad_count++] = (OCL2DRI_GlyphQuad){
+                pen_x, pen_y, (float)r->w, (float)r->h,
+                r->x * inv_size, r->y * inv_size, (r->x + r->w) * inv_size, (r->y + r->h) * inv_size};
+        }
+        pen_x += glyph->advance;
+    }
+    return entry->generation == font->generation;
+}
+
+// Finds `text` in the shaped-string cache, shaping it on a miss or when the page
+// it was shaped against has since been replaced.
+static const OCL2DRI_ShapedText* ocl2dri_lookup_text(OCL2DRI_Context* ctx, int font_index, const char* text) {
+    Uint64 hash = 14695981039346656037ull ^ (Uint64)font_index;
+    for (const unsigned char* c = (const unsigned char*)text; *c; c++) {
+        hash = (hash ^ *c) * 1099511628211ull;
+    }
+    OCL2DRI_ShapedText* set = ctx->text_cache[hash % OCL2DRI_TEXT_CACHE_SETS];
+    OCL2DRI_Font* font = ctx->fonts[font_index];
+
+    OCL2DRI_ShapedText* entry = NULL;
+    for (int way = 0; way < OCL2DRI_TEXT_CACHE_WAYS; way++) {
+        OCL2DRI_ShapedText* candidate = &set[way];
+        if (candidate->text && candidate->hash == hash && candidate->font == font_index &&
+            strcmp(candidate->text, text) == 0) {
+            entry = candidate;
+            break;
+        }
+    }
+    if (!entry) {
+        // Evict the least recently drawn string in the set
+        entry = &set[0];
+        for (int way = 1; way < OCL2DRI_TEXT_CACHE_WAYS && entry->text; way++) {
+            if (!set[way].text || set[way].last_used < entry->last_used) entry = &set[way];
+        }
+        char* copy = SDL_strdup(text);
+        if (!copy) return NULL;
+        SDL_free(entry->text);
+        entry->text = copy;
+        entry->hash = hash;
+        entry->font = font_index;
+        entry->generation = font->generation - 1;  // Forces shaping below
+    }
+    entry->last_used = ctx->frame_count;
+
+    if (entry->generation != font->generation) {
+        // A new page partway through means this string alone filled one; try once more
+        if (!ocl2dri_shape_text(font, text, entry)) ocl2dri_shape_text(font, text, entry);
+    }
+    return entry;
+}
+
+// Opens a TrueType font at `size` points. Returns its index for ocl2dri_draw_text,
+// or -1 on failure. Fonts live until the context is destroyed.
+EXPORT int ocl2dri_load_font(OCL2DRI_Context* ctx, const char* path, float size) {
+    if (!ctx || !path || size <= 0.0f || ctx->font_count == OCL2DRI_MAX_FONTS) return -1;
+    if (!ctx->ttf_ready) {
+        if (!TTF_Init()) return -1;
+        ctx->ttf_ready = true;
+    }
+    OCL2DRI_Font* font = (OCL2DRI_Font*)calloc(1, sizeof(OCL2DRI_Font));
+    if (!font) return -1;
+    font->font = TTF_OpenFont(path, size);
+    font->page = ocl2dri_create_page(font);
+    if (!font->font || !font->page) {
+        if (font->page) ocl2dri_destroy_page(font->page);
+        if (font->font) TTF_CloseFont(font->font);
+        free(font);
+        return -1;
+    }
+    font->line_skip = TTF_GetFontLineSkip(font->font);
+    ctx->fonts[ctx->font_count] = font;
+    return ctx->font_count++;
+}
+
+// Records `text` (UTF-8, '\n' starts a new line) with its top-left at (x, y) in the
+// current draw colour. Strings drawn again unchanged reuse their layout, so a frame
+// of labels costs one vertex copy per glyph and one draw call per font.
+EXPORT void ocl2dri_draw_text(OCL2DRI_Context* ctx, int font_index, float x, float y, const char* text) {
+    if (!ctx || !text || !*text || font_index < 0 || font_index >= ctx->font_count) return;
+    const OCL2DRI_ShapedText* shaped = ocl2dri_lookup_text(ctx, font_index, text);
+    if (!shaped || shaped->quad_count == 0) return;
+
+    // Cull on the laid-out bounds, then scale the glyphs with the camera
+    float left = shaped->quads[0].x, top = shaped->quads[0].y, right = left, bottom = top;
+    for (int i = 0; i < shaped->quad_count; i++) {
+        const OCL2DRI_GlyphQuad* q = &shaped->quads[i];
+        left = SDL_min(left, q->x);
+        top = SDL_min(top, q->y);
+        right = SDL_max(right, q->x + q->w);
+        bottom = SDL_max(bottom, q->y + q->h);
+    }
+    float bx = x + left, by = y + top, bw = right - left, bh = bottom - top;
+    if (!ocl2dri_place_box(ctx, &bx, &by, &bw, &bh)) return;
+    float zoom = ctx->camera_zoom;
+    x = bx - left * zoom;
+    y = by - top * zoom;
+
+    OCL2DRI_CommandList* list = ocl2dri_recording_list(ctx);
+    int needed = list->vertex_count + shaped->quad_count * 6;
+    if (needed > list->vertex_capacity) {
+        int capacity = list->vertex_capacity ? list->vertex_capacity : 1536;
+        while (capacity < needed) capacity *= 2;
+        SDL_Vertex* vertices = (SDL_Vertex*)realloc(list->vertices, capacity * sizeof(SDL_Vertex));
+        if (!vertices) return;
+        list->vertices = vertices;
+        list->vertex_capacity = capacity;
+    }
+    OCL2DRI_Command* cmd = ocl2dri_push_command(ctx, OCL2DRI_CMD_TEXT);
+    if (!cmd) return;
+    cmd->resource = ctx->fonts[font_index]->page;  // Where `shaped` was laid out
+    ((OCL2DRI_AtlasPage*)cmd->resource)->refs++;
+    cmd->first = list->vertex_count;
+    cmd->count = shaped->quad_count * 6;
+
+    SDL_FColor color = {ctx->draw_r / 255.0f, ctx->draw_g / 255.0f, ctx->draw_b / 255.0f, ctx->draw_a / 255.0f};
+    SDL_Vertex* v = &list->vertices[list->vertex_count];
+    for (int i = 0; i < shaped->quad_count; i++, v += 6) {
+        const OCL2DRI_GlyphQuad* q = &shaped->quads[i];
+        float x0 = x + q->x * zoom, y0 = y + q->y * zoom, x1 = x0 + q->w * zoom, y1 = y0 + q->h * zoom;
+        v[0] = (SDL_Vertex){{x0, y0}, color, {q->u0, q->v0}};
+        v[1] = (SDL_Vertex){{x1, y0}, color, {q->u1, q->v0}};
+        v[2] = (SDL_Vertex){{x0, y1}, color, {q->u0, q->v1}};
+        v[3] = v[2];
+        v[4] = v[1];
+        v[5] = (SDL_Vertex){{x1, y1}, color, {q->u1, q->v1}};
+    }
+    list->vertex_count = needed;
+}
+
+// Adds the layers and the stats overlay to a sorted frame, then draws and presents it.
+// The list is left empty for recording.
+static void ocl2dri_present_frame(OCL2DRI_Context* ctx, OCL2DRI_CommandList* list, OCL2DRI_FrameTiming* timing) {
+    ocl2dri_queue_layers(ctx, list);
+    ocl2dri_queue_stats_overlay(ctx, list);
+    ocl2dri_upload_textures(ctx, ctx->renderer);
+    ocl2dri_execute_commands(ctx->renderer, list, &ctx->draw_stats);
+    Uint64 present_start = SDL_GetTicksNS();
+    SDL_RenderPresent(ctx->renderer);
+    timing->present_ns += SDL_GetTicksNS() - present_start;
+    ocl2dri_release_text(list);
+    list->count = 0;
+    list->vertex_count = 0;
+    list->culled = 0;
+}
+
+// Stops the sort thread. With `flush` the frames still queued are presented in order,
+// otherwise they are dropped. What is being recorded moves to slot 0.
+static void ocl2dri_stop_pipeline(OCL2DRI_Context* ctx, bool flush) {
+    if (!ctx->pipelined) return;
+    ocl2dri_wait_sorted(ctx);
+    SDL_LockMutex(ctx->queue_mutex);
+    ctx->sort_quit = true;
+    SDL_BroadcastCondition(ctx->queue_cond);
+    SDL_UnlockMutex(ctx->queue_mutex);
+    SDL_WaitThread(ctx->sort_thread, NULL);
+    SDL_DestroyCondition(ctx->queue_cond);
+    SDL_DestroyMutex(ctx->queue_mutex);
+    ctx->sort_thread = NULL;
+    ctx->queue_cond = NULL;
+    ctx->queue_mutex = NULL;
+
+    for (; ctx->queue_count > 0; ctx->queue_count--) {
+        OCL2DRI_CommandList* list = &ctx->command_lists[ctx->queue_head];
+        if (flush) {
+            OCL2DRI_FrameTiming unused = {0, 0, 0, 0};  // Already inside the script's time
+            ocl2dri_present_frame(ctx, list, &unused);
+        } else {
+            ocl2dri_release_text(list);
+            list->count = 0;
+            list->vertex_count = 0;
+            list->culled = 0;
+        }
+        ctx->queue_head = (ctx->queue_head + 1) % (ctx->queue_depth + 1);
+    }
+    if (ctx->record_index != 0) {
+        OCL2DRI_CommandList tmp = ctx->command_lists[0];
+        ctx->command_lists[0] = ctx->command_lists[ctx->record_index];
+        ctx->command_lists[ctx->record_index] = tmp;
+    }
+    ctx->record_index = 0;
+    ctx->queue_head = 0;
+    ctx->sorted_count = 0;
+    ctx->pipelined = false;
+}
+
+// Switches between sorting each frame on the main thread just before presenting it
+// (the default) and pipelined mode, where a sort thread sorts frame N while the main
+// thread presents frame N - 1. Frames are then shown queue_depth (1-3) updates after
+// they are recorded. Presentation always stays on the main thread.
+EXPORT bool ocl2dri_set_pipelined(OCL2DRI_Context* ctx, bool enabled, int queue_depth) {
+    if (!ctx || !ctx->renderer) return false;
+    if (enabled == ctx->pipelined) return true;
+    if (!enabled) {
+        ocl2dri_stop_pipeline(ctx, true);
+        return true;
+    }
+
+    if (queue_depth < 1) queue_depth = 1;
+    if (queue_depth > OCL2DRI_MAX_QUEUE_DEPTH) queue_depth = OCL2DRI_MAX_QUEUE_DEPTH;
+    ctx->queue_mutex = SDL_CreateMutex();
+    ctx->queue_cond = SDL_CreateCondition();
+    ctx->queue_depth = queue_depth;
+    ctx->queue_head = 0;
+    ctx->queue_count = 0;
+    ctx->sorted_count = 0;
+    ctx->sort_quit = false;
+    ctx->sort_thread = ctx->queue_mutex && ctx->queue_cond
+        ? SDL_CreateThread(ocl2dri_sort_thread, "ocl2dri_sort", ctx) : NULL;
+    if (!ctx->sort_thread) {
+        if (ctx->queue_cond) SDL_DestroyCondition(ctx->queue_cond);
+        if (ctx->queue_mutex) SDL_DestroyMutex(ctx->queue_mutex);
+        ctx->queue_cond = NULL;
+        ctx->queue_mutex = NULL;
+        return false;
+    }
+    ctx->pipelined = true;  // record_index is 0 outside pipelined mode, the ring's first slot
+    return true;
+}
+
+// Hands the recorded frame to the sort thread. Once queue_depth frames wait behind
+// the oldest, that one is presented and its slot becomes the next to record into.
+// Returns the time spent on the older frame, which goes to that frame's timing slot.
+static Uint64 ocl2dri_submit_pipelined(OCL2DRI_Context* ctx) {
+    int slots = ctx->queue_depth + 1;
+    Uint64 spent_ns = 0;
+    SDL_LockMutex(ctx->queue_mutex);
+    ctx->queue_count++;
+    SDL_BroadcastCondition(ctx->queue_cond);
+    if (ctx->queue_count == slots) {
+        Uint64 start = SDL_GetTicksNS();
+        OCL2DRI_FrameTiming* timing = &ctx->frame_timings[(ctx->frame_count - ctx->queue_depth) % OCL2DRI_FRAME_HISTORY];
+        while (ctx->sorted_count == 0) SDL_WaitCondition(ctx->queue_cond, ctx->queue_mutex);
+        OCL2DRI_CommandList* oldest = &ctx->command_lists[ctx->queue_head];
+        SDL_UnlockMutex(ctx->queue_mutex);
+        Uint64 present_ns = timing->present_ns;
+        ocl2dri_present_frame(ctx, oldest, timing);  // The sort thread never touches a sorted frame
+        spent_ns = SDL_GetTicksNS() - start;
+        timing->submit_ns += spent_ns - (timing->present_ns - present_ns);
+        SDL_LockMutex(ctx->queue_mutex);
+        ctx->queue_head = (ctx->queue_head + 1) % slots;
+        ctx->queue_count--;
+        ctx->sorted_count--;
+    }
+    ctx->record_index = (ctx->queue_head + ctx->queue_count) % slots;
+    SDL_UnlockMutex(ctx->queue_mutex);
+    return spent_ns;
+}
+
 EXPORT void ocl2dri_update(OCL2DRI_Context* ctx) {
     if (!ctx || !ctx->renderer) return;
+    ocl2dri_layer_end(ctx);  // A layer left open ends with the frame
 
-    Uint32 frame_start = SDL_GetTicks();
+    Uint64 update_start = SDL_GetTicksNS();
+    // Stored once complete, so the overlay's summary never sees a half-written slot
+    OCL2DRI_FrameTiming timing = {update_start - ctx->frame_end_ns, 0, 0, 0};
 
-    SDL_SetRenderDrawColor(ctx->renderer, ctx->bg_r, ctx->bg_g, ctx->bg_b, 255);
-    SDL_RenderClear(ctx->renderer);
-    SDL_RenderPresent(ctx->renderer);
+    OCL2DRI_CommandList* list = &ctx->command_lists[ctx->record_index];
+    list->bg_r = ctx->bg_r;
+    list->bg_g = ctx->bg_g;
+    list->bg_b = ctx->bg_b;
+    list->state_sorting = ctx->state_sorting;
+    if (ctx->emitter_count) {
+        // Replays step with the recorded delta so particles come out the same
+        float dt = ctx->input_mode == OCL2DRI_INPUT_LIVE
+            ? (float)((double)(update_start - ctx->particle_ns) / SDL_NS_PER_SECOND) : ctx->input.delta_time;
+        ctx->particle_ns = update_start;
+        ocl2dri_step_emitters(ctx, list, SDL_min(dt, OCL2DRI_MAX_PARTICLE_DT));
+    }
+    // Sorted after the particles, so they sort by depth too
+    Uint64 older_ns = 0;  // Spent presenting an older frame, booked to that frame
+    if (ctx->pipelined) {
+        older_ns = ocl2dri_submit_pipelined(ctx);
+    } else {
+        ocl2dri_sort_commands(&ctx->sort, list, list->state_sorting);
+        ocl2dri_present_frame(ctx, list, &timing);
+    }
 
     SDL_Event event;
     while (SDL_PollEvent(&event)) {
         if (event.type == SDL_EVENT_QUIT) {
             ctx->running = false;
+        } else if (event.type == SDL_EVENT_WINDOW_PIXEL_SIZE_CHANGED) {
+            // The window is resizable; cull against what the next frame covers
+            ctx->width = event.window.data1;
+            ctx->height = event.window.data2;
         }
     }
 
-    Uint32 frame_time = SDL_GetTicks() - frame_start;
-    if (frame_time < ctx->frame_delay) {
-        SDL_Delay(ctx->frame_delay - frame_time);
+    if (ctx->input_mode == OCL2DRI_INPUT_RECORD) {
+        ocl2dri_record_frame(ctx);
+    } else if (ctx->input_mode == OCL2DRI_INPUT_REPLAY && !ocl2dri_replay_frame(ctx)) {
+        ctx->running = false;  // Recording exhausted
+    }
+
+    Uint64 now = SDL_GetTicksNS();
+    timing.submit_ns = now - update_start - timing.present_ns - older_ns;
+
+    // Pace the whole frame, script time included, to frame_delay. Headless runs go as
+    // fast as they can.
+    Uint64 frame_ns = now - ctx->frame_end_ns;
+    Uint64 deadline_ns = (Uint64)ctx->frame_delay * SDL_NS_PER_MS;
+    if (!ctx->headless && frame_ns < deadline_ns) {
+        SDL_DelayNS(deadline_ns - frame_ns);
+        Uint64 slept_until = SDL_GetTicksNS();
+        timing.sleep_ns = slept_until - now;
+        now = slept_until;
+    }
+    ctx->frame_end_ns = now;
+    ctx->frame_timings[ctx->frame_count % OCL2DRI_FRAME_HISTORY] = timing;
+    ctx->frame_count++;
+}
+
+// Summarizes the last OCL2DRI_FRAME_HISTORY frames. Returns false before the first frame.
+EXPORT bool ocl2dri_get_frame_stats(OCL2DRI_Context* ctx, OCL2DRI_FrameStats* out) {
+    if (!ctx || !out) return false;
+    memset(out, 0, sizeof(*out));
+    Uint64 frames = ocl2dri_timed_frames(ctx);
+    int count = frames < OCL2DRI_FRAME_HISTORY ? (int)frames : OCL2DRI_FRAME_HISTORY;
+    if (count == 0) return false;
+
+    Uint64 totals[OCL2DRI_FRAME_HISTORY];
+    Uint64 script = 0, submit = 0, present = 0, sleep = 0, sum = 0;
+    Uint64 deadline_ns = (Uint64)ctx->frame_delay * SDL_NS_PER_MS + OCL2DRI_DEADLINE_SLACK_NS;
+    for (int i = 0; i < count; i++) {
+        const OCL2DRI_FrameTiming* t = ocl2dri_frame_timing(ctx, frames - count + i);
+        totals[i] = ocl2dri_frame_total_ns(t);
+        script += t->script_ns;
+        submit += t->submit_ns;
+        present += t->present_ns;
+        sleep += t->sleep_ns;
+        sum += totals[i];
+        if (totals[i] > deadline_ns) out->missed++;
+    }
+    qsort(totals, count, sizeof(Uint64), ocl2dri_compare_u64);
+
+    const float ms = 1.0f / SDL_NS_PER_MS;
+    out->frames = count;
+    out->min_ms = totals[0] * ms;
+    out->max_ms = totals[count - 1] * ms;
+    out->avg_ms = (float)sum / count * ms;
+    // Nearest-rank percentiles
+    out->p50_ms = totals[(count * 50 + 99) / 100 - 1] * ms;
+    out->p95_ms = totals[(count * 95 + 99) / 100 - 1] * ms;
+    out->p99_ms = totals[(count * 99 + 99) / 100 - 1] * ms;
+    out->script_ms = (float)script / count * ms;
+    out->submit_ms = (float)submit / count * ms;
+    out->present_ms = (float)present / count * ms;
+    out->sleep_ms = (float)sleep / count * ms;
+    return true;
+}
+
+// Writes the recorded frames, oldest first, one CSV row per frame.
+EXPORT bool ocl2dri_export_frame_stats(OCL2DRI_Context* ctx, const char* path) {
+    if (!ctx || !path) return false;
+    FILE* file = fopen(path, "w");
+    if (!file) return false;
+    Uint64 deadline_ns = (Uint64)ctx->frame_delay * SDL_NS_PER_MS + OCL2DRI_DEADLINE_SLACK_NS;
+    Uint64 frames = ocl2dri_timed_frames(ctx);
+    Uint64 first = frames > OCL2DRI_FRAME_HISTORY ? frames - OCL2DRI_FRAME_HISTORY : 0;
+    fprintf(file, "frame,script_ms,submit_ms,present_ms,sleep_ms,total_ms,missed\n");
+    for (Uint64 frame = first; frame < frames; frame++) {
+        const OCL2DRI_FrameTiming* t = ocl2dri_frame_timing(ctx, frame);
+        Uint64 total = ocl2dri_frame_total_ns(t);
+        fprintf(file, "%llu,%.4f,%.4f,%.4f,%.4f,%.4f,%d\n", (unsigned long long)frame,
+                t->script_ns / 1e6, t->submit_ns / 1e6, t->present_ns / 1e6, t->sleep_ns / 1e6,
+                total / 1e6, total > deadline_ns);
     }
+    return fclose(file) == 0;
+}
+
+EXPORT void ocl2dri_set_stats_overlay(OCL2DRI_Context* ctx, bool enabled) {
+    if (!ctx) return;
+    ctx->stats_overlay = enabled;
 }
 
 EXPORT bool ocl2dri_is_running(OCL2DRI_Context* ctx) {
@@ -201,18 +2741,74 @@ EXPORT bool ocl2dri_is_running(OCL2DRI_Context* ctx) {
 
 EXPORT void ocl2dri_destroy(OCL2DRI_Context* ctx) {
     if (!ctx) return;
+    ocl2dri_stop_asset_workers(ctx);
+    ocl2dri_stop_pipeline(ctx, false);
     if (ctx->renderer) SDL_DestroyRenderer(ctx->renderer);
     if (ctx->window) SDL_DestroyWindow(ctx->window);
+    for (int i = 0; i < OCL2DRI_COMMAND_LIST_COUNT; i++) {
+        free(ctx->command_lists[i].commands);
+        free(ctx->command_lists[i].vertices);
+    }
+    for (int i = 0; i < ctx->emitter_count; i++) {
+        SDL_aligned_free(ctx->emitters[i]->x);
+        free(ctx->emitters[i]->indices);
+        free(ctx->emitters[i]);
+    }
+    for (int set = 0; set < OCL2DRI_TEXT_CACHE_SETS; set++) {
+        for (int way = 0; way < OCL2DRI_TEXT_CACHE_WAYS; way++) {
+            SDL_free(ctx->text_cache[set][way].text);
+            free(ctx->text_cache[set][way].quads);
+        }
+    }
+    for (int i = 0; i < ctx->font_count; i++) {
+        OCL2DRI_Font* font = ctx->fonts[i];
+        TTF_CloseFont(font->font);
+        while (font->page) {  // Their textures went with the renderer
+            OCL2DRI_AtlasPage* page = font->page;
+            font->page = page->next;
+            SDL_DestroySurface(page->pixels);
+            free(page);
+        }
+        free(font);
+    }
+    for (int i = 0; i < ctx->texture_count; i++) {
+        if (ctx->textures[i]->surface) SDL_DestroySurface(ctx->textures[i]->surface);
+        SDL_free(ctx->textures[i]->path);
+        free(ctx->textures[i]);
+    }
+    OCL2DRI_SortBuffers* buffers[2] = {&ctx->sort, &ctx->thread_sort};
+    for (int i = 0; i < 2; i++) {
+        free(buffers[i]->commands);
+        free(buffers[i]->items);
+        free(buffers[i]->vertices);
+    }
+    free(ctx->load_queue.items);
+    free(ctx->upload_queue.items);
+    for (int i = 0; i < ctx->layer_count; i++) {
+        OCL2DRI_Layer* layer = ctx->layers[i];
+        free(layer->drawn.commands);
+        free(layer->drawn.vertices);
+        free(layer->staging.commands);
+        free(layer->staging.vertices);
+        free(layer);
+    }
+    if (ctx->ttf_ready) TTF_Quit();
+    if (ctx->input_file) fclose(ctx->input_file);
+    if (ctx->stats_csv_path) {
+        ocl2dri_export_frame_stats(ctx, ctx->stats_csv_path);
+        SDL_free(ctx->stats_csv_path);
+    }
     free(ctx);
     SDL_Quit();
 }
 
 EXPORT int ocl2dri_get_key_state(OCL2DRI_Context* ctx, const char* key) {
     if (!ctx) return 0;
-    const Uint8* state = (const Uint8*)SDL_GetKeyboardState(NULL);
     SDL_Scancode scancode = SDL_GetScancodeFromName(key);
     if (scancode == SDL_SCANCODE_UNKNOWN) {
         return 0;  // Error logged in interpreter.py if needed
     }
+    if (ctx->input_mode != OCL2DRI_INPUT_LIVE) return ctx->input.keys[scancode];
+    const Uint8* state = (const Uint8*)SDL_GetKeyboardState(NULL);
     return state[scancode];
 }
@@ -0,0 +1,299 @@
+#ast_nodes.py
+"""AST node classes produced by the parser.
+
+Every node has __slots__ (no per-instance dict), an integer `kind` used to
+index the interpreter's dispatch tables, and the line/column of the token it
+started at. `fields` lists the child attributes in constructor order.
+"""
+
+(LITERAL, IDENTIFIER, BINARY, INDEX, ATTRIBUTE, CALL_METHOD, CALL,
+ DECLARE, ASSIGN, AUG_ASSIGN, PRINT, IF, WHILE, FOR_RANGE, FOR_EACH,
+ DEFINE, CLASS, RETURN, BREAK, CONTINUE, SPAWN, YIELD) = range(22)
+KIND_COUNT = 22
+
+class Node:
+    __slots__ = ('line', 'column')
+    kind = None
+    fields = ()
+
+    def __repr__(self):
+        values = ', '.join(f'{name}={getattr(self, name)!r}' for name in self.fields)
+        return f'{type(self).__name__}({values})'
+
+    def children(self):
+        """Yield the nodes directly below this one, including those nested in
+        lists and (condition, body) pairs."""
+        stack = [getattr(self, name) for name in reversed(self.fields)]
+        while stack:
+            value = stack.pop()
+            if isinstance(value, Node):
+                yield value
+            elif isinstance(value, (list, tuple)):
+                stack.extend(reversed(value))
+
+# Expressions
+
+class Literal(Node):
+    __slots__ = ('value',)
+    kind = LITERAL
+    fields = __slots__
+
+    def __init__(self, value, line, column):
+        self.value = value
+        self.line = line
+        self.column = column
+
+class Identifier(Node):
+    __slots__ = ('name',)
+    kind = IDENTIFIER
+    fields = __slots__
+
+    def __init__(self, name, line, column):
+        self.name = name
+        self.line = line
+        self.column = column
+
+class Binary(Node):
+    """`fn` is the operation specializer.py chose from the operand types, or
+    None when they are not known before the script runs."""
+    __slots__ = ('op', 'left', 'right', 'fn')
+    kind = BINARY
+    fields = ('op', 'left', 'right')
+
+    def __init__(self, op, left, right, line, column):
+        self.op = op
+        self.left = left
+        self.right = right
+        self.fn = None
+        self.line = line
+        self.column = column
+
+class Index(Node):
+    __slots__ = ('base', 'index')
+    kind = INDEX
+    fields = __slots__
+
+    def __init__(self, base, index, line, column):
+        self.base = base
+        self.index = index
+        self.line = line
+        self.column = column
+
+class Attribute(Node):
+    """`base.attr`. `shape`/`target` are this site's inline cache: the last
+    class shape seen and the slot index it resolved to."""
+    __slots__ = ('base', 'attr', 'shape', 'target')
+    kind = ATTRIBUTE
+    fields = ('base', 'attr')
+
+    def __init__(self, base, attr, line, column):
+        self.base = base
+        self.attr = attr
+        self.shape = None
+        self.target = None
+        self.line = line
+        self.column = column
+
+class CallMethod(Node):
+    """`obj.method(args)`. `shape`/`target` cache the last class shape seen
+    and the CompiledMethod it resolved to."""
+    __slots__ = ('obj', 'method', 'args', 'shape', 'target')
+    kind = CALL_METHOD
+    fields = ('obj', 'method', 'args')
+
+    def __init__(self, obj, method, args, line, column):
+        self.obj = obj
+        self.method = method
+        self.args = args
+        self.shape = None
+        self.target = None
+        self.line = line
+        self.column = column
+
+class Call(Node):
+    __slots__ = ('name', 'args')
+    kind = CALL
+    fields = __slots__
+
+    def __init__(self, name, args, line, column):
+        self.name = name
+        self.args = args
+        self.line = line
+        self.column = column
+
+class Spawn(Node):
+    """`spawn f(args)` or `spawn obj.method(args)`; `call` is the Call or
+    CallMethod node. Arguments are evaluated at the spawn, the body runs as a task."""
+    __slots__ = ('call',)
+    kind = SPAWN
+    fields = __slots__
+
+    def __init__(self, call, line, column):
+        self.call = call
+        self.line = line
+        self.column = column
+
+# Statements
+
+class Declare(Node):
+    """`proven` is set when the value always matches the annotation, so the
+    declaration needs no type check."""
+    __slots__ = ('name', 'type_annot', 'value', 'proven')
+    kind = DECLARE
+    fields = ('name', 'type_annot', 'value')
+
+    def __init__(self, name, type_annot, value, line, column):
+        self.name = name
+        self.type_annot = type_annot
+        self.value = value
+        self.proven = False
+        self.line = line
+        self.column = column
+
+class Assign(Node):
+    """`check` is the type an annotated target requires, when the value's
+    type is not known to match."""
+    __slots__ = ('target', 'value', 'check')
+    kind = ASSIGN
+    fields = ('target', 'value')
+
+    def __init__(self, target, value, line, column):
+        self.target = target
+        self.value = value
+        self.check = None
+        self.line = line
+        self.column = column
+
+class AugAssign(Node):
+    """`fn` and `check` are as for Binary and Assign."""
+    __slots__ = ('target', 'op', 'value', 'fn', 'check')
+    kind = AUG_ASSIGN
+    fields = ('target', 'op', 'value')
+
+    def __init__(self, target, op, value, line, column):
+        self.target = target
+        self.op = op
+        self.value = value
+        self.fn = None
+        self.check = None
+        self.line = line
+        self.column = column
+
+class Print(Node):
+    __slots__ = ('value',)
+    kind = PRINT
+    fields = __slots__
+
+    def __init__(self, value, line, column):
+        self.value = value
+        self.line = line
+        self.column = column
+
+class If(Node):
+    """`elifs` is a list of (condition, body) pairs; bodies are statement lists."""
+    __slots__ = ('condition', 'body', 'elifs', 'else_body')
+    kind = IF
+    fields = __slots__
+
+    def __init__(self, condition, body, elifs, else_body, line, column):
+        self.condition = condition
+        self.body = body
+        self.elifs = elifs
+        self.else_body = else_body
+        self.line = line
+        self.column = column
+
+class While(Node):
+    __slots__ = ('condition', 'body')
+    kind = WHILE
+    fields = __slots__
+
+    def __init__(self, condition, body, line, column):
+        self.condition = condition
+        self.body = body
+        self.line = line
+        self.column = column
+
+class ForRange(Node):
+    __slots__ = ('var', 'start', 'stop', 'step', 'body')
+    kind = FOR_RANGE
+    fields = __slots__
+
+    def __init__(self, var, start, stop, step, body, line, column):
+        self.var = var
+        self.start = start
+        self.stop = stop
+        self.step = step
+        self.body = body
+        self.line = line
+        self.column = column
+
+class ForEach(Node):
+    __slots__ = ('var', 'iterable', 'body')
+    kind = FOR_EACH
+    fields = __slots__
+
+    def __init__(self, var, iterable, body, line, column):
+        self.var = var
+        self.iterable = iterable
+        self.body = body
+        self.line = line
+        self.column = column
+
+class Define(Node):
+    """`params` is a list of (name, type_annot) pairs."""
+    __slots__ = ('name', 'params', 'body')
+    kind = DEFINE
+    fields = __slots__
+
+    def __init__(self, name, params, body, line, column):
+        self.name = name
+        self.params = params
+        self.body = body
+        self.line = line
+        self.column = column
+
+class ClassDef(Node):
+    __slots__ = ('name', 'methods')
+    kind = CLASS
+    fields = __slots__
+
+    def __init__(self, name, methods, line, column):
+        self.name = name
+        self.methods = methods
+        self.line = line
+        self.column = column
+
+class Return(Node):
+    __slots__ = ('value',)
+    kind = RETURN
+    fields = __slots__
+
+    def __init__(self, value, line, column):
+        self.value = value
+        self.line = line
+        self.column = column
+
+class Break(Node):
+    __slots__ = ()
+    kind = BREAK
+
+    def __init__(self, line, column):
+        self.line = line
+        self.column = column
+
+class Continue(Node):
+    __slots__ = ()
+    kind = CONTINUE
+
+    def __init__(self, line, column):
+        self.line = line
+        self.column = column
+
+class Yield(Node):
+    __slots__ = ()
+    kind = YIELD
+
+    def __init__(self, line, column):
+        self.line = line
+        self.column = column
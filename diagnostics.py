@@ -0,0 +1,142 @@
+#diagnostics.py
+"""Syntax checking for the editor, without running the script.
+
+`Checker` runs the real lexer and parser over a buffer and collects every
+syntax error plus a few static warnings. It remembers where each top-level
+statement started, by line and column. When the buffer changes, only the part
+from the start of the last statement before the first changed line is parsed
+again.
+
+`serve` is the `--check-server` loop the editor talks to over pipes:
+    request:  b"CHECK <byte count>\\n" followed by that many bytes of UTF-8 source
+    reply:    one b"<E|W> <line> <column> <message>\\n" per diagnostic, then b"END\\n"
+"""
+import re
+import sys
+from lexer import Lexer, LexerError
+from parser import Parser
+from ast_nodes import Define, ClassDef, While, ForRange, ForEach, If, RETURN, BREAK, CONTINUE, YIELD
+
+POSITION = re.compile(r'\s*(?:at )?[Ll]ine (\d+), column (\d+):\s*')
+
+class Checker:
+    def __init__(self):
+        self.lexer = Lexer()
+        self.parser = Parser(self.lexer)
+        self.lines = None
+        self.statement_starts = []  # (line, column) of each top-level statement, in order
+        self.diagnostics = []       # (severity, line, column, message), sorted by position
+        self.offset = 0             # While parsing: lines before the parsed suffix
+        self.shift = 0              # and columns before it on its first line
+
+    def check(self, source):
+        lines = source.split('\n')
+        if lines == self.lines:
+            return self.diagnostics
+
+        first_changed = 1
+        if self.lines is not None:
+            limit = min(len(lines), len(self.lines))
+            while first_changed <= limit and lines[first_changed - 1] == self.lines[first_changed - 1]:
+                first_changed += 1
+        # A statement may peek one token past its end, so restart from the last
+        # statement that began on a line before the change, not the one containing it.
+        # The restart is at its exact column: another statement may end on that line.
+        start = (1, 1)
+        for position in self.statement_starts:
+            if position[0] >= first_changed:
+                break
+            start = position
+
+        self.lines = lines
+        self.statement_starts = [position for position in self.statement_starts if position < start]
+        self.diagnostics = [d for d in self.diagnostics if (d[1], d[2]) < start]
+        self.parse_from(start)
+        self.diagnostics.sort(key=lambda d: (d[1], d[2]))
+        return self.diagnostics
+
+    def locate(self, line, column):
+        """Maps a position in the parsed suffix to one in the buffer."""
+        return line + self.offset, (column + self.shift if line == 1 else column)
+
+    def parse_from(self, start):
+        line, column = start
+        self.offset, self.shift = line - 1, column - 1
+        suffix = '\n'.join([self.lines[line - 1][column - 1:]] + self.lines[line:])
+        last_line = len(self.lines)
+
+        def add_error(error, severity='E'):
+            message = str(error)
+            match = POSITION.search(message)
+            if match:
+                line, column = self.locate(int(match.group(1)), int(match.group(2)))
+                message = f"{message[:match.start()]} {message[match.end():]}"  # Keeps "Invalid token" from lexer errors
+            else:
+                line, column = last_line, 1  # Errors at EOF carry no position
+            self.diagnostics.append((severity, line, column, message.strip().replace('\n', ' ')))
+
+        self.parser.on_error = add_error
+        try:
+            self.parser.tokens = self.lexer.iter_tokens(suffix)
+            self.parser.advance()
+            for stmt in self.parser.program():
+                self.statement_starts.append(self.locate(stmt.line, stmt.column))
+                self.warn(stmt, in_function=False, in_loop=False)
+        except SyntaxError as e:
+            add_error(e)
+        finally:
+            self.parser.on_error = None
+
+    def warn(self, node, in_function, in_loop):
+        """Flags statements after return/break/continue in the same body,
+        break/continue/return where they would silently end the script, and
+        yield where no task could be running."""
+        kind = node.kind
+        if kind == RETURN and not in_function:
+            self.warning(node, "'return' outside a function stops the script")
+        elif kind in (BREAK, CONTINUE) and not in_loop:
+            name = 'break' if kind == BREAK else 'continue'
+            self.warning(node, f"'{name}' outside a loop stops the script")
+        elif kind == YIELD and not in_function:
+            self.warning(node, "'yield' outside a function fails: only spawned tasks can yield")
+
+        if isinstance(node, Define):
+            self.warn_body(node.body, True, False)
+        elif isinstance(node, ClassDef):
+            for method in node.methods:
+                self.warn_body(method.body, True, False)
+        elif isinstance(node, (While, ForRange, ForEach)):
+            self.warn_body(node.body, in_function, True)
+        elif isinstance(node, If):
+            self.warn_body(node.body, in_function, in_loop)
+            for _, body in node.elifs:
+                self.warn_body(body, in_function, in_loop)
+            if node.else_body:
+                self.warn_body(node.else_body, in_function, in_loop)
+
+    def warn_body(self, body, in_function, in_loop):
+        for i, stmt in enumerate(body):
+            self.warn(stmt, in_function, in_loop)
+            if stmt.kind in (RETURN, BREAK, CONTINUE) and i + 1 < len(body):
+                self.warning(body[i + 1], "Unreachable statement")
+                break
+
+    def warning(self, node, message):
+        self.diagnostics.append(('W', *self.locate(node.line, node.column), message))
+
+def serve(stdin=None, stdout=None):
+    stdin = stdin or sys.stdin.buffer
+    stdout = stdout or sys.stdout.buffer
+    checker = Checker()
+    while True:
+        header = stdin.readline()
+        if not header:
+            return
+        parts = header.split()
+        if len(parts) != 2 or parts[0] != b'CHECK':
+            continue
+        source = stdin.read(int(parts[1])).decode('utf-8', errors='replace')
+        for severity, line, column, message in checker.check(source):
+            stdout.write(f"{severity} {line} {column} {message}\n".encode('utf-8'))
+        stdout.write(b"END\n")
+        stdout.flush()
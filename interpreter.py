@@ -1,91 +1,658 @@
 # interpreter.py
 import re
+import heapq
+import threading
 import traceback
 import sys
-import ctypes
 import os
 import time
+import array
+import operator
+from itertools import repeat
+from specializer import Specializer, SCALAR_TYPES
+from ast_nodes import (
+    KIND_COUNT, LITERAL, IDENTIFIER, BINARY, INDEX, ATTRIBUTE, CALL_METHOD, CALL, DECLARE, ASSIGN,
+    AUG_ASSIGN, PRINT, IF, WHILE, FOR_RANGE, FOR_EACH, DEFINE, CLASS, RETURN as RETURN_KIND, BREAK as BREAK_KIND,
+    CONTINUE as CONTINUE_KIND, SPAWN, YIELD
+)
 
-class ReturnException(Exception):
-    def __init__(self, value):
-        self.value = value
+class Completion:
+    """Abrupt completion of a statement, returned up through execute_block."""
+    __slots__ = ('kind',)
+
+    def __init__(self, kind):
+        self.kind = kind
+
+    def __repr__(self):
+        return f'<{self.kind}>'
+
+BREAK = Completion('break')
+CONTINUE = Completion('continue')
+RETURN = Completion('return')  # the value travels in Interpreter.return_value
+
+class OclArray:
+    """Fixed-size numeric array backed by contiguous typed storage.
+
+    Bulk operations run as C-level iteration over the underlying array.array,
+    so no interpreted code executes per element. Float arrays use 32-bit
+    storage so they can be handed to OCL2DRI without conversion.
+    """
+    __slots__ = ('data', 'elem_type')
+    typecodes = {'float': 'f', 'int': 'i'}
+
+    def __init__(self, size, elem_type='float'):
+        if elem_type not in self.typecodes:
+            raise ValueError(f"Unsupported array element type '{elem_type}' (expected 'float' or 'int')")
+        if size < 0:
+            raise ValueError("Array size cannot be negative")
+        self.elem_type = elem_type
+        self.data = array.array(self.typecodes[elem_type], bytes(size * array.array(self.typecodes[elem_type]).itemsize))
+
+    def __len__(self):
+        return len(self.data)
+
+    def __str__(self):
+        return '[' + ', '.join(str(value) for value in self.data) + ']'
+
+    def _store(self, values):
+        try:
+            self.data[:] = array.array(self.data.typecode, values)
+        except TypeError:
+            raise ValueError(f"Result does not fit an array of type '{self.elem_type}'")
+
+    def _operand(self, other, op_name):
+        if isinstance(other, OclArray):
+            if len(other) != len(self):
+                raise ValueError(f"Array {op_name} expects arrays of equal length, got {len(self)} and {len(other)}")
+            return other.data
+        if isinstance(other, (int, float)) and not isinstance(other, bool):
+            return repeat(other, len(self))
+        raise ValueError(f"Array {op_name} expects an array or a number")
+
+    def add(self, other):
+        self._store(map(operator.add, self.data, self._operand(other, 'add')))
+
+    def add_scaled(self, other, factor):
+        if not isinstance(other, OclArray) or len(other) != len(self):
+            raise ValueError("Array add_scaled expects an array of equal length and a number")
+        self._store(map(operator.add, self.data, map(operator.mul, other.data, repeat(factor, len(self)))))
+
+    def scale(self, factor):
+        self._store(map(operator.mul, self.data, self._operand(factor, 'scale')))
+
+    def clamp(self, low, high):
+        self._store(map(min, map(max, self.data, repeat(low, len(self))), repeat(high, len(self))))
+
+    def fill(self, value):
+        self._store(repeat(value, len(self)))
+
+    def sum(self):
+        return sum(self.data)
+
+    def dot(self, other):
+        return sum(map(operator.mul, self.data, self._operand(other, 'dot')))
+
+    def length(self):
+        return len(self.data)
+
+    methods = {'add': 1, 'add_scaled': 2, 'scale': 1, 'clamp': 2, 'fill': 1, 'sum': 0, 'dot': 1, 'length': 0}
+
+class OclStringBuilder:
+    """Mutable string assembled from appended pieces.
+
+    Appending keeps a reference to the piece, so building a string of n
+    characters costs O(n) overall instead of the O(n^2) of repeated `+`.
+    The joined text is cached until the next append.
+    """
+    __slots__ = ('parts', 'size', 'text')
+    methods = {'append': 1, 'join': 1, 'to_string': 0, 'length': 0, 'clear': 0}
+
+    def __init__(self):
+        self.parts = []
+        self.size = 0
+        self.text = ''
+
+    def __str__(self):
+        return self.to_string()
+
+    def append(self, value):
+        piece = str(value) if value is not None else "null"
+        self.parts.append(piece)
+        self.size += len(piece)
+        self.text = None
+
+    def join(self, separator):
+        """The appended pieces with `separator` between them."""
+        if not isinstance(separator, str):
+            raise ValueError("String builder join expects a string separator")
+        return separator.join(self.parts)
+
+    def to_string(self):
+        if self.text is None:
+            self.text = ''.join(self.parts)
+        return self.text
+
+    def length(self):
+        return self.size
+
+    def clear(self):
+        self.parts = []
+        self.size = 0
+        self.text = ''
+
+_UNSET = object()
+
+class CompiledMethod:
+    """A class method with its parameter binding worked out at definition time.
+    `param_checks` lists the annotated parameters checked on each call."""
+    __slots__ = ('name', 'body', 'has_self', 'param_names', 'arity', 'param_checks')
+
+    def __init__(self, name, params, body, specializer):
+        self.name = name
+        self.body = body
+        self.has_self = bool(params) and params[0][0] == 'self'
+        params = params[1 if self.has_self else 0:]
+        self.param_names = [param for param, _ in params]
+        self.arity = len(self.param_names)
+        self.param_checks = specializer.function(params, body)
+
+class ClassShape:
+    """Field layout and method table shared by instances of a class.
+
+    Slot indices never change once a shape exists. Assigning a field that the
+    class methods never mention moves the instance to a cached child shape, so
+    inline caches keyed on a shape stay valid.
+    """
+    __slots__ = ('name', 'fields', 'methods', 'transitions')
+
+    def __init__(self, name, fields, methods):
+        self.name = name
+        self.fields = fields
+        self.methods = methods
+        self.transitions = {}
+
+    def with_field(self, field):
+        child = self.transitions.get(field)
+        if child is None:
+            child = ClassShape(self.name, {**self.fields, field: len(self.fields)}, self.methods)
+            self.transitions[field] = child
+        return child
+
+class OclObject:
+    """Class instance storing its fields in fixed slots described by its shape."""
+    __slots__ = ('shape', 'slots')
+
+    def __init__(self, shape):
+        self.shape = shape
+        self.slots = [_UNSET] * len(shape.fields)
+
+    def get_field(self, name):
+        index = self.shape.fields.get(name)
+        return _UNSET if index is None else self.slots[index]
+
+    def set_field(self, name, value):
+        index = self.shape.fields.get(name)
+        if index is None:
+            self.shape = self.shape.with_field(name)
+            self.slots.append(value)
+        else:
+            self.slots[index] = value
+
+    def __str__(self):
+        fields = {'__class__': self.shape.name}
+        for name, index in self.shape.fields.items():
+            if self.slots[index] is not _UNSET:
+                fields[name] = self.slots[index]
+        return str(fields)
+
+class TaskCancelled(BaseException):
+    """Unwinds a cancelled task's thread. Not an Exception, so the handlers
+    that tag and report script errors let it pass."""
+
+class OclTask:
+    """A function or method call started with `spawn`.
+
+    `state` holds the task's saved interpreter state while it is parked in a
+    wait, and is None while it runs or once it has finished. `parent` is the
+    task that last resumed it, None for the main script."""
+    __slots__ = ('name', 'run', 'thread', 'baton', 'resumer', 'parent', 'state', 'done', 'cancelled', 'error')
+
+    def __init__(self, name, run):
+        self.name = name
+        self.run = run
+        self.thread = None
+        self.baton = threading.Semaphore(0)
+        self.resumer = None
+        self.parent = None
+        self.state = None
+        self.done = False
+        self.cancelled = False
+        self.error = None
+
+    def __str__(self):
+        if self.done:
+            status = 'cancelled' if self.cancelled else 'done'
+        else:
+            status = 'waiting' if self.state is not None else 'running'
+        return f'<task {self.name} {status}>'
+
+class Scheduler:
+    """Runs spawned tasks cooperatively, one at a time, on the interpreter.
+
+    The evaluator is recursive, so a task cannot be suspended mid-statement
+    by returning; each task runs on its own thread instead, and a semaphore
+    handoff guarantees only one thread is ever interpreting. A parked task
+    sits in a heap keyed by the frame or clock time it waits for, so tick()
+    only touches tasks that are due and sleeping tasks use no CPU. Each live
+    task still holds a parked thread and its stack, so at most MAX_LIVE
+    tasks may exist at once. Interpreter state that lives on the Interpreter
+    itself (variables, return_value, current_line) is swapped at every
+    handoff."""
+
+    MAX_LIVE = 1024
+
+    def __init__(self, interp):
+        self.interp = interp
+        self.current = None
+        self.main_baton = threading.Semaphore(0)
+        self.owner = threading.get_ident()
+        self.aborting = False  # Set while an interrupted resume() unwinds the running tasks
+        self.frame = 0
+        self.clock = time.perf_counter()
+        self.frame_waits = []  # (frame, seq, task)
+        self.time_waits = []   # (clock, seq, task)
+        self.seq = 0
+        self.live = 0
+        self.spawned = 0
+        self.resumes = 0
+        self.ticks = 0
+        self.tick_seconds = 0.0
+        self.max_tick_seconds = 0.0
+
+    def spawn(self, name, run):
+        """Start `run` as a task and run it until its first wait."""
+        if self.live >= self.MAX_LIVE:
+            raise ValueError(f"Cannot spawn '{name}': {self.live} tasks are already live (limit {self.MAX_LIVE})")
+        task = OclTask(name, run)
+        task.thread = threading.Thread(target=self.task_main, args=(task,), name=f'ocl-task-{name}', daemon=True)
+        self.spawned += 1
+        self.live += 1
+        self.resume(task)
+        return task
+
+    def task_main(self, task):
+        try:
+            task.run()
+        except TaskCancelled:
+            pass
+        except Exception as e:
+            task.error = e
+        finally:
+            task.done = True
+            self.live -= 1
+            task.resumer.release()
+
+    def resume(self, task):
+        """Hand the interpreter to `task` and block until it waits, finishes
+        or fails. An error raised in the task is re-raised here. If this thread
+        is interrupted meanwhile (Ctrl+C), the running tasks are unwound before
+        the interrupt is re-raised, so no task is left running beside it."""
+        interp = self.interp
+        saved = (interp.variables, interp.return_value, interp.current_line)
+        previous = self.current
+        task.resumer = previous.baton if previous is not None else self.main_baton
+        task.parent = previous
+        self.current = task
+        self.resumes += 1
+        try:
+            if task.thread.ident is None:
+                task.thread.start()
+            else:
+                task.baton.release()
+            task.resumer.acquire()
+        except BaseException:
+            self.unwind(task)
+            raise
+        finally:
+            self.current = previous
+            interp.variables, interp.return_value, interp.current_line = saved
+        if previous is not None and previous.cancelled:
+            raise TaskCancelled()  # Cancelled while it waited on `task`
+        if task.error is not None:
+            error, task.error = task.error, None
+            raise error
+
+    def unwind(self, task):
+        """Cancel the running task and the tasks that resumed it, up to `task`,
+        and block until control comes back from `task`. Their threads raise
+        TaskCancelled at the next block they enter (see check_abort)."""
+        running = self.current
+        while running is not None:
+            running.cancelled = True
+            if running is task:
+                break
+            running = running.parent
+        if task.thread.ident is None:
+            return
+        self.aborting = True
+        try:
+            while True:
+                try:
+                    task.resumer.acquire()
+                    return
+                except KeyboardInterrupt:
+                    pass  # Already unwinding; keep waiting
+        finally:
+            self.aborting = False
+
+    def check_abort(self):
+        if threading.get_ident() != self.owner:
+            raise TaskCancelled()
+
+    def suspend(self, heap, wake):
+        """Park the current task until tick() finds `wake` is due. Runs on the
+        task's own thread."""
+        task = self.current
+        if task.cancelled:
+            raise TaskCancelled()
+        interp = self.interp
+        self.seq += 1
+        heapq.heappush(heap, (wake, self.seq, task))
+        task.state = (interp.variables, interp.return_value, interp.current_line)
+        task.resumer.release()
+        task.baton.acquire()
+        interp.variables, interp.return_value, interp.current_line = task.state
+        task.state = None
+        if task.cancelled:
+            raise TaskCancelled()
+
+    def wait_frames(self, frames):
+        self.suspend(self.frame_waits, self.frame + max(1, frames))
+
+    def wait(self, seconds):
+        self.suspend(self.time_waits, self.clock + seconds)
+
+    def tick(self):
+        """Advance one frame and resume the tasks whose wait has expired, in
+        the order they started waiting."""
+        started = time.perf_counter()
+        self.frame += 1
+        self.clock = started
+        frame_waits, time_waits = self.frame_waits, self.time_waits
+        if not ((frame_waits and frame_waits[0][0] <= self.frame) or (time_waits and time_waits[0][0] <= started)):
+            return
+        due = []
+        while frame_waits and frame_waits[0][0] <= self.frame:
+            due.append((heapq.heappop(frame_waits), frame_waits))
+        while time_waits and time_waits[0][0] <= started:
+            due.append((heapq.heappop(time_waits), time_waits))
+        due.sort(key=lambda item: item[0][1])
+        resumed = 0
+        try:
+            for (_, _, task), _ in due:
+                resumed += 1
+                if not task.done:
+                    self.resume(task)
+        finally:
+            # A task that raised leaves the rest unresumed; park them again so
+            # the next tick or shutdown still reaches them
+            for entry, heap in due[resumed:]:
+                heapq.heappush(heap, entry)
+            elapsed = time.perf_counter() - started
+            self.ticks += 1
+            self.tick_seconds += elapsed
+            self.max_tick_seconds = max(self.max_tick_seconds, elapsed)
+
+    def cancel(self, task):
+        if task.done:
+            return
+        task.cancelled = True
+        if task is self.current:
+            raise TaskCancelled()
+        if task.state is not None:
+            self.resume(task)  # wakes inside suspend() and unwinds
+
+    def shutdown(self):
+        """Cancel every task still waiting, so none is left parked."""
+        for _, _, task in sorted(self.frame_waits + self.time_waits, key=lambda entry: entry[1]):
+            if not task.done:
+                try:
+                    self.cancel(task)
+                except Exception:
+                    pass
+        self.frame_waits.clear()
+        self.time_waits.clear()
+
+    def summary(self):
+        average = self.tick_seconds / self.ticks * 1000 if self.ticks else 0.0
+        return (f"[tasks] {self.spawned} spawned, {self.live} live, {self.resumes} resumes over {self.frame} frames; "
+                f"scheduler {self.tick_seconds * 1000:.2f} ms total, {average:.3f} ms avg, "
+                f"{self.max_tick_seconds * 1000:.3f} ms max per resuming frame")
 
 class Interpreter:
     def __init__(self):
         self.variables = {'input_value': ''}
         self.functions = {}
         self.classes = {}
-        self.type_map = {'int': int, 'float': float, 'bool': bool, 'string': str}
+        self.type_map = {'int': int, 'float': float, 'bool': bool, 'string': str, 'array': OclArray}
         self.debug_mode = False
         self.saucerful_rate = 0  # Start at 0, no upper limit
         self.last_error = None
         self.error_logged = False
+        self.return_value = None
+        self.call_value = None  # Result of the last call statement; a body ending in one returns it
+        self.current_line = None
+        self.build_dispatch_tables()
+        self._ocl2dri_lib = None
+        self.ocl2dri_path, self.ocl2dri_build_hint = self.probe_ocl2dri()
+        self.global_variables = self.variables  # self.variables is swapped for a frame copy inside calls
+        self.hot_reload_path = None
+        self.hot_reload_stamp = None
+        self.scheduler = Scheduler(self)
+        self.specializer = Specializer()
+        # print output is held until a frame ends, input is read, the script
+        # calls ocl.flush() or exits, or output_limit characters are waiting
+        self.output = []
+        self.output_size = 0
+        self.output_limit = 1 << 16
+        self.global_types = {}  # annotated globals, as tracked by the specializer between top-level statements
+        self.param_checks = {}  # function name -> annotated parameters checked on each call
 
-        # Check 1: DLL and SDL setup
-        dll_base_path = os.path.dirname(__file__)
-        dll_path = os.path.join(dll_base_path, 'OCL2DRI', 'ocl2dri.dll')
-        sdl_dir = r"C:\SDL3-3.2.4\x86_64-w64-mingw32\bin"
-        sdl_dll_path = os.path.join(sdl_dir, 'SDL3.dll')
+    @property
+    def ocl2dri_lib(self):
+        """The OCL2DRI native library, loaded on first use so scripts that
+        never call ocl.get_ocl2dra.* skip ctypes, SDL and the library probe."""
+        if self._ocl2dri_lib is None:
+            self._ocl2dri_lib = self.load_ocl2dri()
+        return self._ocl2dri_lib
 
-        if os.path.exists(sdl_dll_path):
-            os.environ['PATH'] = sdl_dir + os.pathsep + os.environ.get('PATH', '')
-            self.increment_saucerful("SDL3.dll path configured")
+    def probe_ocl2dri(self):
+        """The start-up checks that need no ctypes: locate the library for
+        this platform, put SDL3 on the DLL path on Windows, and read the file's
+        header to check it is a library this Python can load. Each passing
+        check counts towards the Saucerful rate; loading waits for first use."""
+        dll_base_path = os.path.join(os.path.dirname(os.path.abspath(__file__)), 'OCL2DRI')
+        if sys.platform == 'win32':
+            dll_path = os.path.join(dll_base_path, 'ocl2dri.dll')
+            build_hint = f"gcc -shared -o {dll_path} window.c -IC:/SDL3-3.2.4/x86_64-w64-mingw32/include -LC:/SDL3-3.2.4/x86_64-w64-mingw32/lib -lSDL3"
+            sdl_dir = r"C:\SDL3-3.2.4\x86_64-w64-mingw32\bin"
+            sdl_dll_path = os.path.join(sdl_dir, 'SDL3.dll')
+            if os.path.exists(sdl_dll_path):
+                os.environ['PATH'] = sdl_dir + os.pathsep + os.environ.get('PATH', '')
+                if hasattr(os, 'add_dll_directory'):
+                    os.add_dll_directory(sdl_dir)
+                self.increment_saucerful("SDL3.dll path configured")
+            else:
+                self.log_error(f"SDL3.dll not found at {sdl_dll_path}. Ensure it’s in PATH or beside ocl2dri.dll.", stack_info=False)
         else:
-            self.log_error(f"SDL3.dll not found at {sdl_dll_path}. Ensure it’s in PATH or beside ocl2dri.dll.", stack_info=False)
+            suffix = '.dylib' if sys.platform == 'darwin' else '.so'
+            dll_path = os.path.join(dll_base_path, 'libocl2dri' + suffix)
+            build_hint = f"gcc -shared -fPIC -o {dll_path} window.c $(pkg-config --cflags --libs sdl3)"
+
+        try:
+            with open(dll_path, 'rb') as f:
+                bits = self.library_bits(f)
+        except OSError:
+            return dll_path, build_hint  # reported with the build hint on first use
+        self.increment_saucerful("OCL2DRI DLL found")
+        if bits is not None:
+            self.increment_saucerful("OCL2DRI DLL format matches the platform")
+        if bits in (0, 64 if sys.maxsize > 2**32 else 32):
+            self.increment_saucerful("OCL2DRI DLL word size matches Python")
+        return dll_path, build_hint
+
+    @staticmethod
+    def library_bits(f):
+        """Word size of the library open in `f`, read from its header: 32 or
+        64, 0 for a macOS universal binary, or None if it is not a library this
+        platform loads."""
+        header = f.read(64)
+        if sys.platform == 'win32':
+            if len(header) < 64 or header[:2] != b'MZ':
+                return None
+            f.seek(int.from_bytes(header[60:64], 'little'))
+            pe = f.read(26)
+            if len(pe) < 26 or pe[:4] != b'PE\0\0':
+                return None
+            return {0x10b: 32, 0x20b: 64}.get(int.from_bytes(pe[24:26], 'little'))
+        if sys.platform == 'darwin':
+            if header[:4] == b'\xca\xfe\xba\xbe':
+                return 0
+            return {b'\xce\xfa\xed\xfe': 32, b'\xcf\xfa\xed\xfe': 64}.get(header[:4])
+        if len(header) < 5 or header[:4] != b'\x7fELF':
+            return None
+        return {1: 32, 2: 64}.get(header[4])
+
+    def load_ocl2dri(self):
+        import ctypes
 
+        dll_path, build_hint = self.ocl2dri_path, self.ocl2dri_build_hint
         if not os.path.exists(dll_path):
-            raise FileNotFoundError(f"DLL not found at {dll_path}. Build it with: gcc -shared -o {dll_path} window.c -IC:/SDL3-3.2.4/x86_64-w64-mingw32/include -LC:/SDL3-3.2.4/x86_64-w64-mingw32/lib -lSDL3")
-        else:
-            self.increment_saucerful("OCL2DRI DLL found")
+            raise FileNotFoundError(f"OCL2DRI library not found at {dll_path}. Build it with: {build_hint}")
 
         try:
-            self.ocl2dri_lib = ctypes.CDLL(dll_path)
-            self.increment_saucerful("OCL2DRI DLL loaded successfully")  # Check 2
+            lib = ctypes.CDLL(dll_path)
         except OSError as e:
-            raise RuntimeError(f"Failed to load DLL: {e}. Ensure it’s built correctly and dependencies (e.g., SDL3.dll) are available.")
-
-        if self.ocl2dri_lib:
-            expected_functions = [
-                ('ocl2dri_init', [ctypes.c_int, ctypes.c_int, ctypes.c_char_p], ctypes.c_void_p),
-                ('ocl2dri_set_background', [ctypes.c_void_p, ctypes.c_uint8, ctypes.c_uint8, ctypes.c_uint8], None),
-                ('ocl2dri_set_title', [ctypes.c_void_p, ctypes.c_char_p], None),
-                ('ocl2dri_set_size', [ctypes.c_void_p, ctypes.c_int, ctypes.c_int], None),
-                ('ocl2dri_set_position', [ctypes.c_void_p, ctypes.c_int, ctypes.c_int], None),
-                ('ocl2dri_set_fullscreen', [ctypes.c_void_p, ctypes.c_int], None),
-                ('ocl2dri_set_opacity', [ctypes.c_void_p, ctypes.c_float], None),
-                ('ocl2dri_set_border', [ctypes.c_void_p, ctypes.c_int], None),
-                ('ocl2dri_set_min_size', [ctypes.c_void_p, ctypes.c_int, ctypes.c_int], None),
-                ('ocl2dri_set_max_size', [ctypes.c_void_p, ctypes.c_int, ctypes.c_int], None),
-                ('ocl2dri_set_always_on_top', [ctypes.c_void_p, ctypes.c_int], None),
-                ('ocl2dri_set_resizable', [ctypes.c_void_p, ctypes.c_int], None),
-                ('ocl2dri_set_frame_rate', [ctypes.c_void_p, ctypes.c_int], None),
-                ('ocl2dri_update', [ctypes.c_void_p], None),
-                ('ocl2dri_is_running', [ctypes.c_void_p], ctypes.c_int),
-                ('ocl2dri_destroy', [ctypes.c_void_p], None),
-                ('ocl2dri_get_key_state', [ctypes.c_void_p, ctypes.c_char_p], ctypes.c_int),
-                ('ocl2dri_hide', [ctypes.c_void_p], None),
-                ('ocl2dri_show', [ctypes.c_void_p], None),
-                ('ocl2dri_set_icon', [ctypes.c_void_p, ctypes.c_char_p], None),
-                ('ocl2dri_get_mouse_position', [ctypes.c_void_p, ctypes.POINTER(ctypes.c_float), ctypes.POINTER(ctypes.c_float)], None),
-                ('ocl2dri_get_mouse_button_state', [ctypes.c_void_p, ctypes.c_int], ctypes.c_int),
-                ('ocl2dri_get_delta_time', [ctypes.c_void_p], ctypes.c_float),
-            ]
-
-            missing_functions = []
-            for func_name, argtypes, restype in expected_functions:
-                if hasattr(self.ocl2dri_lib, func_name):
-                    func = getattr(self.ocl2dri_lib, func_name)
-                    func.argtypes = argtypes
-                    if restype:
-                        func.restype = restype
-                else:
-                    missing_functions.append(func_name)
+            raise RuntimeError(f"Failed to load {dll_path}: {e}. Ensure it’s built correctly and dependencies (e.g., SDL3) are available.")
+
+        class FrameStats(ctypes.Structure):
+            # Mirrors OCL2DRI_FrameStats in window.c
+            _fields_ = [('frames', ctypes.c_int), ('missed', ctypes.c_int)] + [
+                (name, ctypes.c_float) for name in (
+                    'min_ms', 'avg_ms', 'p50_ms', 'p95_ms', 'p99_ms', 'max_ms',
+                    'script_ms', 'submit_ms', 'present_ms', 'sleep_ms')]
+        self.frame_stats_type = FrameStats
+
+        class DrawStats(ctypes.Structure):
+            # Mirrors OCL2DRI_DrawStats in window.c
+            _fields_ = [(name, ctypes.c_int) for name in ('commands', 'culled', 'draw_calls', 'state_changes')]
+        self.draw_stats_type = DrawStats
 
-            if missing_functions:
-                self.log_error(f"Missing functions in ocl2dri.dll: {', '.join(missing_functions)}. Rebuild with the latest window.c.", stack_info=False)
+        expected_functions = [
+            ('ocl2dri_init', [ctypes.c_int, ctypes.c_int, ctypes.c_char_p], ctypes.c_void_p),
+            ('ocl2dri_set_background', [ctypes.c_void_p, ctypes.c_uint8, ctypes.c_uint8, ctypes.c_uint8], None),
+            ('ocl2dri_set_title', [ctypes.c_void_p, ctypes.c_char_p], None),
+            ('ocl2dri_set_size', [ctypes.c_void_p, ctypes.c_int, ctypes.c_int], None),
+            ('ocl2dri_set_position', [ctypes.c_void_p, ctypes.c_int, ctypes.c_int], None),
+            ('ocl2dri_set_fullscreen', [ctypes.c_void_p, ctypes.c_int], None),
+            ('ocl2dri_set_opacity', [ctypes.c_void_p, ctypes.c_float], None),
+            ('ocl2dri_set_border', [ctypes.c_void_p, ctypes.c_int], None),
+            ('ocl2dri_set_min_size', [ctypes.c_void_p, ctypes.c_int, ctypes.c_int], None),
+            ('ocl2dri_set_max_size', [ctypes.c_void_p, ctypes.c_int, ctypes.c_int], None),
+            ('ocl2dri_set_always_on_top', [ctypes.c_void_p, ctypes.c_int], None),
+            ('ocl2dri_set_resizable', [ctypes.c_void_p, ctypes.c_int], None),
+            ('ocl2dri_set_frame_rate', [ctypes.c_void_p, ctypes.c_int], None),
+            ('ocl2dri_update', [ctypes.c_void_p], None),
+            ('ocl2dri_is_running', [ctypes.c_void_p], ctypes.c_int),
+            ('ocl2dri_destroy', [ctypes.c_void_p], None),
+            ('ocl2dri_get_key_state', [ctypes.c_void_p, ctypes.c_char_p], ctypes.c_int),
+            ('ocl2dri_hide', [ctypes.c_void_p], None),
+            ('ocl2dri_show', [ctypes.c_void_p], None),
+            ('ocl2dri_set_icon', [ctypes.c_void_p, ctypes.c_char_p], None),
+            ('ocl2dri_get_mouse_position', [ctypes.c_void_p, ctypes.POINTER(ctypes.c_float), ctypes.POINTER(ctypes.c_float)], None),
+            ('ocl2dri_get_mouse_button_state', [ctypes.c_void_p, ctypes.c_int], ctypes.c_int),
+            ('ocl2dri_get_delta_time', [ctypes.c_void_p], ctypes.c_float),
+            ('ocl2dri_set_pipelined', [ctypes.c_void_p, ctypes.c_bool, ctypes.c_int], ctypes.c_bool),
+            ('ocl2dri_set_draw_color', [ctypes.c_void_p, ctypes.c_uint8, ctypes.c_uint8, ctypes.c_uint8, ctypes.c_uint8], None),
+            ('ocl2dri_fill_rect', [ctypes.c_void_p, ctypes.c_float, ctypes.c_float, ctypes.c_float, ctypes.c_float], None),
+            ('ocl2dri_draw_rect', [ctypes.c_void_p, ctypes.c_float, ctypes.c_float, ctypes.c_float, ctypes.c_float], None),
+            ('ocl2dri_draw_line', [ctypes.c_void_p, ctypes.c_float, ctypes.c_float, ctypes.c_float, ctypes.c_float], None),
+            ('ocl2dri_fill_rects', [ctypes.c_void_p, ctypes.POINTER(ctypes.c_float), ctypes.c_int], None),
+            ('ocl2dri_get_frame_stats', [ctypes.c_void_p, ctypes.POINTER(FrameStats)], ctypes.c_bool),
+            ('ocl2dri_export_frame_stats', [ctypes.c_void_p, ctypes.c_char_p], ctypes.c_bool),
+            ('ocl2dri_set_stats_overlay', [ctypes.c_void_p, ctypes.c_bool], None),
+            ('ocl2dri_tilemap_create', [ctypes.c_void_p, ctypes.c_int, ctypes.c_int, ctypes.c_float, ctypes.c_float], ctypes.c_void_p),
+            ('ocl2dri_tilemap_set_color', [ctypes.c_void_p, ctypes.c_int, ctypes.c_uint8, ctypes.c_uint8, ctypes.c_uint8, ctypes.c_uint8], None),
+            ('ocl2dri_tilemap_set_tile', [ctypes.c_void_p, ctypes.c_int, ctypes.c_int, ctypes.c_int], None),
+            ('ocl2dri_tilemap_get_tile', [ctypes.c_void_p, ctypes.c_int, ctypes.c_int], ctypes.c_int),
+            ('ocl2dri_tilemap_set_tiles', [ctypes.c_void_p, ctypes.c_int, ctypes.c_int, ctypes.c_int, ctypes.c_int, ctypes.POINTER(ctypes.c_int)], None),
+            ('ocl2dri_tilemap_fill', [ctypes.c_void_p, ctypes.c_int, ctypes.c_int, ctypes.c_int, ctypes.c_int, ctypes.c_int], None),
+            ('ocl2dri_tilemap_draw', [ctypes.c_void_p, ctypes.c_void_p, ctypes.c_float, ctypes.c_float], None),
+            ('ocl2dri_tilemap_destroy', [ctypes.c_void_p], None),
+            ('ocl2dri_load_font', [ctypes.c_void_p, ctypes.c_char_p, ctypes.c_float], ctypes.c_int),
+            ('ocl2dri_draw_text', [ctypes.c_void_p, ctypes.c_int, ctypes.c_float, ctypes.c_float, ctypes.c_char_p], None),
+            ('ocl2dri_emitter_create', [ctypes.c_void_p, ctypes.c_int], ctypes.c_void_p),
+            ('ocl2dri_emitter_set_position', [ctypes.c_void_p, ctypes.c_float, ctypes.c_float], None),
+            ('ocl2dri_emitter_set_rate', [ctypes.c_void_p, ctypes.c_float], None),
+            ('ocl2dri_emitter_set_velocity', [ctypes.c_void_p, ctypes.c_float, ctypes.c_float, ctypes.c_float, ctypes.c_float], None),
+            ('ocl2dri_emitter_set_life', [ctypes.c_void_p, ctypes.c_float, ctypes.c_float], None),
+            ('ocl2dri_emitter_set_gravity', [ctypes.c_void_p, ctypes.c_float, ctypes.c_float], None),
+            ('ocl2dri_emitter_set_size', [ctypes.c_void_p, ctypes.c_float], None),
+            ('ocl2dri_emitter_set_colors', [ctypes.c_void_p] + [ctypes.c_uint8] * 8, None),
+            ('ocl2dri_emitter_burst', [ctypes.c_void_p, ctypes.c_int], None),
+            ('ocl2dri_emitter_count', [ctypes.c_void_p], ctypes.c_int),
+            ('ocl2dri_emitter_destroy', [ctypes.c_void_p], None),
+            ('ocl2dri_spatial_create', [ctypes.c_float], ctypes.c_void_p),
+            ('ocl2dri_spatial_update', [ctypes.c_void_p, ctypes.POINTER(ctypes.c_float), ctypes.c_int], ctypes.c_bool),
+            ('ocl2dri_spatial_query_pairs', [ctypes.c_void_p, ctypes.POINTER(ctypes.c_int), ctypes.c_int], ctypes.c_int),
+            ('ocl2dri_spatial_query_rect', [ctypes.c_void_p, ctypes.c_float, ctypes.c_float, ctypes.c_float, ctypes.c_float, ctypes.POINTER(ctypes.c_int), ctypes.c_int], ctypes.c_int),
+            ('ocl2dri_spatial_query_point', [ctypes.c_void_p, ctypes.c_float, ctypes.c_float, ctypes.POINTER(ctypes.c_int), ctypes.c_int], ctypes.c_int),
+            ('ocl2dri_spatial_destroy', [ctypes.c_void_p], None),
+            ('ocl2dri_load_texture_async', [ctypes.c_void_p, ctypes.c_char_p], ctypes.c_int),
+            ('ocl2dri_texture_status', [ctypes.c_void_p, ctypes.c_int], ctypes.c_int),
+            ('ocl2dri_texture_progress', [ctypes.c_void_p], ctypes.c_float),
+            ('ocl2dri_set_upload_budget', [ctypes.c_void_p, ctypes.c_float], None),
+            ('ocl2dri_draw_texture', [ctypes.c_void_p, ctypes.c_int, ctypes.c_float, ctypes.c_float, ctypes.c_float, ctypes.c_float], None),
+            ('ocl2dri_layer_create', [ctypes.c_void_p, ctypes.c_char_p, ctypes.c_int], ctypes.c_int),
+            ('ocl2dri_layer_begin', [ctypes.c_void_p, ctypes.c_int], None),
+            ('ocl2dri_layer_end', [ctypes.c_void_p], None),
+            ('ocl2dri_layer_set_visible', [ctypes.c_void_p, ctypes.c_int, ctypes.c_bool], None),
+            ('ocl2dri_layer_redraws', [ctypes.c_void_p, ctypes.c_int], ctypes.c_int),
+            ('ocl2dri_set_depth', [ctypes.c_void_p, ctypes.c_int], None),
+            ('ocl2dri_set_state_sorting', [ctypes.c_void_p, ctypes.c_bool], None),
+            ('ocl2dri_set_camera', [ctypes.c_void_p, ctypes.c_float, ctypes.c_float, ctypes.c_float], None),
+            ('ocl2dri_get_draw_stats', [ctypes.c_void_p, ctypes.POINTER(DrawStats)], ctypes.c_bool),
+        ]
+
+        missing_functions = []
+        for func_name, argtypes, restype in expected_functions:
+            if hasattr(lib, func_name):
+                func = getattr(lib, func_name)
+                func.argtypes = argtypes
+                if restype:
+                    func.restype = restype
             else:
-                self.increment_saucerful("All OCL2DRI functions verified")  # Check 3
+                missing_functions.append(func_name)
+
+        if missing_functions:
+            self.log_error(f"Missing functions in {os.path.basename(dll_path)}: {', '.join(missing_functions)}. Rebuild with the latest window.c.", stack_info=False)
+        return lib
     
+    def native_id_array(self, query, args, width=1):
+        """Runs an OCL2DRI query that fills an int buffer and returns its total
+        count, retrying once with an exact-size buffer if the first was too small."""
+        import ctypes
+        capacity = 256
+        while True:
+            result = OclArray(capacity * width, 'int')
+            buffer = (ctypes.c_int * len(result)).from_buffer(result.data)
+            total = query(*args, buffer, capacity)
+            del buffer
+            if total <= capacity:
+                del result.data[total * width:]
+                return result
+            capacity = total
+
     def increment_saucerful(self, reason):
         """Increase Saucerful rate by 1 with no upper limit."""
         self.saucerful_rate += 1
@@ -94,12 +661,13 @@ class Interpreter:
     
     def log_error(self, message, stack_info=False):
         """Log an error without modifying rate."""
+        self.flush_output()
         if not self.error_logged:
             error_details = {
                 'message': message,
                 'timestamp': time.time(),
                 'stack': traceback.format_exc() if stack_info else None,
-                'line': self.current_line if hasattr(self, 'current_line') else None
+                'line': self.current_line
             }
             self.last_error = error_details
             print(f"Error: {message}")
@@ -115,529 +683,1348 @@ class Interpreter:
         self.debug_mode = mode
         return self.debug_mode
 
-    def interpret(self, ast, in_function=False):
+    def interpret(self, ast):
+        """Run a program: a statement list, or a parser's statement stream,
+        which is then executed as it is parsed. Runtime errors surface here
+        once, as a RuntimeError naming the line of the innermost statement
+        that failed; syntax errors from a stream pass through unchanged."""
         self.error_logged = False
         try:
-            last_result = None
-            for statement in ast:
-                if isinstance(statement, tuple) and len(statement) > 2 and isinstance(statement[2], int):
-                    self.current_line = statement[2]
-                result = self.execute(statement)
-                if result in ['break', 'continue']:
-                    return result
-                last_result = result
-            return last_result if in_function else None
-        except ReturnException as e:
-            if in_function:
-                raise e
-            else:
-                return e.value
+            completion = self.execute_block(map(self.specialize_top_level, ast))
+        except SyntaxError:
+            raise
         except Exception as e:
-            self.log_error(f"Interpretation error: {str(e)}", stack_info=self.debug_mode)
-            return None
+            statement = getattr(e, 'ocl_statement', None)
+            location = f" at line {statement.line}, column {statement.column}" if statement is not None else ""
+            raise RuntimeError(f"{type(e).__name__}{location}: {e}") from e
         finally:
-            if hasattr(self, 'current_line'):
-                del self.current_line
+            self.scheduler.shutdown()
+            self.flush_output()
+            if self.debug_mode and self.scheduler.spawned:
+                print(self.scheduler.summary())
+        return self.return_value if completion is RETURN else None
 
-    def execute(self, statement):
-        if not statement:
+    def specialize_top_level(self, statement):
+        self.specializer.statement(statement, self.global_types)
+        return statement
+
+    def enable_hot_reload(self, path):
+        """Watch `path` while the script runs. Each ocl.get_ocl2dra.update call
+        checks it, so a reload always lands between two frames."""
+        self.hot_reload_path = path
+        self.hot_reload_stamp = self.source_stamp(path)
+
+    def source_stamp(self, path):
+        try:
+            stat = os.stat(path)
+        except OSError:
             return None
+        # Size as well as mtime: a half-written file can share the final mtime
+        return (stat.st_mtime_ns, stat.st_size)
+
+    def poll_hot_reload(self):
+        stamp = self.source_stamp(self.hot_reload_path)
+        if stamp is not None and stamp != self.hot_reload_stamp:
+            self.hot_reload_stamp = stamp
+            self.reload_source(self.hot_reload_path)
+
+    def reload_source(self, path):
+        """Re-parse `path` and swap in its functions and classes. Variables,
+        objects and the OCL2DRI context stay as they are, and other top-level
+        statements are not run again. Existing objects move to the new class
+        layout with their field values. A script function `on_reload()` runs
+        afterwards at top level, so it can re-initialize what it chooses.
+        Code already executing (the running loop body, functions on the call
+        stack) finishes with the old definitions. On a syntax error nothing
+        is swapped."""
+        from lexer import Lexer
+        from parser import Parser
+        started = time.perf_counter()
+        errors = []
+        parser = Parser(Lexer())
+        parser.on_error = errors.append
         try:
-            stmt_type = statement[0] if isinstance(statement, (tuple, list)) else None
-            if not stmt_type:
-                return None
+            with open(path, "r", encoding="utf-8-sig", errors="replace") as f:
+                statements = parser.parse(f.read())
+        except (OSError, SyntaxError) as e:
+            errors.append(e)
+        if errors:
+            print(f"[hot reload] {os.path.basename(path)} not reloaded: {errors[0]}")
+            return False
 
-            if stmt_type == 'declare':
-                _, _, var_name, type_annot, expr = statement
-                value = self.evaluate(expr)
-                if type_annot and type_annot in self.type_map:
-                    expected_type = self.type_map[type_annot]
-                    if value is not None and not isinstance(value, expected_type):
-                        raise TypeError(f"Variable '{var_name}' annotated as {type_annot}, got {type(value).__name__}")
-                self.variables[var_name] = value
-
-            elif stmt_type == 'assign':
-                _, left, expr = statement
-                value = self.evaluate(expr)
-                if left[0] != 'identifier':
-                    raise ValueError("Assignment target must be an identifier")
-                name = left[1]
-                if '.' in name:
-                    parts = name.split('.')
-                    obj_name = parts[0]
-                    attr_path = parts[1:]
-                    obj = self.variables.get(obj_name)
-                    if obj is None or not isinstance(obj, dict):
-                        raise ValueError(f"Cannot assign to attribute on non-object '{obj_name}'")
-                    current = obj
-                    for part in attr_path[:-1]:
-                        current = current.setdefault(part, {})
-                    current[attr_path[-1]] = value
-                else:
-                    self.variables[name] = value
-
-            elif stmt_type == 'aug_assign':
-                _, left, op, expr = statement
-                expr_val = self.evaluate(expr)
-                if left[0] != 'identifier':
-                    raise ValueError("Augmented assignment target must be an identifier")
-                name = left[1]
-                if '.' in name:
-                    parts = name.split('.')
-                    obj_name = parts[0]
-                    attr_path = parts[1:]
-                    obj = self.variables.get(obj_name)
-                    if obj is None or not isinstance(obj, dict):
-                        raise ValueError(f"Cannot assign to attribute on non-object '{obj_name}'")
-                    current = obj
-                    for part in attr_path[:-1]:
-                        current = current.get(part, {})
-                    current_val = current.get(attr_path[-1], 0)
-                    current[attr_path[-1]] = self.apply_op(current_val, op, expr_val)
-                else:
-                    if name not in self.variables:
-                        raise ValueError(f"Variable '{name}' not defined for augmented assignment")
-                    current_val = self.variables[name]
-                    self.variables[name] = self.apply_op(current_val, op, expr_val)
-
-            elif stmt_type == 'print':
-                _, expr = statement
-                value = self.evaluate(expr)
-                sys.stdout.write(str(value) if value is not None else "null")
-                sys.stdout.write("\n")
-                sys.stdout.flush()
-
-            elif stmt_type == 'if':
-                _, condition, body, elif_blocks, else_block = statement
-                condition_val = self.evaluate(condition)
-                if not isinstance(condition_val, bool):
-                    raise TypeError("If condition must evaluate to a boolean")
-                if condition_val:
-                    return self.interpret(body)
-                for elif_cond, elif_body in elif_blocks:
-                    elif_cond_val = self.evaluate(elif_cond)
-                    if not isinstance(elif_cond_val, bool):
-                        raise TypeError("Elif condition must evaluate to a boolean")
-                    if elif_cond_val:
-                        return self.interpret(elif_body)
-                if else_block:
-                    return self.interpret(else_block)
-
-            elif stmt_type == 'while':
-                _, condition, body = statement
-                while True:
-                    condition_val = self.evaluate(condition)
-                    if not isinstance(condition_val, bool):
-                        raise TypeError("While condition must evaluate to a boolean")
-                    if not condition_val:
-                        break
-                    result = self.interpret(body)
-                    if result == 'break':
-                        break
-                    elif result == 'continue':
-                        continue
-
-            elif stmt_type == 'define':
-                _, func_name, params, body = statement
-                self.functions[func_name] = (params, body)
-
-            elif stmt_type == 'class':
-                _, class_name, methods = statement
-                self.classes[class_name] = {method[1]: (method[2], method[3]) for method in methods}
-
-            elif stmt_type == 'return':
-                _, expr = statement
-                value = self.evaluate(expr) if expr else None
-                raise ReturnException(value)
-
-            elif stmt_type == 'break':
-                return 'break'
-
-            elif stmt_type == 'continue':
-                return 'continue'
-
-            elif stmt_type == 'call':
-                return self.evaluate(statement)
+        functions = {stmt.name: (stmt.params, stmt.body) for stmt in statements if stmt.kind == DEFINE}
+        classes = {stmt.name: self.compile_class(stmt.name, stmt.methods) for stmt in statements if stmt.kind == CLASS}
+        for name, (params, body) in functions.items():
+            self.define_function(name, params, body)
+        replaced = any(name in self.classes for name in classes)
+        self.classes.update(classes)
+        migrated = self.migrate_objects(classes) if replaced else 0
+        swap_ms = (time.perf_counter() - started) * 1000
 
+        hook = functions.get('on_reload')
+        if hook is not None:
+            params, body = hook
+            if params:
+                print("[hot reload] on_reload() must take no arguments; skipped")
             else:
-                raise ValueError(f"Unknown statement type: {stmt_type}")
+                old_vars = self.variables
+                self.variables = self.global_variables
+                # Top-level code already running was specialized for these types
+                typed = {name: self.global_variables[name] for name in self.global_types if name in self.global_variables}
+                try:
+                    self.execute_block(body)
+                except Exception as e:
+                    print(f"[hot reload] on_reload() failed: {type(e).__name__}: {e}")
+                finally:
+                    self.variables = old_vars
+                for name, value in typed.items():
+                    annot = self.global_types[name][0]
+                    current = self.global_variables.get(name)
+                    if current is not None and not isinstance(current, SCALAR_TYPES[annot]):
+                        print(f"[hot reload] on_reload() set '{name}' (annotated {annot}) to {type(current).__name__}; restored")
+                        self.global_variables[name] = value
+        total_ms = (time.perf_counter() - started) * 1000
+        print(f"[hot reload] {os.path.basename(path)}: {len(functions)} functions, {len(classes)} classes, "
+              f"{migrated} objects migrated in {swap_ms:.2f} ms ({total_ms:.2f} ms with on_reload)")
+        return True
 
-        except ReturnException:
-            raise
+    def migrate_objects(self, classes):
+        """Move every reachable instance of a reloaded class onto the new
+        shape, keeping its field values. Shape identity changes, so every
+        inline cache on the old methods misses and rebinds."""
+        new_shapes = {}  # old shape -> new shape
+        seen = set()
+        migrated = 0
+        pending = list(self.global_variables.values())
+        if self.variables is not self.global_variables:
+            pending.extend(self.variables.values())
+        for _, _, task in self.scheduler.frame_waits + self.scheduler.time_waits:
+            if task.state is not None:
+                pending.extend(task.state[0].values())
+        while pending:
+            value = pending.pop()
+            if id(value) in seen:
+                continue
+            if isinstance(value, OclObject):
+                seen.add(id(value))
+                shape = value.shape
+                root = classes.get(shape.name)
+                if root is not None:
+                    new_shape = new_shapes.get(shape)
+                    if new_shape is None:
+                        new_shape = root
+                        for field in shape.fields:
+                            if field not in new_shape.fields:
+                                new_shape = new_shape.with_field(field)
+                        new_shapes[shape] = new_shape
+                    slots = [_UNSET] * len(new_shape.fields)
+                    for field, index in shape.fields.items():
+                        slots[new_shape.fields[field]] = value.slots[index]
+                    value.shape = new_shape
+                    value.slots = slots
+                    migrated += 1
+                pending.extend(value.slots)
+            elif isinstance(value, dict):
+                seen.add(id(value))
+                pending.extend(value.values())
+            elif isinstance(value, (list, tuple)):
+                seen.add(id(value))
+                pending.extend(value)
+        return migrated
+
+    def build_dispatch_tables(self):
+        """Handlers indexed by node kind, so execute/evaluate are one list
+        lookup instead of a chain of string comparisons."""
+        statements = [self.exec_unknown] * KIND_COUNT
+        statements[DECLARE] = self.exec_declare
+        statements[ASSIGN] = self.exec_assign
+        statements[AUG_ASSIGN] = self.exec_aug_assign
+        statements[PRINT] = self.exec_print
+        statements[IF] = self.exec_if
+        statements[WHILE] = self.exec_while
+        statements[FOR_RANGE] = self.exec_for_range
+        statements[FOR_EACH] = self.exec_for_each
+        statements[DEFINE] = self.exec_define
+        statements[CLASS] = self.exec_class
+        statements[RETURN_KIND] = self.exec_return
+        statements[BREAK_KIND] = self.exec_break
+        statements[CONTINUE_KIND] = self.exec_continue
+        statements[CALL] = self.exec_call
+        statements[CALL_METHOD] = self.exec_call
+        statements[SPAWN] = self.exec_call
+        statements[YIELD] = self.exec_yield
+
+        expressions = [self.eval_unknown] * KIND_COUNT
+        expressions[LITERAL] = self.eval_literal
+        expressions[IDENTIFIER] = self.eval_identifier
+        expressions[BINARY] = self.eval_binary
+        expressions[INDEX] = self.eval_index
+        expressions[ATTRIBUTE] = self.eval_attribute
+        expressions[CALL_METHOD] = self.eval_call_method
+        expressions[CALL] = self.eval_call
+        expressions[SPAWN] = self.eval_spawn
+
+        self.statement_handlers = statements
+        self.expression_handlers = expressions
+
+    def execute_block(self, statements):
+        """Execute statements in order. Returns None, or the BREAK, CONTINUE or
+        RETURN completion that cut the block short."""
+        handlers = self.statement_handlers
+        if self.scheduler.aborting:
+            self.scheduler.check_abort()
+        try:
+            for statement in statements:
+                self.current_line = statement.line
+                completion = handlers[statement.kind](statement)
+                if completion is not None:
+                    return completion
         except Exception as e:
-            self.log_error(f"Error executing statement {str(statement)[:50]}...: {str(e)}")
-            if self.debug_mode:
-                print(traceback.format_exc())
-            return None  # Continue despite error
+            if not hasattr(e, 'ocl_statement'):
+                e.ocl_statement = statement
+            raise
+        return None
+
+    def execute(self, statement):
+        return self.statement_handlers[statement.kind](statement)
 
     def evaluate(self, expr):
-        try:
-            if expr is None:
-                return None
-            if not isinstance(expr, (tuple, list)):
-                return expr
-
-            expr_type = expr[0]
-            if expr_type == 'literal':
-                if isinstance(expr[1], str):
-                    return self.interpolate_string(expr[1])
-                return expr[1]
-
-            elif expr_type == 'identifier':
-                name = expr[1]
-                if '.' in name:
-                    return self.resolve(name)
-                if name not in self.variables:
-                    raise NameError(f"Variable '{name}' is not defined")
-                return self.variables[name]
-
-            elif expr_type == 'binary':
-                _, op, left, right = expr
-                left_val = self.evaluate(left)
-                right_val = self.evaluate(right)
-                return self.apply_op(left_val, op, right_val)
-
-            elif expr_type == 'index':
-                _, base_expr, index_expr = expr
-                base = self.evaluate(base_expr)
-                index = self.evaluate(index_expr)
-                if not isinstance(base, tuple):
-                    raise ValueError(f"Cannot index non-tuple value: {base}")
-                if not isinstance(index, int):
-                    raise ValueError(f"Index must be an integer, got: {index}")
-                if 0 <= index < len(base):
-                    return base[index]
-                raise ValueError(f"Index {index} out of range for tuple of length {len(base)}")
-
-            elif expr_type == 'call_method':
-                _, object_expr, method_name, args = expr
-                obj = self.evaluate(object_expr)
-                if not (isinstance(obj, dict) and '__class__' in obj):
-                    raise ValueError("Attempt to call method on non-object")
-                class_name = obj['__class__']
-                if class_name not in self.classes or method_name not in self.classes[class_name]:
-                    raise ValueError(f"Method '{method_name}' not found in class '{class_name}'")
-                params, body = self.classes[class_name][method_name]
-                evaluated_args = [self.evaluate(arg) for arg in args]
-                if params and params[0][0] == 'self':
-                    expected_args = len(params) - 1
-                else:
-                    expected_args = len(params)
-                if expected_args != len(evaluated_args):
-                    raise ValueError(f"Method '{method_name}' expects {expected_args} arguments, got {len(evaluated_args)}")
-                local_vars = {'self': obj} if params and params[0][0] == 'self' else {}
-                param_start = 1 if params and params[0][0] == 'self' else 0
-                for (param, _), arg in zip(params[param_start:], evaluated_args):
-                    local_vars[param] = arg
-                old_vars = self.variables.copy()
-                self.variables = {**self.variables, **local_vars}
+        if expr is None:
+            return None
+        return self.expression_handlers[expr.kind](expr)
+
+    def exec_unknown(self, statement):
+        raise ValueError(f"Unknown statement type: {type(statement).__name__}")
+
+    def exec_declare(self, statement):
+        value = self.evaluate(statement.value)
+        type_annot = statement.type_annot
+        if type_annot and not statement.proven and type_annot in self.type_map:
+            expected_type = self.type_map[type_annot]
+            if value is not None and not isinstance(value, expected_type):
+                raise TypeError(f"Variable '{statement.name}' annotated as {type_annot}, got {type(value).__name__}")
+        self.variables[statement.name] = value
+
+    def exec_assign(self, statement):
+        value = self.evaluate(statement.value)
+        left = statement.target
+        if left.kind == INDEX:
+            self.assign_index(left, value)
+            return None
+        if left.kind == ATTRIBUTE:
+            self.assign_attribute(left, value)
+            return None
+        if left.kind != IDENTIFIER:
+            raise ValueError("Assignment target must be an identifier")
+        name = left.name
+        check = statement.check
+        if check is not None and value is not None and not isinstance(value, check):
+            raise TypeError(f"Variable '{name}' annotated as {self.annotation_name(check)}, got {type(value).__name__}")
+        if '.' in name:
+            parts = name.split('.')
+            obj_name = parts[0]
+            attr_path = parts[1:]
+            obj = self.variables.get(obj_name)
+            if obj is None or not isinstance(obj, dict):
+                raise ValueError(f"Cannot assign to attribute on non-object '{obj_name}'")
+            current = obj
+            for part in attr_path[:-1]:
+                current = current.setdefault(part, {})
+            current[attr_path[-1]] = value
+        else:
+            self.variables[name] = value
+
+    def exec_aug_assign(self, statement):
+        left = statement.target
+        op = statement.op
+        expr_val = self.evaluate(statement.value)
+        if left.kind == INDEX:
+            self.assign_index(left, self.apply_op(self.evaluate(left), op, expr_val))
+            return None
+        if left.kind == ATTRIBUTE:
+            owner = self.attribute_owner(left.base)
+            current_val = owner.get_field(left.attr) if isinstance(owner, OclObject) else owner.get(left.attr, _UNSET)
+            if current_val is _UNSET:
+                current_val = 0
+            self.assign_attribute(left, self.apply_op(current_val, op, expr_val))
+            return None
+        if left.kind != IDENTIFIER:
+            raise ValueError("Augmented assignment target must be an identifier")
+        name = left.name
+        if '.' in name:
+            parts = name.split('.')
+            obj_name = parts[0]
+            attr_path = parts[1:]
+            obj = self.variables.get(obj_name)
+            if obj is None or not isinstance(obj, dict):
+                raise ValueError(f"Cannot assign to attribute on non-object '{obj_name}'")
+            current = obj
+            for part in attr_path[:-1]:
+                current = current.get(part, {})
+            current_val = current.get(attr_path[-1], 0)
+            current[attr_path[-1]] = self.apply_op(current_val, op, expr_val)
+        else:
+            if name not in self.variables:
+                raise ValueError(f"Variable '{name}' not defined for augmented assignment")
+            current_val = self.variables[name]
+            fn = statement.fn
+            if fn is not None:
                 try:
-                    result = self.interpret(body, in_function=True)
-                    self.variables = old_vars
-                    return result if result is not None else None
-                except ReturnException as e:
-                    self.variables = old_vars
-                    return e.value
-
-            elif expr_type == 'call':
-                _, func_name, args = expr
-                evaluated_args = [self.evaluate(arg) for arg in args]
-                if '.' in func_name:
-                    obj_name, method_name = func_name.rsplit('.', 1)
-                    obj = self.variables.get(obj_name)
-                    if obj and isinstance(obj, dict) and '__class__' in obj:
-                        return self.evaluate(('call_method', ('identifier', obj_name), method_name, args))
-                if func_name == 'ocl.classes':
-                    if len(args) != 1 or not isinstance(evaluated_args[0], str):
-                        raise ValueError("ocl.classes expects one string argument")
-                    class_name = evaluated_args[0]
-                    if class_name not in self.classes:
-                        raise ValueError(f"Class '{class_name}' not defined")
-                    return {'__class__': class_name}
-                elif func_name == 'ocl.get_input':
-                    if len(args) != 1 or not isinstance(evaluated_args[0], str):
-                        raise ValueError("ocl.get_input expects one string argument")
-                    sys.stdout.write(evaluated_args[0])
-                    sys.stdout.flush()
-                    try:
-                        user_input = input()
-                    except KeyboardInterrupt:
-                        raise KeyboardInterrupt("Input interrupted by user")
-                    sys.stdout.write("\n")
-                    sys.stdout.flush()
-                    return user_input
-                elif func_name == 'ocl.get_set_input':
-                    if len(args) != 1 or not isinstance(evaluated_args[0], str):
-                        raise ValueError("ocl.get_set_input expects one string argument")
-                    sys.stdout.write(evaluated_args[0])
-                    sys.stdout.flush()
-                    try:
-                        user_input = input()
-                    except KeyboardInterrupt:
-                        raise KeyboardInterrupt("Input interrupted by user")
-                    sys.stdout.write("\n")
-                    sys.stdout.flush()
-                    self.variables['input_value'] = user_input
-                    return None
-                elif func_name == 'ocl.get_ocl2dra.init':
-                    if not self.ocl2dri_lib:
-                        raise ValueError("OCL2DRI library not loaded")
-                    if len(args) != 3 or not all(isinstance(arg, (int, str)) for arg in evaluated_args[:2] + evaluated_args[2:]):
-                        raise ValueError("ocl.get_ocl2dra.init expects (width: int, height: int, title: string)")
-                    width, height, title = evaluated_args
-                    ctx_ptr = self.ocl2dri_lib.ocl2dri_init(width, height, title.encode('utf-8'))
-                    if not ctx_ptr:
-                        self.log_error("Failed to initialize OCL2DRI context")
-                        return None
-                    self.ocl2dri_lib.ocl2dri_update(ctx_ptr)
-                    return ctx_ptr
-                elif func_name == 'ocl.get_ocl2dra.set_background':
-                    if not self.ocl2dri_lib:
-                        raise ValueError("OCL2DRI library not loaded")
-                    if len(args) != 4 or not all(isinstance(arg, (int, float)) for arg in evaluated_args[1:]):
-                        raise ValueError("ocl.get_ocl2dra.set_background expects (context: pointer, r: int/float, g: int/float, b: int/float)")
-                    ctx, r, g, b = evaluated_args
-                    self.ocl2dri_lib.ocl2dri_set_background(ctx, int(r), int(g), int(b))
-                    return None
-                elif func_name == 'ocl.get_ocl2dra.set_title':
-                    if not self.ocl2dri_lib:
-                        raise ValueError("OCL2DRI library not loaded")
-                    if len(args) != 2 or not isinstance(evaluated_args[1], str):
-                        raise ValueError("ocl.get_ocl2dra.set_title expects (context: pointer, title: string)")
-                    ctx, title = evaluated_args
-                    self.ocl2dri_lib.ocl2dri_set_title(ctx, title.encode('utf-8'))
-                    return None
-                elif func_name == 'ocl.get_ocl2dra.set_size':
-                    if not self.ocl2dri_lib:
-                        raise ValueError("OCL2DRI library not loaded")
-                    if len(args) != 3 or not all(isinstance(arg, (int, float)) for arg in evaluated_args[1:]):
-                        raise ValueError("ocl.get_ocl2dra.set_size expects (context: pointer, width: int/float, height: int/float)")
-                    ctx, width, height = evaluated_args
-                    self.ocl2dri_lib.ocl2dri_set_size(ctx, int(width), int(height))
-                    return None
-                elif func_name == 'ocl.get_ocl2dra.set_position':
-                    if not self.ocl2dri_lib:
-                        raise ValueError("OCL2DRI library not loaded")
-                    if len(args) != 3 or not all(isinstance(arg, (int, float)) for arg in evaluated_args[1:]):
-                        raise ValueError("ocl.get_ocl2dra.set_position expects (context: pointer, x: int/float, y: int/float)")
-                    ctx, x, y = evaluated_args
-                    self.ocl2dri_lib.ocl2dri_set_position(ctx, int(x), int(y))
-                    return None
-                elif func_name == 'ocl.get_ocl2dra.set_fullscreen':
-                    if not self.ocl2dri_lib:
-                        raise ValueError("OCL2DRI library not loaded")
-                    if len(args) != 2 or not isinstance(evaluated_args[1], (int, bool)):
-                        raise ValueError("ocl.get_ocl2dra.set_fullscreen expects (context: pointer, fullscreen: bool/int)")
-                    ctx, fullscreen = evaluated_args
-                    self.ocl2dri_lib.ocl2dri_set_fullscreen(ctx, 1 if fullscreen else 0)
-                    return None
-                elif func_name == 'ocl.get_ocl2dra.set_opacity':
-                    if not self.ocl2dri_lib:
-                        raise ValueError("OCL2DRI library not loaded")
-                    if len(args) != 2 or not isinstance(evaluated_args[1], (int, float)):
-                        raise ValueError("ocl.get_ocl2dra.set_opacity expects (context: pointer, opacity: float 0.0-1.0)")
-                    ctx, opacity = evaluated_args
-                    self.ocl2dri_lib.ocl2dri_set_opacity(ctx, float(opacity))
-                    return None
-                elif func_name == 'ocl.get_ocl2dra.set_border':
-                    if not self.ocl2dri_lib:
-                        raise ValueError("OCL2DRI library not loaded")
-                    if len(args) != 2 or not isinstance(evaluated_args[1], (int, bool)):
-                        raise ValueError("ocl.get_ocl2dra.set_border expects (context: pointer, bordered: bool/int)")
-                    ctx, bordered = evaluated_args
-                    self.ocl2dri_lib.ocl2dri_set_border(ctx, 1 if bordered else 0)
-                    return None
-                elif func_name == 'ocl.get_ocl2dra.set_min_size':
-                    if not self.ocl2dri_lib:
-                        raise ValueError("OCL2DRI library not loaded")
-                    if len(args) != 3 or not all(isinstance(arg, (int, float)) for arg in evaluated_args[1:]):
-                        raise ValueError("ocl.get_ocl2dra.set_min_size expects (context: pointer, min_width: int/float, min_height: int/float)")
-                    ctx, min_width, min_height = evaluated_args
-                    self.ocl2dri_lib.ocl2dri_set_min_size(ctx, int(min_width), int(min_height))
-                    return None
-                elif func_name == 'ocl.get_ocl2dra.set_max_size':
-                    if not self.ocl2dri_lib:
-                        raise ValueError("OCL2DRI library not loaded")
-                    if len(args) != 3 or not all(isinstance(arg, (int, float)) for arg in evaluated_args[1:]):
-                        raise ValueError("ocl.get_ocl2dra.set_max_size expects (context: pointer, max_width: int/float, max_height: int/float)")
-                    ctx, max_width, max_height = evaluated_args
-                    self.ocl2dri_lib.ocl2dri_set_max_size(ctx, int(max_width), int(max_height))
-                    return None
-                elif func_name == 'ocl.get_ocl2dra.set_always_on_top':
-                    if not self.ocl2dri_lib:
-                        raise ValueError("OCL2DRI library not loaded")
-                    if len(args) != 2 or not isinstance(evaluated_args[1], (int, bool)):
-                        raise ValueError("ocl.get_ocl2dra.set_always_on_top expects (context: pointer, on_top: bool/int)")
-                    ctx, on_top = evaluated_args
-                    self.ocl2dri_lib.ocl2dri_set_always_on_top(ctx, 1 if on_top else 0)
-                    return None
-                elif func_name == 'ocl.get_ocl2dra.set_resizable':
-                    if not self.ocl2dri_lib:
-                        raise ValueError("OCL2DRI library not loaded")
-                    if len(args) != 2 or not isinstance(evaluated_args[1], (int, bool)):
-                        raise ValueError("ocl.get_ocl2dra.set_resizable expects (context: pointer, resizable: bool/int)")
-                    ctx, resizable = evaluated_args
-                    self.ocl2dri_lib.ocl2dri_set_resizable(ctx, 1 if resizable else 0)
-                    return None
-                elif func_name == 'ocl.get_ocl2dra.set_frame_rate':
-                    if not self.ocl2dri_lib:
-                        raise ValueError("OCL2DRI library not loaded")
-                    if len(args) != 2 or not isinstance(evaluated_args[1], (int, float)):
-                        raise ValueError("ocl.get_ocl2dra.set_frame_rate expects (context: pointer, fps: int/float)")
-                    ctx, fps = evaluated_args
-                    self.ocl2dri_lib.ocl2dri_set_frame_rate(ctx, int(fps))
-                    return None
-                elif func_name == 'ocl.get_ocl2dra.hide':
-                    if not self.ocl2dri_lib:
-                        raise ValueError("OCL2DRI library not loaded")
-                    if len(args) != 1:
-                        raise ValueError("ocl.get_ocl2dra.hide expects (context: pointer)")
-                    ctx = evaluated_args[0]
-                    self.ocl2dri_lib.ocl2dri_hide(ctx)
-                    return None
-                elif func_name == 'ocl.get_ocl2dra.show':
-                    if not self.ocl2dri_lib:
-                        raise ValueError("OCL2DRI library not loaded")
-                    if len(args) != 1:
-                        raise ValueError("ocl.get_ocl2dra.show expects (context: pointer)")
-                    ctx = evaluated_args[0]
-                    self.ocl2dri_lib.ocl2dri_show(ctx)
-                    return None
-                elif func_name == 'ocl.get_ocl2dra.set_icon':
-                    if not self.ocl2dri_lib:
-                        raise ValueError("OCL2DRI library not loaded")
-                    if len(args) != 2 or not isinstance(evaluated_args[1], str):
-                        raise ValueError("ocl.get_ocl2dra.set_icon expects (context: pointer, icon_path: string)")
-                    ctx, icon_path = evaluated_args
-                    self.ocl2dri_lib.ocl2dri_set_icon(ctx, icon_path.encode('utf-8'))
-                    return None
-                elif func_name == 'ocl.get_ocl2dra.get_mouse_position':
-                    if not self.ocl2dri_lib:
-                        raise ValueError("OCL2DRI library not loaded")
-                    if len(args) != 1:
-                        raise ValueError("ocl.get_ocl2dra.get_mouse_position expects (context: pointer)")
-                    ctx = evaluated_args[0]
-                    x = ctypes.c_float()
-                    y = ctypes.c_float()
-                    self.ocl2dri_lib.ocl2dri_get_mouse_position(ctx, ctypes.byref(x), ctypes.byref(y))
-                    return (int(x.value), int(y.value))
-                elif func_name == 'ocl.get_ocl2dra.get_mouse_button_state':
-                    if not self.ocl2dri_lib:
-                        raise ValueError("OCL2DRI library not loaded")
-                    if len(args) != 2 or not isinstance(evaluated_args[1], (int, float)):
-                        raise ValueError("ocl.get_ocl2dra.get_mouse_button_state expects (context: pointer, button: int/float)")
-                    ctx, button = evaluated_args
-                    return self.ocl2dri_lib.ocl2dri_get_mouse_button_state(ctx, int(button))
-                elif func_name == 'ocl.get_ocl2dra.get_delta_time':
-                    if not self.ocl2dri_lib:
-                        raise ValueError("OCL2DRI library not loaded")
-                    if len(args) != 1:
-                        raise ValueError("ocl.get_ocl2dra.get_delta_time expects (context: pointer)")
-                    ctx = evaluated_args[0]
-                    return self.ocl2dri_lib.ocl2dri_get_delta_time(ctx)
-                elif func_name == 'ocl.get_ocl2dra.update':
-                    if not self.ocl2dri_lib:
-                        raise ValueError("OCL2DRI library not loaded")
-                    if len(args) != 1:
-                        raise ValueError("ocl.get_ocl2dra.update expects (context: pointer)")
-                    ctx = evaluated_args[0]
-                    self.ocl2dri_lib.ocl2dri_update(ctx)
-                    return None
-                elif func_name == 'ocl.get_ocl2dra.is_running':
-                    if not self.ocl2dri_lib:
-                        raise ValueError("OCL2DRI library not loaded")
-                    if len(args) != 1:
-                        raise ValueError("ocl.get_ocl2dra.is_running expects (context: pointer)")
-                    ctx = evaluated_args[0]
-                    return bool(self.ocl2dri_lib.ocl2dri_is_running(ctx))
-                elif func_name == 'ocl.get_ocl2dra.destroy':
-                    if not self.ocl2dri_lib:
-                        raise ValueError("OCL2DRI library not loaded")
-                    if len(args) != 1:
-                        raise ValueError("ocl.get_ocl2dra.destroy expects (context: pointer)")
-                    ctx = evaluated_args[0]
-                    self.ocl2dri_lib.ocl2dri_destroy(ctx)
-                    return None
-                elif func_name == 'ocl.get_ocl2dra.get_key_state':
-                    if not self.ocl2dri_lib:
-                        raise ValueError("OCL2DRI library not loaded")
-                    if len(args) != 2 or not isinstance(evaluated_args[1], str):
-                        raise ValueError("ocl.get_ocl2dra.get_key_state expects (context: pointer, key: string)")
-                    ctx, key = evaluated_args
-                    return self.ocl2dri_lib.ocl2dri_get_key_state(ctx, key.encode('utf-8'))
-                elif func_name in self.functions:
-                    params, body = self.functions[func_name]
-                    if len(params) != len(evaluated_args):
-                        raise ValueError(f"Function '{func_name}' expects {len(params)} arguments, got {len(evaluated_args)}")
-                    local_vars = {param[0]: arg for (param, _), arg in zip(params, evaluated_args)}
-                    old_vars = self.variables.copy()
-                    self.variables = {**self.variables, **local_vars}
-                    try:
-                        result = self.interpret(body, in_function=True)
-                        self.variables = old_vars
-                        return result if result is not None else None
-                    except ReturnException as e:
-                        self.variables = old_vars
-                        return e.value
-                else:
-                    raise ValueError(f"Undefined function: '{func_name}'")
+                    value = fn(current_val, expr_val)
+                except (TypeError, ZeroDivisionError):
+                    value = self.apply_op(current_val, op, expr_val)
             else:
-                raise ValueError(f"Unknown expression type: {expr_type}")
-        except Exception as e:
-            self.log_error(f"Error evaluating expression {str(expr)[:50]}...: {str(e)}")
-            if self.debug_mode:
-                print(traceback.format_exc())
-            return None  # Continue despite error
+                value = self.apply_op(current_val, op, expr_val)
+            check = statement.check
+            if check is not None and value is not None and not isinstance(value, check):
+                raise TypeError(f"Variable '{name}' annotated as {self.annotation_name(check)}, got {type(value).__name__}")
+            self.variables[name] = value
 
-    def interpolate_string(self, string):
+    def exec_print(self, statement):
+        value = self.evaluate(statement.value)
+        text = (str(value) if value is not None else "null") + "\n"
+        self.output.append(text)
+        self.output_size += len(text)
+        if self.output_size >= self.output_limit:
+            self.flush_output()
+
+    def flush_output(self):
+        if self.output:
+            sys.stdout.write(''.join(self.output))
+            self.output = []
+            self.output_size = 0
+        sys.stdout.flush()
+
+    def exec_if(self, statement):
+        condition_val = self.evaluate(statement.condition)
+        if not isinstance(condition_val, bool):
+            raise TypeError("If condition must evaluate to a boolean")
+        if condition_val:
+            return self.execute_block(statement.body)
+        for elif_cond, elif_body in statement.elifs:
+            elif_cond_val = self.evaluate(elif_cond)
+            if not isinstance(elif_cond_val, bool):
+                raise TypeError("Elif condition must evaluate to a boolean")
+            if elif_cond_val:
+                return self.execute_block(elif_body)
+        if statement.else_body:
+            return self.execute_block(statement.else_body)
+
+    def exec_while(self, statement):
+        condition = statement.condition
+        body = statement.body
+        while True:
+            condition_val = self.evaluate(condition)
+            if not isinstance(condition_val, bool):
+                raise TypeError("While condition must evaluate to a boolean")
+            if not condition_val:
+                break
+            completion = self.execute_block(body)
+            if completion is not None:
+                if completion is BREAK:
+                    break
+                if completion is RETURN:
+                    return RETURN
+
+    def exec_for_range(self, statement):
+        bounds = []
+        for bound_expr in (statement.start, statement.stop, statement.step):
+            bound = self.evaluate(bound_expr)
+            if not isinstance(bound, int) or isinstance(bound, bool):
+                raise TypeError(f"range() arguments must be int, got {type(bound).__name__}")
+            bounds.append(bound)
+        if bounds[2] == 0:
+            raise ValueError("range() step must not be zero")
+        # The bounds are evaluated once; the loop variable is bound straight
+        # from a Python range iterator instead of an evaluated comparison and
+        # an aug_assign per iteration.
+        var_name = statement.var
+        body = statement.body
+        variables = self.variables
+        execute_block = self.execute_block
+        for value in range(*bounds):
+            variables[var_name] = value
+            completion = execute_block(body)
+            if completion is not None:
+                if completion is BREAK:
+                    break
+                if completion is RETURN:
+                    return RETURN
+
+    def exec_for_each(self, statement):
+        iterable = self.evaluate(statement.iterable)
+        if not isinstance(iterable, OclArray):
+            raise TypeError(f"Cannot iterate over {type(iterable).__name__}; expected an array")
+        var_name = statement.var
+        body = statement.body
+        variables = self.variables
+        execute_block = self.execute_block
+        for value in iterable.data:
+            variables[var_name] = value
+            completion = execute_block(body)
+            if completion is not None:
+                if completion is BREAK:
+                    break
+                if completion is RETURN:
+                    return RETURN
+
+    def exec_define(self, statement):
+        self.define_function(statement.name, statement.params, statement.body)
+
+    def define_function(self, name, params, body):
+        self.functions[name] = (params, body)
+        checks = self.specializer.function(params, body)
+        if checks:
+            self.param_checks[name] = checks
+        else:
+            self.param_checks.pop(name, None)
+
+    def check_arguments(self, func_name, checks, evaluated_args):
+        for index, name, annot in checks:
+            value = evaluated_args[index]
+            if value is not None and not isinstance(value, SCALAR_TYPES[annot]):
+                raise TypeError(f"Parameter '{name}' of '{func_name}' annotated as {annot}, got {type(value).__name__}")
+
+    def exec_class(self, statement):
+        self.classes[statement.name] = self.compile_class(statement.name, statement.methods)
+
+    def exec_return(self, statement):
+        self.return_value = self.evaluate(statement.value)
+        return RETURN
+
+    def exec_break(self, statement):
+        return BREAK
+
+    def exec_continue(self, statement):
+        return CONTINUE
+
+    def exec_call(self, statement):
+        self.call_value = self.expression_handlers[statement.kind](statement)
+
+    def exec_yield(self, statement):
+        if self.scheduler.current is None:
+            raise ValueError("'yield' used outside a spawned task")
+        self.scheduler.wait_frames(1)
+
+    def eval_unknown(self, expr):
+        raise ValueError(f"Unknown expression type: {type(expr).__name__}")
+
+    def eval_literal(self, expr):
+        if isinstance(expr.value, str):
+            return self.interpolate_string(expr.value)
+        return expr.value
+
+    def eval_identifier(self, expr):
+        name = expr.name
+        if '.' in name:
+            return self.resolve(name)
+        if name not in self.variables:
+            raise NameError(f"Variable '{name}' is not defined")
+        return self.variables[name]
+
+    def eval_binary(self, expr):
+        left_val = self.evaluate(expr.left)
+        right_val = self.evaluate(expr.right)
+        fn = expr.fn
+        if fn is not None:
+            # Specialized from annotations. A null operand or a zero divisor
+            # fails here and gets apply_op's error message.
+            try:
+                return fn(left_val, right_val)
+            except (TypeError, ZeroDivisionError):
+                pass
+        return self.apply_op(left_val, expr.op, right_val)
+
+    @staticmethod
+    def annotation_name(python_type):
+        return next(name for name, value in SCALAR_TYPES.items() if value is python_type)
+
+    def eval_index(self, expr):
+        base = self.evaluate(expr.base)
+        index = self.evaluate(expr.index)
+        if isinstance(base, OclArray):
+            if not isinstance(index, int) or not 0 <= index < len(base):
+                raise ValueError(f"Array index {index} out of range for array of length {len(base)}")
+            return base.data[index]
+        if not isinstance(base, tuple):
+            raise ValueError(f"Cannot index non-tuple value: {base}")
+        if not isinstance(index, int):
+            raise ValueError(f"Index must be an integer, got: {index}")
+        if 0 <= index < len(base):
+            return base[index]
+        raise ValueError(f"Index {index} out of range for tuple of length {len(base)}")
+
+    def eval_attribute(self, expr):
+        attr = expr.attr
+        base = self.evaluate(expr.base)
+        if type(base) is OclObject:
+            if expr.shape is base.shape:
+                value = base.slots[expr.target]
+            else:
+                index = base.shape.fields.get(attr)
+                if index is None:
+                    return self.get_member(base, attr)
+                expr.shape = base.shape
+                expr.target = index
+                value = base.slots[index]
+            if value is _UNSET:
+                raise ValueError(f"Attribute '{attr}' not found on object")
+            if value is None:
+                raise ValueError(f"Attribute '{attr}' has null value")
+            return value
+        return self.get_member(base, attr)
+
+    def eval_call_method(self, expr):
+        object_expr = expr.obj
+        method_name = expr.method
+        args = expr.args
+        if object_expr.kind == IDENTIFIER and object_expr.name not in self.variables:
+            dotted_name = f"{object_expr.name}.{method_name}"
+            if dotted_name in self.functions:
+                return self.call_function(dotted_name, [self.evaluate(arg) for arg in args])
+        obj = self.evaluate(object_expr)
+        if type(obj) is OclObject:
+            # Monomorphic fast path: the cached method was looked up and
+            # arity-checked for this shape the first time this site ran.
+            if expr.shape is obj.shape:
+                method = expr.target
+            else:
+                method = self.bind_call_site(expr, obj.shape, method_name, len(args))
+            evaluated_args = [self.evaluate(arg) for arg in args]
+            if method.param_checks:
+                self.check_arguments(f"{obj.shape.name}.{method_name}", method.param_checks, evaluated_args)
+            return self.invoke(method.body, method.param_names, evaluated_args, obj if method.has_self else None)
+        evaluated_args = [self.evaluate(arg) for arg in args]
+        if isinstance(obj, OclArray):
+            return self.call_array_method(obj, method_name, evaluated_args)
+        if isinstance(obj, OclStringBuilder):
+            return self.call_builder_method(obj, method_name, evaluated_args)
+        if isinstance(obj, OclTask):
+            return self.call_task_method(obj, method_name, evaluated_args)
+        raise ValueError("Attempt to call method on non-object")
+
+    def eval_call(self, expr):
+        return self.call_function(expr.name, [self.evaluate(arg) for arg in expr.args])
+
+    def eval_spawn(self, expr):
+        """Start a function or method call as a task. Arguments and the
+        receiver are evaluated now; the call runs until its first wait before
+        spawn returns the task."""
+        call = expr.call
+        if call.kind == CALL:
+            name = call.name
+            if name not in self.functions:
+                raise ValueError(f"Undefined function: '{name}'")
+            evaluated_args = [self.evaluate(arg) for arg in call.args]
+            return self.scheduler.spawn(name, lambda: self.call_function(name, evaluated_args))
+        object_expr = call.obj
+        method_name = call.method
+        if object_expr.kind == IDENTIFIER and object_expr.name not in self.variables:
+            dotted_name = f"{object_expr.name}.{method_name}"
+            if dotted_name in self.functions:
+                evaluated_args = [self.evaluate(arg) for arg in call.args]
+                return self.scheduler.spawn(dotted_name, lambda: self.call_function(dotted_name, evaluated_args))
+        obj = self.evaluate(object_expr)
+        if type(obj) is not OclObject:
+            raise ValueError("spawn expects a function call or a method call on an object")
+        if call.shape is obj.shape:
+            method = call.target
+        else:
+            method = self.bind_call_site(call, obj.shape, method_name, len(call.args))
+        evaluated_args = [self.evaluate(arg) for arg in call.args]
+        if method.param_checks:
+            self.check_arguments(f"{obj.shape.name}.{method_name}", method.param_checks, evaluated_args)
+        self_obj = obj if method.has_self else None
+        return self.scheduler.spawn(f"{obj.shape.name}.{method_name}",
+                                    lambda: self.invoke(method.body, method.param_names, evaluated_args, self_obj))
+
+    def call_function(self, func_name, evaluated_args):
+        if func_name == 'ocl.classes':
+            if len(evaluated_args) != 1 or not isinstance(evaluated_args[0], str):
+                raise ValueError("ocl.classes expects one string argument")
+            class_name = evaluated_args[0]
+            if class_name not in self.classes:
+                raise ValueError(f"Class '{class_name}' not defined")
+            return OclObject(self.classes[class_name])
+        elif func_name == 'ocl.array':
+            if len(evaluated_args) not in (1, 2) or not isinstance(evaluated_args[0], int) or (len(evaluated_args) == 2 and not isinstance(evaluated_args[1], str)):
+                raise ValueError("ocl.array expects (size: int[, type: \"float\"/\"int\"])")
+            return OclArray(evaluated_args[0], evaluated_args[1] if len(evaluated_args) == 2 else 'float')
+        elif func_name == 'ocl.string_builder':
+            if evaluated_args:
+                raise ValueError("ocl.string_builder expects no arguments")
+            return OclStringBuilder()
+        elif func_name == 'ocl.flush':
+            if evaluated_args:
+                raise ValueError("ocl.flush expects no arguments")
+            self.flush_output()
+            return None
+        elif func_name == 'ocl.get_input':
+            if len(evaluated_args) != 1 or not isinstance(evaluated_args[0], str):
+                raise ValueError("ocl.get_input expects one string argument")
+            self.flush_output()
+            sys.stdout.write(evaluated_args[0])
+            sys.stdout.flush()
+            try:
+                user_input = input()
+            except KeyboardInterrupt:
+                raise KeyboardInterrupt("Input interrupted by user")
+            sys.stdout.write("\n")
+            sys.stdout.flush()
+            return user_input
+        elif func_name == 'ocl.get_set_input':
+            if len(evaluated_args) != 1 or not isinstance(evaluated_args[0], str):
+                raise ValueError("ocl.get_set_input expects one string argument")
+            self.flush_output()
+            sys.stdout.write(evaluated_args[0])
+            sys.stdout.flush()
+            try:
+                user_input = input()
+            except KeyboardInterrupt:
+                raise KeyboardInterrupt("Input interrupted by user")
+            sys.stdout.write("\n")
+            sys.stdout.flush()
+            self.variables['input_value'] = user_input
+            return None
+        elif func_name == 'ocl.get_ocl2dra.init':
+            if not self.ocl2dri_lib:
+                raise ValueError("OCL2DRI library not loaded")
+            if len(evaluated_args) != 3 or not all(isinstance(arg, (int, str)) for arg in evaluated_args[:2] + evaluated_args[2:]):
+                raise ValueError("ocl.get_ocl2dra.init expects (width: int, height: int, title: string)")
+            width, height, title = evaluated_args
+            ctx_ptr = self.ocl2dri_lib.ocl2dri_init(width, height, title.encode('utf-8'))
+            if not ctx_ptr:
+                self.log_error("Failed to initialize OCL2DRI context")
+                return None
+            self.ocl2dri_lib.ocl2dri_update(ctx_ptr)
+            return ctx_ptr
+        elif func_name == 'ocl.get_ocl2dra.set_background':
+            if not self.ocl2dri_lib:
+                raise ValueError("OCL2DRI library not loaded")
+            if len(evaluated_args) != 4 or not all(isinstance(arg, (int, float)) for arg in evaluated_args[1:]):
+                raise ValueError("ocl.get_ocl2dra.set_background expects (context: pointer, r: int/float, g: int/float, b: int/float)")
+            ctx, r, g, b = evaluated_args
+            self.ocl2dri_lib.ocl2dri_set_background(ctx, int(r), int(g), int(b))
+            return None
+        elif func_name == 'ocl.get_ocl2dra.set_title':
+            if not self.ocl2dri_lib:
+                raise ValueError("OCL2DRI library not loaded")
+            if len(evaluated_args) != 2 or not isinstance(evaluated_args[1], str):
+                raise ValueError("ocl.get_ocl2dra.set_title expects (context: pointer, title: string)")
+            ctx, title = evaluated_args
+            self.ocl2dri_lib.ocl2dri_set_title(ctx, title.encode('utf-8'))
+            return None
+        elif func_name == 'ocl.get_ocl2dra.set_size':
+            if not self.ocl2dri_lib:
+                raise ValueError("OCL2DRI library not loaded")
+            if len(evaluated_args) != 3 or not all(isinstance(arg, (int, float)) for arg in evaluated_args[1:]):
+                raise ValueError("ocl.get_ocl2dra.set_size expects (context: pointer, width: int/float, height: int/float)")
+            ctx, width, height = evaluated_args
+            self.ocl2dri_lib.ocl2dri_set_size(ctx, int(width), int(height))
+            return None
+        elif func_name == 'ocl.get_ocl2dra.set_position':
+            if not self.ocl2dri_lib:
+                raise ValueError("OCL2DRI library not loaded")
+            if len(evaluated_args) != 3 or not all(isinstance(arg, (int, float)) for arg in evaluated_args[1:]):
+                raise ValueError("ocl.get_ocl2dra.set_position expects (context: pointer, x: int/float, y: int/float)")
+            ctx, x, y = evaluated_args
+            self.ocl2dri_lib.ocl2dri_set_position(ctx, int(x), int(y))
+            return None
+        elif func_name == 'ocl.get_ocl2dra.set_fullscreen':
+            if not self.ocl2dri_lib:
+                raise ValueError("OCL2DRI library not loaded")
+            if len(evaluated_args) != 2 or not isinstance(evaluated_args[1], (int, bool)):
+                raise ValueError("ocl.get_ocl2dra.set_fullscreen expects (context: pointer, fullscreen: bool/int)")
+            ctx, fullscreen = evaluated_args
+            self.ocl2dri_lib.ocl2dri_set_fullscreen(ctx, 1 if fullscreen else 0)
+            return None
+        elif func_name == 'ocl.get_ocl2dra.set_opacity':
+            if not self.ocl2dri_lib:
+                raise ValueError("OCL2DRI library not loaded")
+            if len(evaluated_args) != 2 or not isinstance(evaluated_args[1], (int, float)):
+                raise ValueError("ocl.get_ocl2dra.set_opacity expects (context: pointer, opacity: float 0.0-1.0)")
+            ctx, opacity = evaluated_args
+            self.ocl2dri_lib.ocl2dri_set_opacity(ctx, float(opacity))
+            return None
+        elif func_name == 'ocl.get_ocl2dra.set_border':
+            if not self.ocl2dri_lib:
+                raise ValueError("OCL2DRI library not loaded")
+            if len(evaluated_args) != 2 or not isinstance(evaluated_args[1], (int, bool)):
+                raise ValueError("ocl.get_ocl2dra.set_border expects (context: pointer, bordered: bool/int)")
+            ctx, bordered = evaluated_args
+            self.ocl2dri_lib.ocl2dri_set_border(ctx, 1 if bordered else 0)
+            return None
+        elif func_name == 'ocl.get_ocl2dra.set_min_size':
+            if not self.ocl2dri_lib:
+                raise ValueError("OCL2DRI library not loaded")
+            if len(evaluated_args) != 3 or not all(isinstance(arg, (int, float)) for arg in evaluated_args[1:]):
+                raise ValueError("ocl.get_ocl2dra.set_min_size expects (context: pointer, min_width: int/float, min_height: int/float)")
+            ctx, min_width, min_height = evaluated_args
+            self.ocl2dri_lib.ocl2dri_set_min_size(ctx, int(min_width), int(min_height))
+            return None
+        elif func_name == 'ocl.get_ocl2dra.set_max_size':
+            if not self.ocl2dri_lib:
+                raise ValueError("OCL2DRI library not loaded")
+            if len(evaluated_args) != 3 or not all(isinstance(arg, (int, float)) for arg in evaluated_args[1:]):
+                raise ValueError("ocl.get_ocl2dra.set_max_size expects (context: pointer, max_width: int/float, max_height: int/float)")
+            ctx, max_width, max_height = evaluated_args
+            self.ocl2dri_lib.ocl2dri_set_max_size(ctx, int(max_width), int(max_height))
+            return None
+        elif func_name == 'ocl.get_ocl2dra.set_always_on_top':
+            if not self.ocl2dri_lib:
+                raise ValueError("OCL2DRI library not loaded")
+            if len(evaluated_args) != 2 or not isinstance(evaluated_args[1], (int, bool)):
+                raise ValueError("ocl.get_ocl2dra.set_always_on_top expects (context: pointer, on_top: bool/int)")
+            ctx, on_top = evaluated_args
+            self.ocl2dri_lib.ocl2dri_set_always_on_top(ctx, 1 if on_top else 0)
+            return None
+        elif func_name == 'ocl.get_ocl2dra.set_resizable':
+            if not self.ocl2dri_lib:
+                raise ValueError("OCL2DRI library not loaded")
+            if len(evaluated_args) != 2 or not isinstance(evaluated_args[1], (int, bool)):
+                raise ValueError("ocl.get_ocl2dra.set_resizable expects (context: pointer, resizable: bool/int)")
+            ctx, resizable = evaluated_args
+            self.ocl2dri_lib.ocl2dri_set_resizable(ctx, 1 if resizable else 0)
+            return None
+        elif func_name == 'ocl.get_ocl2dra.set_frame_rate':
+            if not self.ocl2dri_lib:
+                raise ValueError("OCL2DRI library not loaded")
+            if len(evaluated_args) != 2 or not isinstance(evaluated_args[1], (int, float)):
+                raise ValueError("ocl.get_ocl2dra.set_frame_rate expects (context: pointer, fps: int/float)")
+            ctx, fps = evaluated_args
+            self.ocl2dri_lib.ocl2dri_set_frame_rate(ctx, int(fps))
+            return None
+        elif func_name == 'ocl.get_ocl2dra.hide':
+            if not self.ocl2dri_lib:
+                raise ValueError("OCL2DRI library not loaded")
+            if len(evaluated_args) != 1:
+                raise ValueError("ocl.get_ocl2dra.hide expects (context: pointer)")
+            ctx = evaluated_args[0]
+            self.ocl2dri_lib.ocl2dri_hide(ctx)
+            return None
+        elif func_name == 'ocl.get_ocl2dra.show':
+            if not self.ocl2dri_lib:
+                raise ValueError("OCL2DRI library not loaded")
+            if len(evaluated_args) != 1:
+                raise ValueError("ocl.get_ocl2dra.show expects (context: pointer)")
+            ctx = evaluated_args[0]
+            self.ocl2dri_lib.ocl2dri_show(ctx)
+            return None
+        elif func_name == 'ocl.get_ocl2dra.set_icon':
+            if not self.ocl2dri_lib:
+                raise ValueError("OCL2DRI library not loaded")
+            if len(evaluated_args) != 2 or not isinstance(evaluated_args[1], str):
+                raise ValueError("ocl.get_ocl2dra.set_icon expects (context: pointer, icon_path: string)")
+            ctx, icon_path = evaluated_args
+            self.ocl2dri_lib.ocl2dri_set_icon(ctx, icon_path.encode('utf-8'))
+            return None
+        elif func_name == 'ocl.get_ocl2dra.get_mouse_position':
+            if not self.ocl2dri_lib:
+                raise ValueError("OCL2DRI library not loaded")
+            if len(evaluated_args) != 1:
+                raise ValueError("ocl.get_ocl2dra.get_mouse_position expects (context: pointer)")
+            ctx = evaluated_args[0]
+            import ctypes
+            x = ctypes.c_float()
+            y = ctypes.c_float()
+            self.ocl2dri_lib.ocl2dri_get_mouse_position(ctx, ctypes.byref(x), ctypes.byref(y))
+            return (int(x.value), int(y.value))
+        elif func_name == 'ocl.get_ocl2dra.get_mouse_button_state':
+            if not self.ocl2dri_lib:
+                raise ValueError("OCL2DRI library not loaded")
+            if len(evaluated_args) != 2 or not isinstance(evaluated_args[1], (int, float)):
+                raise ValueError("ocl.get_ocl2dra.get_mouse_button_state expects (context: pointer, button: int/float)")
+            ctx, button = evaluated_args
+            return self.ocl2dri_lib.ocl2dri_get_mouse_button_state(ctx, int(button))
+        elif func_name == 'ocl.get_ocl2dra.get_delta_time':
+            if not self.ocl2dri_lib:
+                raise ValueError("OCL2DRI library not loaded")
+            if len(evaluated_args) != 1:
+                raise ValueError("ocl.get_ocl2dra.get_delta_time expects (context: pointer)")
+            ctx = evaluated_args[0]
+            return self.ocl2dri_lib.ocl2dri_get_delta_time(ctx)
+        elif func_name == 'ocl.get_ocl2dra.update':
+            if not self.ocl2dri_lib:
+                raise ValueError("OCL2DRI library not loaded")
+            if len(evaluated_args) != 1:
+                raise ValueError("ocl.get_ocl2dra.update expects (context: pointer)")
+            ctx = evaluated_args[0]
+            self.flush_output()
+            self.ocl2dri_lib.ocl2dri_update(ctx)
+            if self.hot_reload_path:
+                self.poll_hot_reload()
+            self.scheduler.tick()
+            return None
+        elif func_name == 'ocl.get_ocl2dra.is_running':
+            if not self.ocl2dri_lib:
+                raise ValueError("OCL2DRI library not loaded")
+            if len(evaluated_args) != 1:
+                raise ValueError("ocl.get_ocl2dra.is_running expects (context: pointer)")
+            ctx = evaluated_args[0]
+            return bool(self.ocl2dri_lib.ocl2dri_is_running(ctx))
+        elif func_name == 'ocl.get_ocl2dra.destroy':
+            if not self.ocl2dri_lib:
+                raise ValueError("OCL2DRI library not loaded")
+            if len(evaluated_args) != 1:
+                raise ValueError("ocl.get_ocl2dra.destroy expects (context: pointer)")
+            ctx = evaluated_args[0]
+            self.ocl2dri_lib.ocl2dri_destroy(ctx)
+            return None
+        elif func_name == 'ocl.get_ocl2dra.get_key_state':
+            if not self.ocl2dri_lib:
+                raise ValueError("OCL2DRI library not loaded")
+            if len(evaluated_args) != 2 or not isinstance(evaluated_args[1], str):
+                raise ValueError("ocl.get_ocl2dra.get_key_state expects (context: pointer, key: string)")
+            ctx, key = evaluated_args
+            return self.ocl2dri_lib.ocl2dri_get_key_state(ctx, key.encode('utf-8'))
+        elif func_name == 'ocl.get_ocl2dra.get_frame_stats':
+            if not self.ocl2dri_lib:
+                raise ValueError("OCL2DRI library not loaded")
+            if len(evaluated_args) != 1:
+                raise ValueError("ocl.get_ocl2dra.get_frame_stats expects (context: pointer)")
+            stats = self.frame_stats_type()
+            if not self.ocl2dri_lib.ocl2dri_get_frame_stats(evaluated_args[0], stats):
+                return None
+            return {name: getattr(stats, name) for name, _ in stats._fields_}
+        elif func_name == 'ocl.get_ocl2dra.export_frame_stats':
+            if not self.ocl2dri_lib:
+                raise ValueError("OCL2DRI library not loaded")
+            if len(evaluated_args) != 2 or not isinstance(evaluated_args[1], str):
+                raise ValueError("ocl.get_ocl2dra.export_frame_stats expects (context: pointer, csv_path: string)")
+            ctx, path = evaluated_args
+            return bool(self.ocl2dri_lib.ocl2dri_export_frame_stats(ctx, path.encode('utf-8')))
+        elif func_name == 'ocl.get_ocl2dra.set_stats_overlay':
+            if not self.ocl2dri_lib:
+                raise ValueError("OCL2DRI library not loaded")
+            if len(evaluated_args) != 2 or not isinstance(evaluated_args[1], (int, bool)):
+                raise ValueError("ocl.get_ocl2dra.set_stats_overlay expects (context: pointer, enabled: bool/int)")
+            ctx, enabled = evaluated_args
+            self.ocl2dri_lib.ocl2dri_set_stats_overlay(ctx, bool(enabled))
+            return None
+        elif func_name == 'ocl.get_ocl2dra.set_pipelined':
+            if not self.ocl2dri_lib:
+                raise ValueError("OCL2DRI library not loaded")
+            if len(evaluated_args) not in (2, 3) or not isinstance(evaluated_args[1], (int, bool)):
+                raise ValueError("ocl.get_ocl2dra.set_pipelined expects (context: pointer, enabled: bool/int[, queue_depth: int])")
+            ctx, enabled = evaluated_args[:2]
+            queue_depth = int(evaluated_args[2]) if len(evaluated_args) == 3 else 1
+            return bool(self.ocl2dri_lib.ocl2dri_set_pipelined(ctx, bool(enabled), queue_depth))
+        elif func_name == 'ocl.get_ocl2dra.set_draw_color':
+            if not self.ocl2dri_lib:
+                raise ValueError("OCL2DRI library not loaded")
+            if len(evaluated_args) not in (4, 5) or not all(isinstance(arg, (int, float)) for arg in evaluated_args[1:]):
+                raise ValueError("ocl.get_ocl2dra.set_draw_color expects (context: pointer, r: int/float, g: int/float, b: int/float[, a: int/float])")
+            ctx, r, g, b = evaluated_args[:4]
+            a = evaluated_args[4] if len(evaluated_args) == 5 else 255
+            self.ocl2dri_lib.ocl2dri_set_draw_color(ctx, int(r), int(g), int(b), int(a))
+            return None
+        elif func_name == 'ocl.get_ocl2dra.fill_rects':
+            if not self.ocl2dri_lib:
+                raise ValueError("OCL2DRI library not loaded")
+            if len(evaluated_args) != 2 or not isinstance(evaluated_args[1], OclArray) or evaluated_args[1].elem_type != 'float' or len(evaluated_args[1]) % 4:
+                raise ValueError("ocl.get_ocl2dra.fill_rects expects (context: pointer, rects: float array of x, y, w, h groups)")
+            ctx, rects = evaluated_args
+            if len(rects):
+                import ctypes
+                # Hand the array's own storage to the library; no per-element conversion.
+                buffer = (ctypes.c_float * len(rects)).from_buffer(rects.data)
+                self.ocl2dri_lib.ocl2dri_fill_rects(ctx, buffer, len(rects) // 4)
+            return None
+        elif func_name == 'ocl.get_ocl2dra.load_font':
+            if not self.ocl2dri_lib:
+                raise ValueError("OCL2DRI library not loaded")
+            if len(evaluated_args) != 3 or not isinstance(evaluated_args[1], str) or not isinstance(evaluated_args[2], (int, float)):
+                raise ValueError("ocl.get_ocl2dra.load_font expects (context: pointer, path: string, size: int/float)")
+            ctx, path, size = evaluated_args
+            font = self.ocl2dri_lib.ocl2dri_load_font(ctx, path.encode('utf-8'), float(size))
+            if font < 0:
+                raise ValueError(f"Failed to load font '{path}'")
+            return font
+        elif func_name == 'ocl.get_ocl2dra.draw_text':
+            if not self.ocl2dri_lib:
+                raise ValueError("OCL2DRI library not loaded")
+            if (len(evaluated_args) != 5 or not isinstance(evaluated_args[1], int)
+                    or not all(isinstance(arg, (int, float)) for arg in evaluated_args[2:4])):
+                raise ValueError("ocl.get_ocl2dra.draw_text expects (context: pointer, font: int, x: int/float, y: int/float, text)")
+            ctx, font, x, y, text = evaluated_args
+            self.ocl2dri_lib.ocl2dri_draw_text(ctx, font, float(x), float(y), str(text).encode('utf-8'))
+            return None
+        elif func_name == 'ocl.get_ocl2dra.emitter_create':
+            if not self.ocl2dri_lib:
+                raise ValueError("OCL2DRI library not loaded")
+            if len(evaluated_args) != 2 or not isinstance(evaluated_args[1], int):
+                raise ValueError("ocl.get_ocl2dra.emitter_create expects (context: pointer, capacity: int)")
+            emitter = self.ocl2dri_lib.ocl2dri_emitter_create(*evaluated_args)
+            if not emitter:
+                raise ValueError("Failed to create emitter")
+            return emitter
+        elif func_name in ('ocl.get_ocl2dra.emitter_set_position', 'ocl.get_ocl2dra.emitter_set_rate',
+                           'ocl.get_ocl2dra.emitter_set_velocity', 'ocl.get_ocl2dra.emitter_set_life',
+                           'ocl.get_ocl2dra.emitter_set_gravity', 'ocl.get_ocl2dra.emitter_set_size',
+                           'ocl.get_ocl2dra.emitter_set_colors'):
+            if not self.ocl2dri_lib:
+                raise ValueError("OCL2DRI library not loaded")
+            name = func_name.rsplit('.', 1)[1]
+            arity = {'emitter_set_position': 2, 'emitter_set_rate': 1, 'emitter_set_velocity': 4,
+                     'emitter_set_life': 2, 'emitter_set_gravity': 2, 'emitter_set_size': 1,
+                     'emitter_set_colors': 8}[name]
+            if len(evaluated_args) != arity + 1 or not all(isinstance(arg, (int, float)) for arg in evaluated_args[1:]):
+                raise ValueError(f"{func_name} expects (emitter: pointer, {arity} int/float values)")
+            emitter, values = evaluated_args[0], evaluated_args[1:]
+            values = [int(v) for v in values] if name == 'emitter_set_colors' else [float(v) for v in values]
+            getattr(self.ocl2dri_lib, 'ocl2dri_' + name)(emitter, *values)
+            return None
+        elif func_name == 'ocl.get_ocl2dra.emitter_burst':
+            if not self.ocl2dri_lib:
+                raise ValueError("OCL2DRI library not loaded")
+            if len(evaluated_args) != 2 or not isinstance(evaluated_args[1], int):
+                raise ValueError("ocl.get_ocl2dra.emitter_burst expects (emitter: pointer, count: int)")
+            self.ocl2dri_lib.ocl2dri_emitter_burst(*evaluated_args)
+            return None
+        elif func_name == 'ocl.get_ocl2dra.emitter_count':
+            if not self.ocl2dri_lib:
+                raise ValueError("OCL2DRI library not loaded")
+            if len(evaluated_args) != 1:
+                raise ValueError("ocl.get_ocl2dra.emitter_count expects (emitter: pointer)")
+            return self.ocl2dri_lib.ocl2dri_emitter_count(evaluated_args[0])
+        elif func_name == 'ocl.get_ocl2dra.emitter_destroy':
+            if not self.ocl2dri_lib:
+                raise ValueError("OCL2DRI library not loaded")
+            if len(evaluated_args) != 1:
+                raise ValueError("ocl.get_ocl2dra.emitter_destroy expects (emitter: pointer)")
+            self.ocl2dri_lib.ocl2dri_emitter_destroy(evaluated_args[0])
+            return None
+        elif func_name == 'ocl.get_ocl2dra.spatial_create':
+            if not self.ocl2dri_lib:
+                raise ValueError("OCL2DRI library not loaded")
+            if len(evaluated_args) != 1 or not isinstance(evaluated_args[0], (int, float)) or evaluated_args[0] <= 0:
+                raise ValueError("ocl.get_ocl2dra.spatial_create expects (cell_size: positive int/float)")
+            return self.ocl2dri_lib.ocl2dri_spatial_create(float(evaluated_args[0]))
+        elif func_name == 'ocl.get_ocl2dra.spatial_update':
+            if not self.ocl2dri_lib:
+                raise ValueError("OCL2DRI library not loaded")
+            if len(evaluated_args) != 2 or not isinstance(evaluated_args[1], OclArray) or evaluated_args[1].elem_type != 'float' or len(evaluated_args[1]) % 4:
+                raise ValueError("ocl.get_ocl2dra.spatial_update expects (grid: pointer, boxes: float array of x, y, w, h groups)")
+            grid, boxes = evaluated_args
+            import ctypes
+            buffer = (ctypes.c_float * len(boxes)).from_buffer(boxes.data) if len(boxes) else None
+            if not self.ocl2dri_lib.ocl2dri_spatial_update(grid, buffer, len(boxes) // 4):
+                raise ValueError("ocl.get_ocl2dra.spatial_update ran out of memory (is the cell size far smaller than the boxes?)")
+            return None
+        elif func_name == 'ocl.get_ocl2dra.spatial_query_pairs':
+            if not self.ocl2dri_lib:
+                raise ValueError("OCL2DRI library not loaded")
+            if len(evaluated_args) != 1:
+                raise ValueError("ocl.get_ocl2dra.spatial_query_pairs expects (grid: pointer)")
+            return self.native_id_array(self.ocl2dri_lib.ocl2dri_spatial_query_pairs, evaluated_args, width=2)
+        elif func_name == 'ocl.get_ocl2dra.spatial_query_rect':
+            if not self.ocl2dri_lib:
+                raise ValueError("OCL2DRI library not loaded")
+            if len(evaluated_args) != 5 or not all(isinstance(arg, (int, float)) for arg in evaluated_args[1:]):
+                raise ValueError("ocl.get_ocl2dra.spatial_query_rect expects (grid: pointer, x, y, w, h: int/float)")
+            grid, x, y, w, h = evaluated_args
+            return self.native_id_array(self.ocl2dri_lib.ocl2dri_spatial_query_rect, (grid, float(x), float(y), float(w), float(h)))
+        elif func_name == 'ocl.get_ocl2dra.spatial_query_point':
+            if not self.ocl2dri_lib:
+                raise ValueError("OCL2DRI library not loaded")
+            if len(evaluated_args) != 3 or not all(isinstance(arg, (int, float)) for arg in evaluated_args[1:]):
+                raise ValueError("ocl.get_ocl2dra.spatial_query_point expects (grid: pointer, x: int/float, y: int/float)")
+            grid, x, y = evaluated_args
+            return self.native_id_array(self.ocl2dri_lib.ocl2dri_spatial_query_point, (grid, float(x), float(y)))
+        elif func_name == 'ocl.get_ocl2dra.spatial_destroy':
+            if not self.ocl2dri_lib:
+                raise ValueError("OCL2DRI library not loaded")
+            if len(evaluated_args) != 1:
+                raise ValueError("ocl.get_ocl2dra.spatial_destroy expects (grid: pointer)")
+            self.ocl2dri_lib.ocl2dri_spatial_destroy(evaluated_args[0])
+            return None
+        elif func_name == 'ocl.get_ocl2dra.load_texture_async':
+            if not self.ocl2dri_lib:
+                raise ValueError("OCL2DRI library not loaded")
+            if len(evaluated_args) != 2 or not isinstance(evaluated_args[1], str):
+                raise ValueError("ocl.get_ocl2dra.load_texture_async expects (context: pointer, path: string)")
+            ctx, path = evaluated_args
+            texture = self.ocl2dri_lib.ocl2dri_load_texture_async(ctx, path.encode('utf-8'))
+            if texture < 0:
+                raise ValueError(f"Failed to queue texture '{path}'")
+            return texture
+        elif func_name == 'ocl.get_ocl2dra.texture_status':
+            if not self.ocl2dri_lib:
+                raise ValueError("OCL2DRI library not loaded")
+            if len(evaluated_args) != 2 or not isinstance(evaluated_args[1], int):
+                raise ValueError("ocl.get_ocl2dra.texture_status expects (context: pointer, texture: int)")
+            return self.ocl2dri_lib.ocl2dri_texture_status(*evaluated_args)
+        elif func_name == 'ocl.get_ocl2dra.texture_progress':
+            if not self.ocl2dri_lib:
+                raise ValueError("OCL2DRI library not loaded")
+            if len(evaluated_args) != 1:
+                raise ValueError("ocl.get_ocl2dra.texture_progress expects (context: pointer)")
+            return self.ocl2dri_lib.ocl2dri_texture_progress(evaluated_args[0])
+        elif func_name == 'ocl.get_ocl2dra.set_upload_budget':
+            if not self.ocl2dri_lib:
+                raise ValueError("OCL2DRI library not loaded")
+            if len(evaluated_args) != 2 or not isinstance(evaluated_args[1], (int, float)):
+                raise ValueError("ocl.get_ocl2dra.set_upload_budget expects (context: pointer, milliseconds: int/float)")
+            self.ocl2dri_lib.ocl2dri_set_upload_budget(evaluated_args[0], float(evaluated_args[1]))
+            return None
+        elif func_name == 'ocl.get_ocl2dra.draw_texture':
+            if not self.ocl2dri_lib:
+                raise ValueError("OCL2DRI library not loaded")
+            if len(evaluated_args) not in (4, 6) or not isinstance(evaluated_args[1], int) \
+                    or not all(isinstance(arg, (int, float)) for arg in evaluated_args[2:]):
+                raise ValueError("ocl.get_ocl2dra.draw_texture expects (context: pointer, texture: int, x, y[, w, h])")
+            ctx, texture, *rect = evaluated_args
+            w, h = rect[2:] if len(rect) == 4 else (0, 0)
+            self.ocl2dri_lib.ocl2dri_draw_texture(ctx, texture, float(rect[0]), float(rect[1]), float(w), float(h))
+            return None
+        elif func_name == 'ocl.get_ocl2dra.layer_create':
+            if not self.ocl2dri_lib:
+                raise ValueError("OCL2DRI library not loaded")
+            if len(evaluated_args) != 3 or not isinstance(evaluated_args[1], str) or not isinstance(evaluated_args[2], int):
+                raise ValueError("ocl.get_ocl2dra.layer_create expects (context: pointer, name: string, z: int)")
+            ctx, name, z = evaluated_args
+            layer = self.ocl2dri_lib.ocl2dri_layer_create(ctx, name.encode('utf-8'), z)
+            if layer < 0:
+                raise ValueError(f"Failed to create layer '{name}'")
+            return layer
+        elif func_name == 'ocl.get_ocl2dra.layer_begin':
+            if not self.ocl2dri_lib:
+                raise ValueError("OCL2DRI library not loaded")
+            if len(evaluated_args) != 2 or not isinstance(evaluated_args[1], int):
+                raise ValueError("ocl.get_ocl2dra.layer_begin expects (context: pointer, layer: int)")
+            self.ocl2dri_lib.ocl2dri_layer_begin(*evaluated_args)
+            return None
+        elif func_name == 'ocl.get_ocl2dra.layer_end':
+            if not self.ocl2dri_lib:
+                raise ValueError("OCL2DRI library not loaded")
+            if len(evaluated_args) != 1:
+                raise ValueError("ocl.get_ocl2dra.layer_end expects (context: pointer)")
+            self.ocl2dri_lib.ocl2dri_layer_end(evaluated_args[0])
+            return None
+        elif func_name == 'ocl.get_ocl2dra.layer_set_visible':
+            if not self.ocl2dri_lib:
+                raise ValueError("OCL2DRI library not loaded")
+            if len(evaluated_args) != 3 or not isinstance(evaluated_args[1], int) or not isinstance(evaluated_args[2], (int, bool)):
+                raise ValueError("ocl.get_ocl2dra.layer_set_visible expects (context: pointer, layer: int, visible: bool/int)")
+            ctx, layer, visible = evaluated_args
+            self.ocl2dri_lib.ocl2dri_layer_set_visible(ctx, layer, bool(visible))
+            return None
+        elif func_name == 'ocl.get_ocl2dra.layer_redraws':
+            if not self.ocl2dri_lib:
+                raise ValueError("OCL2DRI library not loaded")
+            if len(evaluated_args) != 2 or not isinstance(evaluated_args[1], int):
+                raise ValueError("ocl.get_ocl2dra.layer_redraws expects (context: pointer, layer: int)")
+            return self.ocl2dri_lib.ocl2dri_layer_redraws(*evaluated_args)
+        elif func_name == 'ocl.get_ocl2dra.set_depth':
+            if not self.ocl2dri_lib:
+                raise ValueError("OCL2DRI library not loaded")
+            if len(evaluated_args) != 2 or not isinstance(evaluated_args[1], int):
+                raise ValueError("ocl.get_ocl2dra.set_depth expects (context: pointer, depth: int)")
+            self.ocl2dri_lib.ocl2dri_set_depth(*evaluated_args)
+            return None
+        elif func_name == 'ocl.get_ocl2dra.set_state_sorting':
+            if not self.ocl2dri_lib:
+                raise ValueError("OCL2DRI library not loaded")
+            if len(evaluated_args) != 2 or not isinstance(evaluated_args[1], (int, bool)):
+                raise ValueError("ocl.get_ocl2dra.set_state_sorting expects (context: pointer, enabled: bool/int)")
+            self.ocl2dri_lib.ocl2dri_set_state_sorting(evaluated_args[0], bool(evaluated_args[1]))
+            return None
+        elif func_name == 'ocl.get_ocl2dra.set_camera':
+            if not self.ocl2dri_lib:
+                raise ValueError("OCL2DRI library not loaded")
+            if len(evaluated_args) not in (3, 4) or not all(isinstance(arg, (int, float)) for arg in evaluated_args[1:]):
+                raise ValueError("ocl.get_ocl2dra.set_camera expects (context: pointer, x: int/float, y: int/float[, zoom: int/float])")
+            ctx, x, y, *zoom = evaluated_args
+            self.ocl2dri_lib.ocl2dri_set_camera(ctx, float(x), float(y), float(zoom[0]) if zoom else 1.0)
+            return None
+        elif func_name == 'ocl.get_ocl2dra.get_draw_stats':
+            if not self.ocl2dri_lib:
+                raise ValueError("OCL2DRI library not loaded")
+            if len(evaluated_args) != 1:
+                raise ValueError("ocl.get_ocl2dra.get_draw_stats expects (context: pointer)")
+            stats = self.draw_stats_type()
+            if not self.ocl2dri_lib.ocl2dri_get_draw_stats(evaluated_args[0], stats):
+                return None
+            return {name: getattr(stats, name) for name, _ in stats._fields_}
+        elif func_name == 'ocl.get_ocl2dra.tilemap_create':
+            if not self.ocl2dri_lib:
+                raise ValueError("OCL2DRI library not loaded")
+            if len(evaluated_args) != 5 or not all(isinstance(arg, (int, float)) for arg in evaluated_args[1:]):
+                raise ValueError("ocl.get_ocl2dra.tilemap_create expects (context: pointer, width: int, height: int, tile_w: int/float, tile_h: int/float)")
+            ctx, width, height, tile_w, tile_h = evaluated_args
+            tilemap = self.ocl2dri_lib.ocl2dri_tilemap_create(ctx, int(width), int(height), float(tile_w), float(tile_h))
+            if not tilemap:
+                raise ValueError("Failed to create tilemap")
+            return tilemap
+        elif func_name == 'ocl.get_ocl2dra.tilemap_set_color':
+            if not self.ocl2dri_lib:
+                raise ValueError("OCL2DRI library not loaded")
+            if len(evaluated_args) not in (5, 6) or not all(isinstance(arg, (int, float)) for arg in evaluated_args[1:]):
+                raise ValueError("ocl.get_ocl2dra.tilemap_set_color expects (tilemap: pointer, tile: int, r: int/float, g: int/float, b: int/float[, a: int/float])")
+            tilemap, tile, r, g, b = evaluated_args[:5]
+            a = evaluated_args[5] if len(evaluated_args) == 6 else 255
+            self.ocl2dri_lib.ocl2dri_tilemap_set_color(tilemap, int(tile), int(r), int(g), int(b), int(a))
+            return None
+        elif func_name == 'ocl.get_ocl2dra.tilemap_set_tile':
+            if not self.ocl2dri_lib:
+                raise ValueError("OCL2DRI library not loaded")
+            if len(evaluated_args) != 4 or not all(isinstance(arg, int) for arg in evaluated_args[1:]):
+                raise ValueError("ocl.get_ocl2dra.tilemap_set_tile expects (tilemap: pointer, x: int, y: int, tile: int)")
+            self.ocl2dri_lib.ocl2dri_tilemap_set_tile(*evaluated_args)
+            return None
+        elif func_name == 'ocl.get_ocl2dra.tilemap_get_tile':
+            if not self.ocl2dri_lib:
+                raise ValueError("OCL2DRI library not loaded")
+            if len(evaluated_args) != 3 or not all(isinstance(arg, int) for arg in evaluated_args[1:]):
+                raise ValueError("ocl.get_ocl2dra.tilemap_get_tile expects (tilemap: pointer, x: int, y: int)")
+            return self.ocl2dri_lib.ocl2dri_tilemap_get_tile(*evaluated_args)
+        elif func_name == 'ocl.get_ocl2dra.tilemap_set_tiles':
+            if not self.ocl2dri_lib:
+                raise ValueError("OCL2DRI library not loaded")
+            if (len(evaluated_args) != 6 or not all(isinstance(arg, int) for arg in evaluated_args[1:5])
+                    or not isinstance(evaluated_args[5], OclArray) or evaluated_args[5].elem_type != 'int'
+                    or len(evaluated_args[5]) != evaluated_args[3] * evaluated_args[4]):
+                raise ValueError("ocl.get_ocl2dra.tilemap_set_tiles expects (tilemap: pointer, x: int, y: int, w: int, h: int, tiles: int array of w * h ids)")
+            tilemap, x, y, w, h, tiles = evaluated_args
+            if len(tiles):
+                import ctypes
+                buffer = (ctypes.c_int * len(tiles)).from_buffer(tiles.data)
+                self.ocl2dri_lib.ocl2dri_tilemap_set_tiles(tilemap, x, y, w, h, buffer)
+            return None
+        elif func_name == 'ocl.get_ocl2dra.tilemap_fill':
+            if not self.ocl2dri_lib:
+                raise ValueError("OCL2DRI library not loaded")
+            if len(evaluated_args) != 6 or not all(isinstance(arg, int) for arg in evaluated_args[1:]):
+                raise ValueError("ocl.get_ocl2dra.tilemap_fill expects (tilemap: pointer, x: int, y: int, w: int, h: int, tile: int)")
+            self.ocl2dri_lib.ocl2dri_tilemap_fill(*evaluated_args)
+            return None
+        elif func_name == 'ocl.get_ocl2dra.tilemap_draw':
+            if not self.ocl2dri_lib:
+                raise ValueError("OCL2DRI library not loaded")
+            if len(evaluated_args) != 4 or not all(isinstance(arg, (int, float)) for arg in evaluated_args[2:]):
+                raise ValueError("ocl.get_ocl2dra.tilemap_draw expects (context: pointer, tilemap: pointer, scroll_x: int/float, scroll_y: int/float)")
+            ctx, tilemap, scroll_x, scroll_y = evaluated_args
+            self.ocl2dri_lib.ocl2dri_tilemap_draw(ctx, tilemap, float(scroll_x), float(scroll_y))
+            return None
+        elif func_name == 'ocl.get_ocl2dra.tilemap_destroy':
+            if not self.ocl2dri_lib:
+                raise ValueError("OCL2DRI library not loaded")
+            if len(evaluated_args) != 1:
+                raise ValueError("ocl.get_ocl2dra.tilemap_destroy expects (tilemap: pointer)")
+            self.ocl2dri_lib.ocl2dri_tilemap_destroy(evaluated_args[0])
+            return None
+        elif func_name in ('ocl.get_ocl2dra.fill_rect', 'ocl.get_ocl2dra.draw_rect', 'ocl.get_ocl2dra.draw_line'):
+            if not self.ocl2dri_lib:
+                raise ValueError("OCL2DRI library not loaded")
+            if len(evaluated_args) != 5 or not all(isinstance(arg, (int, float)) for arg in evaluated_args[1:]):
+                raise ValueError(f"{func_name} expects (context: pointer, four int/float coordinates)")
+            ctx, a, b, c, d = evaluated_args
+            native = getattr(self.ocl2dri_lib, 'ocl2dri_' + func_name.rsplit('.', 1)[1])
+            native(ctx, float(a), float(b), float(c), float(d))
+            return None
+        elif func_name in self.functions:
+            params, body = self.functions[func_name]
+            if len(params) != len(evaluated_args):
+                raise ValueError(f"Function '{func_name}' expects {len(params)} arguments, got {len(evaluated_args)}")
+            checks = self.param_checks.get(func_name)
+            if checks:
+                self.check_arguments(func_name, checks, evaluated_args)
+            return self.invoke(body, [param for param, _ in params], evaluated_args)
+        elif func_name in ('wait', 'wait_frames'):
+            if self.scheduler.current is None:
+                raise ValueError(f"{func_name}() can only be called inside a spawned task")
+            if func_name == 'wait':
+                if len(evaluated_args) != 1 or not isinstance(evaluated_args[0], (int, float)) or isinstance(evaluated_args[0], bool):
+                    raise ValueError("wait expects (seconds: int/float)")
+                self.scheduler.wait(evaluated_args[0])
+            else:
+                if len(evaluated_args) != 1 or not isinstance(evaluated_args[0], int) or isinstance(evaluated_args[0], bool):
+                    raise ValueError("wait_frames expects (frames: int)")
+                self.scheduler.wait_frames(evaluated_args[0])
+            return None
+        else:
+            raise ValueError(f"Undefined function: '{func_name}'")
+
+    def compile_class(self, class_name, methods):
+        fields = {}
+        for method in methods:
+            for statement in method.body:
+                self.collect_self_fields(statement, fields)
+        compiled = {method.name: CompiledMethod(method.name, method.params, method.body, self.specializer)
+                    for method in methods}
+        return ClassShape(class_name, fields, compiled)
+
+    def collect_self_fields(self, node, fields):
+        if node.kind == ATTRIBUTE and node.base.kind == IDENTIFIER and node.base.name == 'self' and node.attr not in fields:
+            fields[node.attr] = len(fields)
+        for child in node.children():
+            self.collect_self_fields(child, fields)
+
+    def bind_call_site(self, site, shape, method_name, arg_count):
+        method = shape.methods.get(method_name)
+        if method is None:
+            raise ValueError(f"Method '{method_name}' not found in class '{shape.name}'")
+        if method.arity != arg_count:
+            raise ValueError(f"Method '{method_name}' expects {method.arity} arguments, got {arg_count}")
+        site.shape = shape
+        site.target = method
+        return method
+
+    def invoke(self, body, param_names, evaluated_args, self_obj=None):
+        local_vars = dict(zip(param_names, evaluated_args))
+        if self_obj is not None:
+            local_vars['self'] = self_obj
+        old_vars = self.variables
+        self.variables = {**old_vars, **local_vars}
         try:
-            def replace_var(match):
-                var_name = match.group(1)
-                if var_name in self.variables:
-                    value = self.variables[var_name]
-                    return str(value) if value is not None else "null"
-                else:
-                    raise NameError(f"Undefined variable in string interpolation: '{var_name}'")
-            return re.sub(r'\{([a-zA-Z_][a-zA-Z0-9_]*)\}', replace_var, string)
-        except Exception as e:
-            self.log_error(f"String interpolation error: {str(e)}")
-            return string  # Return original string on error
+            completion = self.execute_block(body)
+            if completion is RETURN:
+                return self.return_value
+            if completion is None and body and body[-1].kind in (CALL, CALL_METHOD):
+                return self.call_value  # Without a return, a body ending in a call gives its value
+            return None
+        finally:
+            self.variables = old_vars
 
-    def resolve(self, name):
+    def get_member(self, value, attr):
+        if isinstance(value, OclObject):
+            if attr == '__class__':
+                return value.shape.name
+            result = value.get_field(attr)
+            if result is _UNSET:
+                raise ValueError(f"Attribute '{attr}' not found on object")
+        elif isinstance(value, dict):
+            if attr not in value:
+                raise ValueError(f"Attribute '{attr}' not found on object")
+            result = value[attr]
+        elif isinstance(value, tuple) and attr.isdigit():
+            idx = int(attr)
+            if not 0 <= idx < len(value):
+                raise ValueError(f"Index '{idx}' out of range for tuple")
+            result = value[idx]
+        else:
+            raise ValueError(f"Cannot access attribute '{attr}' on non-object or non-tuple")
+        if result is None:
+            raise ValueError(f"Attribute '{attr}' has null value")
+        return result
+
+    def attribute_owner(self, base_expr):
+        if base_expr.kind == IDENTIFIER:
+            obj = self.variables.get(base_expr.name)
+            if not isinstance(obj, (OclObject, dict)):
+                raise ValueError(f"Cannot assign to attribute on non-object '{base_expr.name}'")
+            return obj
+        if base_expr.kind != ATTRIBUTE:
+            raise ValueError("Attribute assignment target must be an identifier path")
+        owner = self.attribute_owner(base_expr.base)
+        attr = base_expr.attr
+        value = owner.get_field(attr) if isinstance(owner, OclObject) else owner.get(attr, _UNSET)
+        if value is _UNSET:
+            value = {}
+            if isinstance(owner, OclObject):
+                owner.set_field(attr, value)
+            else:
+                owner[attr] = value
+        if not isinstance(value, (OclObject, dict)):
+            raise ValueError(f"Cannot assign to attribute on non-object '{attr}'")
+        return value
+
+    def assign_attribute(self, node, value):
+        attr = node.attr
+        owner = self.attribute_owner(node.base)
+        if type(owner) is OclObject:
+            if node.shape is owner.shape:
+                owner.slots[node.target] = value
+            else:
+                owner.set_field(attr, value)
+                node.shape = owner.shape
+                node.target = owner.shape.fields[attr]
+        else:
+            owner[attr] = value
+
+    def assign_index(self, target, value):
+        base = self.evaluate(target.base)
+        index = self.evaluate(target.index)
+        if not isinstance(base, OclArray):
+            raise ValueError(f"Cannot assign by index to non-array value: {base}")
+        if not isinstance(index, int) or not 0 <= index < len(base):
+            raise ValueError(f"Array index {index} out of range for array of length {len(base)}")
         try:
-            parts = name.split('.')
-            value = self.variables.get(parts[0])
-            if value is None:
-                raise ValueError(f"Undefined variable: '{parts[0]}'")
-            for part in parts[1:]:
-                if isinstance(value, dict):
-                    if part not in value:
-                        raise ValueError(f"Attribute '{part}' not found on object")
-                    value = value.get(part)
-                elif isinstance(value, tuple) and part.isdigit():
-                    idx = int(part)
-                    if 0 <= idx < len(value):
-                        value = value[idx]
-                    else:
-                        raise ValueError(f"Index '{idx}' out of range for tuple")
+            base.data[index] = value
+        except TypeError:
+            raise ValueError(f"Cannot store {value} in an array of type '{base.elem_type}'")
+
+    def call_array_method(self, arr, method_name, evaluated_args):
+        if method_name not in OclArray.methods:
+            raise ValueError(f"Unknown array method '{method_name}'")
+        expected_args = OclArray.methods[method_name]
+        if expected_args != len(evaluated_args):
+            raise ValueError(f"Array method '{method_name}' expects {expected_args} arguments, got {len(evaluated_args)}")
+        return getattr(arr, method_name)(*evaluated_args)
+
+    def call_builder_method(self, builder, method_name, evaluated_args):
+        if method_name not in OclStringBuilder.methods:
+            raise ValueError(f"Unknown string builder method '{method_name}'")
+        expected_args = OclStringBuilder.methods[method_name]
+        if expected_args != len(evaluated_args):
+            raise ValueError(f"String builder method '{method_name}' expects {expected_args} arguments, got {len(evaluated_args)}")
+        return getattr(builder, method_name)(*evaluated_args)
+
+    def call_task_method(self, task, method_name, evaluated_args):
+        if method_name not in ('done', 'cancel'):
+            raise ValueError(f"Task has no method '{method_name}' (expected done or cancel)")
+        if evaluated_args:
+            raise ValueError(f"Task method '{method_name}' expects 0 arguments, got {len(evaluated_args)}")
+        if method_name == 'done':
+            return task.done
+        self.scheduler.cancel(task)
+        return None
+
+    def interpolate_string(self, string):
+        def replace_var(match):
+            var_name = match.group(1)
+            if var_name in self.variables:
+                value = self.variables[var_name]
+                return str(value) if value is not None else "null"
+            else:
+                raise NameError(f"Undefined variable in string interpolation: '{var_name}'")
+        return re.sub(r'\{([a-zA-Z_][a-zA-Z0-9_]*)\}', replace_var, string)
+
+    def resolve(self, name):
+        parts = name.split('.')
+        value = self.variables.get(parts[0])
+        if value is None:
+            raise ValueError(f"Undefined variable: '{parts[0]}'")
+        for part in parts[1:]:
+            if isinstance(value, OclObject):
+                value = value.shape.name if part == '__class__' else value.get_field(part)
+                if value is _UNSET:
+                    raise ValueError(f"Attribute '{part}' not found on object")
+            elif isinstance(value, dict):
+                if part not in value:
+                    raise ValueError(f"Attribute '{part}' not found on object")
+                value = value.get(part)
+            elif isinstance(value, tuple) and part.isdigit():
+                idx = int(part)
+                if 0 <= idx < len(value):
+                    value = value[idx]
                 else:
-                    raise ValueError(f"Cannot access attribute '{part}' on non-object or non-tuple")
-                if value is None and part != '__class__':
-                    raise ValueError(f"Attribute '{part}' has null value")
-            return value
-        except Exception as e:
-            self.log_error(f"Error resolving '{name}': {str(e)}")
-            return None  # Return None on error
+                    raise ValueError(f"Index '{idx}' out of range for tuple")
+            else:
+                raise ValueError(f"Cannot access attribute '{part}' on non-object or non-tuple")
+            if value is None and part != '__class__':
+                raise ValueError(f"Attribute '{part}' has null value")
+        return value
 
     def apply_op(self, left, op, right):
+        if op in ('==', '!='):
+            if op == '==':
+                return left is right
+            elif op == '!=':
+                return left is not right
+        if left is None or right is None:
+            raise ValueError(f"Cannot perform operation '{op}' with null value")
         try:
-            if op in ('==', '!='):
-                if op == '==':
-                    return left is right
-                elif op == '!=':
-                    return left is not right
-            if left is None or right is None:
-                raise ValueError(f"Cannot perform operation '{op}' with null value")
             if op == '+':
                 if isinstance(left, int) and isinstance(right, int):
                     return left + right
@@ -681,8 +2068,4 @@ class Interpreter:
             else:
                 raise ValueError(f"Unsupported operator: '{op}'")
         except TypeError:
-            self.log_error(f"Type error in operation '{op}' with values {left} ({type(left).__name__}) and {right} ({type(right).__name__})")
-            return None
-        except Exception as e:
-            self.log_error(f"Operator '{op}' error with {left} and {right}: {str(e)}")
-            return None
\ No newline at end of file
+            raise TypeError(f"Type error in operation '{op}' with values {left} ({type(left).__name__}) and {right} ({type(right).__name__})") from None
\ No newline at end of file
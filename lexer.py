@@ -1,7 +1,15 @@
 #lexer.py
 import re
 
+class LexerError(SyntaxError):
+    """Invalid input in the token stream. Unlike parse errors, these end parsing."""
+
 class Lexer:
+    chunk_size = 65536
+    # Characters kept buffered past the current position when reading a file,
+    # so tokens are not split at a chunk boundary.
+    lookahead = 1024
+
     def __init__(self):
         self.tokens = []
         self.token_patterns = [
@@ -14,11 +22,15 @@ class Lexer:
             ('elif', r'\belif\b'),
             ('else', r'\belse\b'),
             ('while', r'\bwhile\b'),
+            ('for', r'\bfor\b'),
+            ('in', r'\bin\b'),
             ('define', r'\bdefine\b'),
             ('return', r'\breturn\b'),
             ('class', r'\bclass\b'),
             ('break', r'\bbreak\b'),
             ('continue', r'\bcontinue\b'),
+            ('spawn', r'\bspawn\b'),
+            ('yield', r'\byield\b'),
             ('true', r'\btrue\b'),
             ('false', r'\bfalse\b'),
             ('null', r'\bnull\b'),
@@ -44,38 +56,70 @@ class Lexer:
             ('left_bracket', r'\['),
             ('right_bracket', r'\]'),
         ]
+        keywords = (
+            'let', 'print', 'if', 'elif', 'else', 'while', 'for', 'in', 'define', 'return',
+            'class', 'break', 'continue', 'spawn', 'yield', 'true', 'false', 'null',
+            'int', 'float', 'bool', 'string', 'ocl'
+        )
+        self.compiled_patterns = [
+            (token_type, re.compile(pattern, re.IGNORECASE if token_type in keywords else 0))
+            for token_type, pattern in self.token_patterns
+        ]
 
     def tokenize(self, code):
-        self.tokens = []
+        self.tokens = list(self.iter_tokens(code))
+        return self.tokens
+
+    def iter_tokens(self, source):
+        """Yield tokens from a string, or from a text file read in chunks.
+
+        Only the unconsumed part of the current chunk is held in memory. A
+        token that touches the end of the buffer may continue in the next
+        chunk, so it is matched again once more input has been read.
+        """
+        read = None if isinstance(source, str) else source.read
+        buffer = source if read is None else ''
+        eof = read is None
         pos = 0
+        offset = 0  # position of buffer[0] within the whole source
         line = 1
         line_start = 0
+        patterns = self.compiled_patterns
         try:
-            while pos < len(code):
+            while True:
+                if not eof and len(buffer) - pos <= self.lookahead:
+                    chunk = read(self.chunk_size)
+                    offset += pos
+                    buffer = buffer[pos:] + chunk
+                    pos = 0
+                    eof = not chunk
+                if pos >= len(buffer):
+                    return
                 match = None
-                for token_type, pattern in self.token_patterns:
-                    flags = re.IGNORECASE if token_type in (
-                        'let', 'print', 'if', 'elif', 'else', 'while', 'define', 'return',
-                        'class', 'break', 'continue', 'true', 'false', 'null',
-                        'int', 'float', 'bool', 'string', 'ocl'
-                    ) else 0
-                    regex = re.compile(pattern, flags)
-                    match = regex.match(code, pos)
+                for token_type, regex in patterns:
+                    match = regex.match(buffer, pos)
                     if match:
-                        text = match.group(0)
-                        if token_type == 'newline':
-                            line += 1
-                            line_start = pos + 1
-                        elif token_type not in ('whitespace', 'comment'):
-                            column = pos - line_start + 1
-                            self.tokens.append((token_type, text, line, column))
-                        pos = match.end()
                         break
+                if not eof and (not match or match.end() == len(buffer)):
+                    chunk = read(self.chunk_size)
+                    offset += pos
+                    buffer = buffer[pos:] + chunk
+                    pos = 0
+                    eof = not chunk
+                    continue
                 if not match:
-                    column = pos - line_start + 1
-                    raise SyntaxError(f"Invalid token at line {line}, column {column}: '{code[pos:pos+10]}'")
-            return self.tokens
+                    column = offset + pos - line_start + 1
+                    raise LexerError(f"Invalid token at line {line}, column {column}: '{buffer[pos:pos+10]}'")
+                if token_type == 'newline':
+                    line += 1
+                    line_start = offset + pos + 1
+                elif token_type not in ('whitespace', 'comment'):
+                    column = offset + pos - line_start + 1
+                    yield (token_type, match.group(0), line, column)
+                pos = match.end()
         except re.error as e:
-            raise SyntaxError(f"Lexer regex error: {str(e)}")
+            raise LexerError(f"Lexer regex error: {str(e)}")
+        except LexerError:
+            raise
         except Exception as e:
-            raise SyntaxError(f"Lexer error: {str(e)}")
\ No newline at end of file
+            raise LexerError(f"Lexer error: {str(e)}")
@@ -1,33 +1,42 @@
 #main.py
+import time
+STARTUP_T0 = time.perf_counter()
 import sys
 import os
 import traceback
-import time
+import codecs
 from lexer import Lexer
 from parser import Parser
 from interpreter import Interpreter
+from ast_nodes import Node, Literal
 
 def execute_code(code, lexer, parser, interpreter, debug=False):
     try:
         interpreter.set_debug_mode(debug)
-        if not code or not code.strip():
-            interpreter.log_error("Empty code provided", stack_info=True)
-            return True
-            
-        tokens = lexer.tokenize(code)
-        if debug:
-            print("TOKENS:")
-            for i, token in enumerate(tokens, 1):
-                print(f"  {i}. {token}")
-        interpreter.increment_saucerful("Tokenization successful")  # Check 2
-            
-        ast = parser.parse(code)
-        if debug:
-            print("\nAST:")
-            print_ast(ast)
-        interpreter.increment_saucerful("Parsing successful")  # Check 3
-            
-        interpreter.interpret(ast)
+        if isinstance(code, str):
+            if not code or not code.strip():
+                interpreter.log_error("Empty code provided", stack_info=True)
+                return True
+
+            if debug:
+                print("TOKENS:")
+                for i, token in enumerate(lexer.tokenize(code), 1):
+                    print(f"  {i}. {token}")
+            interpreter.increment_saucerful("Tokenization successful")  # Check 2
+
+            ast = parser.parse(code)
+            if debug:
+                print("\nAST:")
+                print_ast(ast)
+            interpreter.increment_saucerful("Parsing successful")  # Check 3
+
+            interpreter.interpret(ast)
+        else:
+            # An open script file is lexed, parsed and run one top-level
+            # statement at a time, so memory stays flat as the file grows.
+            interpreter.interpret(parser.iter_statements(code))
+            interpreter.increment_saucerful("Tokenization successful")  # Check 2
+            interpreter.increment_saucerful("Parsing successful")  # Check 3
         interpreter.increment_saucerful("Interpretation successful")  # Check 4
         interpreter.increment_saucerful("Runtime stability confirmed")  # Check 5
         return True
@@ -53,20 +62,34 @@ def execute_code(code, lexer, parser, interpreter, debug=False):
             print(traceback.format_exc())
         return True
 
+def detect_encoding(filename):
+    """Return 'utf-8-sig', or 'latin-1' if the file is not valid UTF-8.
+    Decodes in chunks so the file is never held in memory whole."""
+    decoder = codecs.getincrementaldecoder('utf-8-sig')()
+    try:
+        with open(filename, "rb") as f:
+            for chunk in iter(lambda: f.read(65536), b""):
+                decoder.decode(chunk)
+            decoder.decode(b"", final=True)
+    except UnicodeDecodeError:
+        return "latin-1"
+    return "utf-8-sig"
+
 def print_ast(ast, indent=0):
     indent_str = "  " * indent
-    if isinstance(ast, list):
+    if isinstance(ast, (list, tuple)):
         for i, stmt in enumerate(ast, 1):
             print(f"{indent_str}[Statement {i}]")
             print_ast(stmt, indent + 1)
-    elif isinstance(ast, tuple):
-        print(f"{indent_str}{ast[0]}:")
-        for i in range(1, len(ast)):
-            if isinstance(ast[i], (list, tuple)) and ast[i] and not (isinstance(ast[i], tuple) and ast[i][0] == 'literal'):
-                print(f"{indent_str}  [Arg {i}]:")
-                print_ast(ast[i], indent + 2)
+    elif isinstance(ast, Node):
+        print(f"{indent_str}{type(ast).__name__} (line {ast.line}, column {ast.column}):")
+        for name in ast.fields:
+            value = getattr(ast, name)
+            if isinstance(value, (list, tuple, Node)) and value and not isinstance(value, Literal):
+                print(f"{indent_str}  [{name}]:")
+                print_ast(value, indent + 2)
             else:
-                print(f"{indent_str}  [Arg {i}]: {ast[i]}")
+                print(f"{indent_str}  [{name}]: {value}")
     else:
         print(f"{indent_str}{ast}")
 
@@ -76,6 +99,14 @@ def print_help():
     print("\nOptions:")
     print("  --help      Display this help message and exit")
     print("  --debug     Run in debug mode with detailed output and stack traces")
+    print("  --benchmark-startup  Print start-up timings after the script finishes")
+    print("  --check-server       Syntax-check buffers from stdin for the editor (see diagnostics.py)")
+    print("  --hot-reload         Reload functions and classes from the script file each frame it changes")
+    print("  --record-input FILE  Record per-frame OCL2DRI input and delta time to FILE")
+    print("  --replay-input FILE  Feed a recording back through the OCL2DRI input functions")
+    print("  --fixed-dt SECONDS   With --replay-input, report this delta time every frame")
+    print("  --headless           Run OCL2DRI without a visible window or frame pacing")
+    print("  --frame-stats FILE   Write per-frame timings as CSV when the script destroys its window")
     print("  run editor  Launch the OCL Editor GUI")
     print("\nArguments:")
     print("  filename    Path to the OCL script file to execute")
@@ -86,6 +117,8 @@ def print_help():
     print("\nExamples:")
     print("  python main.py script.ocl          # Execute an OCL file")
     print("  python main.py --debug script.ocl  # Execute with debug output")
+    print("  python main.py --hot-reload game.ocl  # Edit game.ocl while it runs")
+    print("  python main.py --replay-input run.ocli --headless game.ocl  # Repeat a recorded session")
     print("  python main.py run editor          # Launch OCL Editor")
     print("  python main.py                     # Start interactive mode")
     print("\nSaucerful Rate: Starts at 0, aims for 4+, can exceed 4 with extra checks")
@@ -114,6 +147,36 @@ def main():
         print_help()
         sys.exit(0)
 
+    if '--check-server' in sys.argv:
+        # Editor diagnostics: syntax-check buffers sent over stdin, nothing is run
+        from diagnostics import serve
+        serve()
+        sys.exit(0)
+
+    benchmark_startup = '--benchmark-startup' in sys.argv
+    if benchmark_startup:
+        sys.argv.remove('--benchmark-startup')
+    imports_ms = (time.perf_counter() - STARTUP_T0) * 1000
+    hot_reload = '--hot-reload' in sys.argv
+    if hot_reload:
+        sys.argv.remove('--hot-reload')
+    # Record/replay lives in the OCL2DRI library, which reads these at ocl2dri_init
+    for flag, env_name in (('--record-input', 'OCL2DRI_RECORD'), ('--replay-input', 'OCL2DRI_REPLAY'), ('--fixed-dt', 'OCL2DRI_FIXED_DT'),
+                              ('--frame-stats', 'OCL2DRI_FRAME_STATS')):
+        if flag in sys.argv:
+            index = sys.argv.index(flag)
+            if index + 1 >= len(sys.argv):
+                print(f"{flag} expects a value")
+                sys.exit(1)
+            os.environ[env_name] = sys.argv[index + 1]
+            del sys.argv[index:index + 2]
+    if os.environ.get('OCL2DRI_REPLAY') and not os.path.exists(os.environ['OCL2DRI_REPLAY']):
+        print(f"Error: input recording '{os.environ['OCL2DRI_REPLAY']}' not found")
+        sys.exit(1)
+    if '--headless' in sys.argv:
+        sys.argv.remove('--headless')
+        os.environ['OCL2DRI_HEADLESS'] = '1'
+
     lexer = Lexer()
     parser = Parser(lexer)
     
@@ -127,6 +190,7 @@ def main():
     try:
         interpreter = Interpreter()
         interpreter.increment_saucerful("Interpreter initialized")  # Check 0
+        init_ms = (time.perf_counter() - STARTUP_T0) * 1000
         print("Hello, World! Welcome User you're using OCL2DRI - Own Custom Language 2D Rendering library.")
         print(f"Saucerful  {interpreter.get_saucerful_rate()}/∞ (4 is baseline)")
     except Exception as e:
@@ -141,23 +205,24 @@ def main():
                 print(f"Saucerful  {interpreter.get_saucerful_rate()}/∞ (4 is baseline)")
                 sys.exit(1)
                 
-            with open(filename, "r", encoding="utf-8-sig") as f:
-                code = f.read()
-            interpreter.increment_saucerful("File loaded successfully")  # Check 1
+            encoding = detect_encoding(filename)
+            if debug_mode:
+                # Debug output lists every token and the whole AST, so read it all.
+                with open(filename, "r", encoding=encoding) as f:
+                    code = f.read()
+            else:
+                code = open(filename, "r", encoding=encoding)
+            if hot_reload:
+                interpreter.enable_hot_reload(filename)
+            if encoding == "utf-8-sig":
+                interpreter.increment_saucerful("File loaded successfully")  # Check 1
+            else:
+                interpreter.increment_saucerful("File loaded with fallback encoding")
                 
         except PermissionError:
             interpreter.log_error(f"No permission to read file '{filename}'", stack_info=debug_mode)
             print(f"Saucerful  {interpreter.get_saucerful_rate()}/∞ (4 is baseline)")
             sys.exit(1)
-        except UnicodeDecodeError:
-            try:
-                with open(filename, "r", encoding="latin-1") as f:
-                    code = f.read()
-                interpreter.increment_saucerful("File loaded with fallback encoding")
-            except Exception:
-                interpreter.log_error(f"Unable to decode file '{filename}'. Check encoding.", stack_info=debug_mode)
-                print(f"Saucerful  {interpreter.get_saucerful_rate()}/∞ (4 is baseline)")
-                sys.exit(1)
         except Exception as e:
             interpreter.log_error(f"Error reading file '{filename}': {str(e)}", stack_info=debug_mode)
             if debug_mode:
@@ -166,6 +231,13 @@ def main():
             sys.exit(1)
 
         success = execute_code(code, lexer, parser, interpreter, debug_mode)
+        if not isinstance(code, str):
+            code.close()
+        if benchmark_startup:
+            print("Startup benchmark (ms, cumulative from main.py import):")
+            print(f"  imports              {imports_ms:8.2f}")
+            print(f"  interpreter init     {init_ms:8.2f}")
+            print(f"  script finished      {(time.perf_counter() - STARTUP_T0) * 1000:8.2f}")
         if not success:
             print("Execution failed. Use --debug for detailed diagnostics.")
             sys.exit(1)
@@ -1,28 +1,40 @@
 #parser.py
-from lexer import Lexer
+from lexer import Lexer, LexerError
+from ast_nodes import (
+    Literal, Identifier, Binary, Index, Attribute, CallMethod, Call, Declare, Assign,
+    AugAssign, Print, If, While, ForRange, ForEach, Define, ClassDef, Return, Break, Continue,
+    Spawn, Yield, CALL, CALL_METHOD
+)
 
 class Parser:
     def __init__(self, lexer):
         self.lexer = lexer
-        self.tokens = []
+        self.tokens = iter(())
         self.current_token = None
-        self.current_pos = 0
+        # Called with each recovered SyntaxError instead of printing it (used by the editor's checker)
+        self.on_error = None
 
     def parse(self, code):
+        return list(self.iter_statements(code))
+
+    def iter_statements(self, source):
+        """Yield top-level statements from a string or an open text file as
+        soon as each is parsed. Tokens are pulled from the lexer one at a time,
+        so the token list and the full AST are never held at once."""
         try:
-            self.tokens = self.lexer.tokenize(code)
-            self.current_pos = 0
+            self.tokens = self.lexer.iter_tokens(source)
             self.advance()
-            return self.program()
+            yield from self.program()
         except SyntaxError as e:
             raise SyntaxError(f"Parsing failed: {str(e)}")
 
     def advance(self):
-        if self.current_pos < len(self.tokens):
-            self.current_token = self.tokens[self.current_pos]
-            self.current_pos += 1
-        else:
-            self.current_token = None
+        self.current_token = next(self.tokens, None)
+
+    def position(self):
+        if self.current_token:
+            return self.current_token[2], self.current_token[3]
+        return None, None
 
     def eat(self, token_type):
         if self.current_token and self.current_token[0] == token_type:
@@ -43,6 +55,8 @@ class Parser:
             return "Did you forget a colon after the 'if' condition?"
         elif token_type == 'while':
             return "Did you forget a colon after the 'while' condition?"
+        elif token_type == 'for':
+            return "Expected 'for name in range(...):' or 'for name in array:'"
         elif token_type == 'define':
             return "Did you forget parentheses or a colon in the function definition?"
         elif token_type == 'class':
@@ -50,23 +64,28 @@ class Parser:
         return ""
 
     def program(self):
-        statements = []
         while self.current_token is not None:
             try:
                 stmt = self.statement()
-                statements.append(stmt)
                 if self.current_token and self.current_token[0] == 'semicolon':
                     self.eat('semicolon')
+            except LexerError:
+                raise
             except SyntaxError as e:
-                print(f"Syntax Error: {str(e)}")
+                if self.on_error:
+                    self.on_error(e)
+                else:
+                    print(f"Syntax Error: {str(e)}")
                 self.recover()
-        return statements
+                continue
+            yield stmt
 
     def recover(self):
         while self.current_token and self.current_token[0] not in ('semicolon', 'right_brace'):
             self.advance()
-        if self.current_token and self.current_token[0] == 'semicolon':
-            self.eat('semicolon')
+        # Consume the stopping token too, or a stray '}' would be retried forever
+        if self.current_token and self.current_token[0] in ('semicolon', 'right_brace'):
+            self.advance()
 
     def statement(self):
         token_type = self.current_token[0].lower() if self.current_token else None
@@ -78,6 +97,8 @@ class Parser:
             return self.if_statement()
         elif token_type == 'while':
             return self.while_statement()
+        elif token_type == 'for':
+            return self.for_statement()
         elif token_type == 'define':
             return self.function_definition()
         elif token_type == 'class':
@@ -85,15 +106,24 @@ class Parser:
         elif token_type == 'ocl':
             return self.ocl_statement()
         elif token_type == 'return':
+            line, column = self.position()
             self.advance()
             expr = self.expression() if self.current_token and self.current_token[0] != 'semicolon' else None
-            return ('return', expr)
+            return Return(expr, line, column)
         elif token_type == 'break':
+            line, column = self.position()
             self.advance()
-            return ('break',)
+            return Break(line, column)
         elif token_type == 'continue':
+            line, column = self.position()
+            self.advance()
+            return Continue(line, column)
+        elif token_type == 'spawn':
+            return self.spawn_expression()
+        elif token_type == 'yield':
+            line, column = self.position()
             self.advance()
-            return ('continue',)
+            return Yield(line, column)
         elif token_type == 'identifier':
             return self.assignment_or_call_statement()
         else:
@@ -102,6 +132,7 @@ class Parser:
             raise SyntaxError(f"Line {line}, column {column}: Unexpected token: {self.current_token[1] if self.current_token else 'EOF'}")
 
     def class_definition(self):
+        line, column = self.position()
         self.advance()
         if self.current_token[0] != 'identifier':
             raise SyntaxError(f"Line {self.current_token[2]}, column {self.current_token[3]}: Expected class name")
@@ -120,9 +151,10 @@ class Parser:
                 column = self.current_token[3]
                 raise SyntaxError(f"Line {line}, column {column}: Expected method definition in class")
         self.eat('right_brace')
-        return ('class', class_name, methods)
+        return ClassDef(class_name, methods, line, column)
 
     def ocl_statement(self):
+        line, column = self.position()
         self.eat('ocl')
         self.eat('dot')
         if self.current_token[1].lower() == 'classes':
@@ -135,16 +167,32 @@ class Parser:
             class_name = self.current_token[1][1:-1]
             self.advance()
             self.eat('right_paren')
-            return ('call', 'ocl.classes', [('literal', class_name)])
+            return Call('ocl.classes', [Literal(class_name, line, column)], line, column)
         elif self.current_token[1].lower() in (
-            'get_input', 'get_set_input', 'get_ocl2dra.init', 'get_ocl2dra.set_background',
-            'get_ocl2dra.set_title', 'get_ocl2dra.set_size', 'get_ocl2dra.set_position',
+            'get_input', 'get_set_input', 'array', 'string_builder', 'flush', 'get_ocl2dra.init',
+            'get_ocl2dra.set_background', 'get_ocl2dra.set_title', 'get_ocl2dra.set_size', 'get_ocl2dra.set_position',
             'get_ocl2dra.set_fullscreen', 'get_ocl2dra.set_opacity', 'get_ocl2dra.set_border',
             'get_ocl2dra.set_min_size', 'get_ocl2dra.set_max_size', 'get_ocl2dra.set_always_on_top',
             'get_ocl2dra.set_resizable', 'get_ocl2dra.set_frame_rate', 'get_ocl2dra.update',
             'get_ocl2dra.is_running', 'get_ocl2dra.destroy', 'get_ocl2dra.hide', 'get_ocl2dra.show',
             'get_ocl2dra.set_icon', 'get_ocl2dra.get_mouse_position', 'get_ocl2dra.get_mouse_button_state',
-            'get_ocl2dra.get_delta_time', 'get_ocl2dra.get_key_state'
+            'get_ocl2dra.get_delta_time', 'get_ocl2dra.get_key_state', 'get_ocl2dra.set_pipelined',
+            'get_ocl2dra.set_draw_color', 'get_ocl2dra.fill_rect', 'get_ocl2dra.draw_rect',
+            'get_ocl2dra.draw_line', 'get_ocl2dra.fill_rects', 'get_ocl2dra.get_frame_stats',
+            'get_ocl2dra.export_frame_stats', 'get_ocl2dra.set_stats_overlay', 'get_ocl2dra.tilemap_create',
+            'get_ocl2dra.tilemap_set_color', 'get_ocl2dra.tilemap_set_tile', 'get_ocl2dra.tilemap_get_tile',
+            'get_ocl2dra.tilemap_set_tiles', 'get_ocl2dra.tilemap_fill', 'get_ocl2dra.tilemap_draw',
+            'get_ocl2dra.tilemap_destroy', 'get_ocl2dra.load_font', 'get_ocl2dra.draw_text',
+            'get_ocl2dra.emitter_create', 'get_ocl2dra.emitter_set_position', 'get_ocl2dra.emitter_set_rate',
+            'get_ocl2dra.emitter_set_velocity', 'get_ocl2dra.emitter_set_life', 'get_ocl2dra.emitter_set_gravity',
+            'get_ocl2dra.emitter_set_size', 'get_ocl2dra.emitter_set_colors', 'get_ocl2dra.emitter_burst',
+            'get_ocl2dra.emitter_count', 'get_ocl2dra.emitter_destroy', 'get_ocl2dra.spatial_create',
+            'get_ocl2dra.spatial_update', 'get_ocl2dra.spatial_query_pairs', 'get_ocl2dra.spatial_query_rect',
+            'get_ocl2dra.spatial_query_point', 'get_ocl2dra.spatial_destroy',
+            'get_ocl2dra.load_texture_async', 'get_ocl2dra.texture_status', 'get_ocl2dra.texture_progress',
+            'get_ocl2dra.set_upload_budget', 'get_ocl2dra.draw_texture', 'get_ocl2dra.layer_create',
+            'get_ocl2dra.layer_begin', 'get_ocl2dra.layer_end', 'get_ocl2dra.layer_set_visible', 'get_ocl2dra.layer_redraws',
+            'get_ocl2dra.set_depth', 'get_ocl2dra.set_state_sorting', 'get_ocl2dra.set_camera', 'get_ocl2dra.get_draw_stats'
         ):
             ocl_func = 'ocl.' + self.current_token[1]
             self.advance()
@@ -157,13 +205,14 @@ class Parser:
                         break
                     self.eat('comma')
             self.eat('right_paren')
-            return ('call', ocl_func, args)
+            return Call(ocl_func, tuple(args), line, column)
         else:
             line = self.current_token[2]
             column = self.current_token[3]
             raise SyntaxError(f"Line {line}, column {column}: Unknown ocl command")
 
     def function_definition(self):
+        line, column = self.position()
         self.advance()
         if self.current_token[0] != 'identifier':
             raise SyntaxError(f"Line {self.current_token[2]}, column {self.current_token[3]}: Expected function name")
@@ -190,9 +239,10 @@ class Parser:
         self.eat('colon')
         self.eat('left_brace')
         body = self.block()
-        return ('define', func_name, params, body)
+        return Define(func_name, params, body, line, column)
 
     def declaration(self):
+        line, column = self.position()
         self.advance()
         if self.current_token[0] != 'identifier':
             raise SyntaxError(f"Line {self.current_token[2]}, column {self.current_token[3]}: Expected variable name")
@@ -205,28 +255,39 @@ class Parser:
             self.advance()
         self.eat('assignment')
         expr = self.expression()
-        return ('declare', 'let', var_name, type_annot, expr)
+        return Declare(var_name, type_annot, expr, line, column)
 
     def assignment_or_call_statement(self):
+        line, column = self.position()
         expr = self.expression()
         if self.current_token and self.current_token[0] in ['assignment', 'aug_assignment']:
             if self.current_token[0] == 'assignment':
                 self.eat('assignment')
                 value = self.expression()
-                return ('assign', expr, value)
+                return Assign(expr, value, line, column)
             elif self.current_token[0] == 'aug_assignment':
                 op = self.current_token[1][0]
                 self.eat('aug_assignment')
                 value = self.expression()
-                return ('aug_assign', expr, op, value)
+                return AugAssign(expr, op, value, line, column)
         return expr
 
+    def spawn_expression(self):
+        line, column = self.position()
+        self.advance()
+        call = self.primary() if self.current_token else None
+        if call is None or call.kind not in (CALL, CALL_METHOD) or call.kind == CALL and call.name.startswith('ocl.'):
+            raise SyntaxError(f"Line {line}, column {column}: Expected a function or method call after 'spawn'")
+        return Spawn(call, line, column)
+
     def print_statement(self):
+        line, column = self.position()
         self.advance()
         expr = self.expression()
-        return ('print', expr)
+        return Print(expr, line, column)
 
     def if_statement(self):
+        line, column = self.position()
         self.advance()
         condition = self.expression()
         self.eat('colon')
@@ -240,21 +301,48 @@ class Parser:
             self.eat('left_brace')
             elif_body = self.block()
             elif_blocks.append((elif_cond, elif_body))
-        else_block = []
+        else_block = ()
         if self.current_token and self.current_token[0].lower() == 'else':
             self.advance()
             self.eat('colon')
             self.eat('left_brace')
             else_block = self.block()
-        return ('if', condition, body, elif_blocks, else_block)
+        return If(condition, body, tuple(elif_blocks), else_block, line, column)
 
     def while_statement(self):
+        line, column = self.position()
         self.advance()
         condition = self.expression()
         self.eat('colon')
         self.eat('left_brace')
         body = self.block()
-        return ('while', condition, body)
+        return While(condition, body, line, column)
+
+    def for_statement(self):
+        line, column = self.position()
+        self.advance()
+        if not self.current_token or self.current_token[0] != 'identifier' or '.' in self.current_token[1]:
+            line = self.current_token[2] if self.current_token else "unknown"
+            column = self.current_token[3] if self.current_token else "unknown"
+            raise SyntaxError(f"Line {line}, column {column}: Expected loop variable name after 'for'")
+        var_name = self.current_token[1]
+        self.advance()
+        self.eat('in')
+        iterable = self.expression()
+        self.eat('colon')
+        self.eat('left_brace')
+        body = self.block()
+        if isinstance(iterable, Call) and iterable.name == 'range':
+            args = iterable.args
+            if not 1 <= len(args) <= 3:
+                raise SyntaxError(f"Line {iterable.line}, column {iterable.column}: range() takes 1 to 3 arguments, got {len(args)}")
+            if len(args) == 1:
+                args = [Literal(0, iterable.line, iterable.column), args[0]]
+            start = args[0]
+            stop = args[1]
+            step = args[2] if len(args) == 3 else Literal(1, iterable.line, iterable.column)
+            return ForRange(var_name, start, stop, step, body, line, column)
+        return ForEach(var_name, iterable, body, line, column)
 
     def block(self):
         statements = []
@@ -264,7 +352,7 @@ class Parser:
             while self.current_token and self.current_token[0] == 'semicolon':
                 self.eat('semicolon')
         self.eat('right_brace')
-        return statements
+        return tuple(statements)
 
     def expression(self):
         return self.comparison()
@@ -273,27 +361,30 @@ class Parser:
         left = self.arithmetic()
         while self.current_token and self.current_token[0] == 'operator' and self.current_token[1] in ('==', '!=', '<', '>', '<=', '>='):
             op = self.current_token[1]
+            line, column = self.position()
             self.advance()
             right = self.arithmetic()
-            left = ('binary', op, left, right)
+            left = Binary(op, left, right, line, column)
         return left
 
     def arithmetic(self):
         left = self.term()
         while self.current_token and self.current_token[0] == 'operator' and self.current_token[1] in ('+', '-'):
             op = self.current_token[1]
+            line, column = self.position()
             self.advance()
             right = self.term()
-            left = ('binary', op, left, right)
+            left = Binary(op, left, right, line, column)
         return left
 
     def term(self):
         left = self.factor()
         while self.current_token and self.current_token[0] == 'operator' and self.current_token[1] in ('*', '/', '%'):
             op = self.current_token[1]
+            line, column = self.position()
             self.advance()
             right = self.factor()
-            left = ('binary', op, left, right)
+            left = Binary(op, left, right, line, column)
         return left
 
     def factor(self):
@@ -305,26 +396,54 @@ class Parser:
         return self.primary()
 
     def primary(self):
+        line, column = self.position()
         if self.current_token[0] == 'number':
             value = float(self.current_token[1]) if '.' in self.current_token[1] else int(self.current_token[1])
             self.advance()
-            return ('literal', value)
+            return Literal(value, line, column)
         elif self.current_token[0] == 'string_literal':
             value = self.current_token[1][1:-1]
             self.advance()
-            return ('literal', value)
+            return Literal(value, line, column)
         elif self.current_token[0].lower() in ('true', 'false'):
             value = True if self.current_token[0].lower() == 'true' else False
             self.advance()
-            return ('literal', value)
+            return Literal(value, line, column)
         elif self.current_token[0].lower() == 'null':
             self.advance()
-            return ('literal', None)
+            return Literal(None, line, column)
         elif self.current_token[0] == 'ocl':
             return self.ocl_statement()
+        elif self.current_token[0] == 'spawn':
+            return self.spawn_expression()
         elif self.current_token[0] == 'identifier':
             name = self.current_token[1]
             self.advance()
+            if '.' in name:
+                # The lexer keeps 'obj.field' as one identifier; split it once here
+                # so attribute reads and method calls carry their own inline caches.
+                parts = name.split('.')
+                base = Identifier(parts[0], line, column)
+                for part in parts[1:-1]:
+                    base = Attribute(base, part, line, column)
+                if self.current_token and self.current_token[0] == 'left_paren':
+                    self.eat('left_paren')
+                    args = []
+                    if self.current_token and self.current_token[0] != 'right_paren':
+                        while True:
+                            args.append(self.expression())
+                            if self.current_token[0] == 'right_paren':
+                                break
+                            self.eat('comma')
+                    self.eat('right_paren')
+                    return CallMethod(base, parts[-1], tuple(args), line, column)
+                attribute = Attribute(base, parts[-1], line, column)
+                if self.current_token and self.current_token[0] == 'left_bracket':
+                    self.eat('left_bracket')
+                    index = self.expression()
+                    self.eat('right_bracket')
+                    return Index(attribute, index, line, column)
+                return attribute
             if self.current_token and self.current_token[0] == 'dot':
                 self.eat('dot')
                 if self.current_token[0] != 'identifier':
@@ -343,13 +462,13 @@ class Parser:
                                 break
                             self.eat('comma')
                     self.eat('right_paren')
-                    return ('call_method', ('identifier', name), method_name, args)
-                return ('attribute', ('identifier', name), method_name)
+                    return CallMethod(Identifier(name, line, column), method_name, tuple(args), line, column)
+                return Attribute(Identifier(name, line, column), method_name, line, column)
             elif self.current_token and self.current_token[0] == 'left_bracket':
                 self.eat('left_bracket')
                 index = self.expression()
                 self.eat('right_bracket')
-                return ('index', ('identifier', name), index)
+                return Index(Identifier(name, line, column), index, line, column)
             elif self.current_token and self.current_token[0] == 'left_paren':
                 self.eat('left_paren')
                 args = []
@@ -360,8 +479,8 @@ class Parser:
                             break
                         self.eat('comma')
                 self.eat('right_paren')
-                return ('call', name, args)
-            return ('identifier', name)
+                return Call(name, tuple(args), line, column)
+            return Identifier(name, line, column)
         elif self.current_token[0] == 'left_paren':
             self.eat('left_paren')
             expr = self.expression()
@@ -0,0 +1,244 @@
+#specializer.py
+"""Type specialization driven by `let x: T` and `param: T` annotations.
+
+`Specializer` walks one unit of code (a function or method body, or a
+top-level statement) before it runs, tracking which names provably hold an
+annotated scalar type at each point. With that it fills in fields the
+interpreter reads at run time:
+
+  Binary.fn         the Python operation for the operand types, so the
+                    interpreter skips apply_op's type tests
+  AugAssign.fn      the same for `x op= value`
+  Assign.check,     the type an assignment to an annotated variable must
+  AugAssign.check   have, left None when the value's type is already proven
+  Declare.proven    True when an annotated declaration needs no check
+
+Only names bound in the unit itself are tracked: a function body reads
+variables it did not bind from its caller's frame, which can hold anything.
+An annotation stays with its variable until an unannotated `let` or a loop
+rebinds it; other assignments to it are checked instead. Declarations made
+inside a branch or loop body are only trusted inside it, and a loop is
+re-walked until the types at its head are stable.
+"""
+import operator
+from ast_nodes import (
+    LITERAL, IDENTIFIER, BINARY, INDEX, ATTRIBUTE, CALL_METHOD, CALL, SPAWN, DECLARE, ASSIGN, AUG_ASSIGN,
+    PRINT, IF, WHILE, FOR_RANGE, FOR_EACH, RETURN, BREAK, CONTINUE
+)
+
+SCALAR_TYPES = {'int': int, 'float': float, 'bool': bool, 'string': str}
+
+# Set by the interpreter behind the script's back (ocl.get_set_input), so
+# never trusted to keep an annotation.
+UNTRACKED = frozenset(('input_value',))
+
+def _int_div(left, right):
+    return left // right
+
+def _binary_table():
+    """(op, left type, right type) -> (operation, result type). Integer `/`
+    floors, matching apply_op."""
+    table = {}
+    arithmetic = {'+': operator.add, '-': operator.sub, '*': operator.mul, '%': operator.mod}
+    comparisons = {'<': operator.lt, '>': operator.gt, '<=': operator.le, '>=': operator.ge}
+    numeric = ('int', 'float')
+    for left in numeric:
+        for right in numeric:
+            result = 'int' if left == right == 'int' else 'float'
+            for op, fn in arithmetic.items():
+                table[(op, left, right)] = (fn, result)
+            table[('/', left, right)] = (_int_div, 'int') if result == 'int' else (operator.truediv, 'float')
+            for op, fn in comparisons.items():
+                table[(op, left, right)] = (fn, 'bool')
+    table[('+', 'string', 'string')] = (operator.add, 'string')
+    for op, fn in comparisons.items():
+        table[(op, 'string', 'string')] = (fn, 'bool')
+    for left in SCALAR_TYPES:
+        for right in SCALAR_TYPES:
+            table[('==', left, right)] = (operator.is_, 'bool')
+            table[('!=', left, right)] = (operator.is_not, 'bool')
+    return table
+
+BINARY_OPS = _binary_table()
+
+class Specializer:
+    def __init__(self):
+        self.jumps = None  # environments at break/continue in the loop being walked
+
+    def function(self, params, body):
+        """Specialize a function or method body. Returns the (index, name,
+        annotation) of each parameter that must be checked on entry."""
+        env = {}
+        checks = []
+        for index, (name, annot) in enumerate(params):
+            if annot in SCALAR_TYPES and name not in UNTRACKED:
+                env[name] = (annot, True)
+                checks.append((index, name, annot))
+        saved = self.jumps
+        self.jumps = None
+        try:
+            self.block(body, env)
+        finally:
+            self.jumps = saved
+        return checks
+
+    def block(self, statements, env):
+        for statement in statements:
+            self.statement(statement, env)
+
+    def statement(self, node, env):
+        """Specialize one statement and update `env` (name -> (type, sticky))
+        to what holds after it runs. Sticky entries come from annotations."""
+        kind = node.kind
+        if kind == DECLARE:
+            value_type = self.expression(node.value, env)
+            annot = node.type_annot
+            node.proven = annot in SCALAR_TYPES and value_type in (annot, 'null')
+            if annot in SCALAR_TYPES and node.name not in UNTRACKED:
+                env[node.name] = (annot, True)
+            else:
+                env.pop(node.name, None)
+        elif kind == ASSIGN:
+            value_type = self.expression(node.value, env)
+            self.target(node.target, env)
+            node.check = self.bind(node.target, value_type, env)
+        elif kind == AUG_ASSIGN:
+            value_type = self.expression(node.value, env)
+            current_type = self.target(node.target, env)
+            node.fn, result_type = self.operation(node.op, current_type, value_type)
+            node.check = self.bind(node.target, result_type, env)
+        elif kind == IF:
+            branches = []
+            for condition, body in [(node.condition, node.body)] + list(node.elifs):
+                self.expression(condition, env)
+                branch = dict(env)
+                self.block(body, branch)
+                branches.append(branch)
+            branch = dict(env)
+            self.block(node.else_body, branch)
+            branches.append(branch)
+            self.replace(env, self.merge(branches))
+        elif kind == WHILE:
+            self.loop(node, env, None, None)
+        elif kind == FOR_RANGE:
+            for bound in (node.start, node.stop, node.step):
+                self.expression(bound, env)
+            self.loop(node, env, node.var, 'int')
+        elif kind == FOR_EACH:
+            self.expression(node.iterable, env)
+            self.loop(node, env, node.var, None)
+        elif kind in (PRINT, RETURN):
+            self.expression(node.value, env)
+        elif kind in (BREAK, CONTINUE):
+            if self.jumps is not None:
+                self.jumps.append(dict(env))
+        elif kind in (CALL, CALL_METHOD, SPAWN):
+            self.expression(node, env)
+        # Define and class bodies are specialized when they are defined
+
+    def loop(self, node, env, var, var_type):
+        """Walk a loop body until the types at its head stop changing. After
+        the loop only what held at the head, at every break and on each way
+        back to the head can be trusted."""
+        saved = self.jumps
+        head = dict(env)
+        try:
+            while True:
+                self.jumps = []
+                if node.kind == WHILE:
+                    self.expression(node.condition, head)
+                body_env = dict(head)
+                if var is not None:
+                    current = body_env.get(var)
+                    if var_type is not None and current in (None, (var_type, False), (var_type, True)):
+                        body_env[var] = current or (var_type, False)
+                    else:
+                        body_env.pop(var, None)
+                self.block(node.body, body_env)
+                stable = self.merge([head, body_env] + self.jumps)
+                if len(stable) == len(head):
+                    break
+                head = stable
+        finally:
+            self.jumps = saved
+        self.replace(env, head)
+
+    @staticmethod
+    def merge(envs):
+        first = envs[0]
+        return {name: entry for name, entry in first.items() if all(other.get(name) == entry for other in envs[1:])}
+
+    @staticmethod
+    def replace(env, new):
+        env.clear()
+        env.update(new)
+
+    def target(self, node, env):
+        """Specialize the expressions inside an assignment target and return
+        the target's current type if it is a tracked name."""
+        if node.kind == IDENTIFIER:
+            entry = env.get(node.name)
+            return entry[0] if entry is not None else None
+        self.expression(node, env)
+        return None
+
+    def bind(self, target, value_type, env):
+        """Record an assignment of `value_type` to `target`. Returns the type
+        the interpreter must check the value against, if any."""
+        if target.kind != IDENTIFIER:
+            return None
+        entry = env.get(target.name)
+        if entry is None:
+            return None
+        annot, sticky = entry
+        if value_type in (annot, 'null'):
+            return None
+        if sticky:
+            return SCALAR_TYPES[annot]
+        del env[target.name]
+        return None
+
+    @staticmethod
+    def operation(op, left_type, right_type):
+        return BINARY_OPS.get((op, left_type, right_type), (None, None))
+
+    def expression(self, node, env):
+        """Specialize `node` and return its type name if it is provable:
+        one of SCALAR_TYPES, 'null', or None when unknown."""
+        if node is None:
+            return None
+        kind = node.kind
+        if kind == LITERAL:
+            value = node.value
+            if value is None:
+                return 'null'
+            if isinstance(value, bool):
+                return 'bool'
+            if isinstance(value, int):
+                return 'int'
+            if isinstance(value, float):
+                return 'float'
+            return 'string' if isinstance(value, str) else None
+        if kind == IDENTIFIER:
+            entry = env.get(node.name)
+            return entry[0] if entry is not None else None
+        if kind == BINARY:
+            left_type = self.expression(node.left, env)
+            right_type = self.expression(node.right, env)
+            node.fn, result_type = self.operation(node.op, left_type, right_type)
+            return result_type
+        if kind == INDEX:
+            self.expression(node.base, env)
+            self.expression(node.index, env)
+        elif kind == ATTRIBUTE:
+            self.expression(node.base, env)
+        elif kind == CALL:
+            for arg in node.args:
+                self.expression(arg, env)
+        elif kind == CALL_METHOD:
+            self.expression(node.obj, env)
+            for arg in node.args:
+                self.expression(arg, env)
+        elif kind == SPAWN:
+            self.expression(node.call, env)
+        return None